@@ -0,0 +1,97 @@
+#include "ArcCachePolicy.h"
+#include <algorithm>
+
+ArcCachePolicy::ArcCachePolicy(int capacity): CachePolicy(capacity) {
+    slotLists.resize(capacity, (int) NO_LIST);
+    positions.resize(capacity);
+    slotBlocks.resize(capacity);
+    recentTarget = 0;
+}
+
+int ArcCachePolicy::insert(long long blockIdx, int freeSlot) {
+    int slot = freeSlot;
+    bool frequent = false;
+    bool frequentGhostHit = false;
+
+    unordered_map<long long, pair<int, list<long long>::iterator>>::iterator ghost = ghosts.find(blockIdx);
+    if(ghost != ghosts.end()) {
+        // block was evicted too early - list it was evicted from gets more space
+        if(ghost->second.first == RECENT_LIST) {
+            recentTarget = min(capacity, recentTarget + max((int) (frequentGhosts.size() / recentGhosts.size()), 1));
+            recentGhosts.erase(ghost->second.second);
+        }
+        else {
+            recentTarget = max(0, recentTarget - max((int) (recentGhosts.size() / frequentGhosts.size()), 1));
+            frequentGhosts.erase(ghost->second.second);
+            frequentGhostHit = true;
+        }
+        ghosts.erase(ghost);
+        frequent = true;
+    }
+    else if(recentSlots.size() + recentGhosts.size() >= capacity) {
+        // blocks accessed once (with their ghosts) fill the whole cache
+        if(recentSlots.size() < capacity) {
+            dropGhost(recentGhosts);
+        }
+        else if(slot == -1) {
+            slot = recentSlots.back();
+            recentSlots.pop_back();
+        }
+    }
+    else if(recentSlots.size() + frequentSlots.size() + recentGhosts.size() + frequentGhosts.size() >= 2 * capacity) {
+        dropGhost(frequentGhosts);
+    }
+
+    if(slot == -1) {
+        slot = replace(frequentGhostHit);
+    }
+
+    // block is accessed for the first time or it was remembered as ghost
+    list<int> &slots = frequent ? frequentSlots : recentSlots;
+    slots.push_front(slot);
+    slotLists[slot] = frequent ? FREQUENT_LIST : RECENT_LIST;
+    positions[slot] = slots.begin();
+    slotBlocks[slot] = blockIdx;
+    return slot;
+}
+
+void ArcCachePolicy::accessed(int slot) {
+    // block accessed more times is moved to the front of frequent list
+    list<int> &slots = slotLists[slot] == RECENT_LIST ? recentSlots : frequentSlots;
+    frequentSlots.splice(frequentSlots.begin(), slots, positions[slot]);
+    slotLists[slot] = FREQUENT_LIST;
+}
+
+void ArcCachePolicy::removed(int slot) {
+    list<int> &slots = slotLists[slot] == RECENT_LIST ? recentSlots : frequentSlots;
+    slots.erase(positions[slot]);
+    slotLists[slot] = NO_LIST;
+}
+
+int ArcCachePolicy::replace(bool frequentGhostHit) {
+    if(!recentSlots.empty() && (recentSlots.size() > recentTarget || (frequentGhostHit && recentSlots.size() == recentTarget)
+            || frequentSlots.empty())) {
+        return evictToGhosts(recentSlots, recentGhosts, RECENT_LIST);
+    }
+
+    return evictToGhosts(frequentSlots, frequentGhosts, FREQUENT_LIST);
+}
+
+int ArcCachePolicy::evictToGhosts(list<int> &slots, list<long long> &ghostBlocks, int ghostList) {
+    int slot = slots.back();
+    slots.pop_back();
+    slotLists[slot] = NO_LIST;
+
+    ghostBlocks.push_front(slotBlocks[slot]);
+    ghosts[slotBlocks[slot]] = make_pair(ghostList, ghostBlocks.begin());
+    return slot;
+}
+
+void ArcCachePolicy::dropGhost(list<long long> &ghostBlocks) {
+    if(ghostBlocks.empty()) {
+        return;
+    }
+
+    ghosts.erase(ghostBlocks.back());
+    ghostBlocks.pop_back();
+}
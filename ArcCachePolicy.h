@@ -0,0 +1,56 @@
+#ifndef ZOS_VFS_ARCCACHEPOLICY_H
+#define ZOS_VFS_ARCCACHEPOLICY_H
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "CachePolicy.h"
+
+/*
+ * Class represents ARC policy - blocks accessed once and blocks accessed more times are kept in two LRU lists,
+ * indexes of evicted blocks are remembered and their hits move target size of the first list (scan of many blocks does not evict frequent ones)
+ */
+class ArcCachePolicy : public CachePolicy {
+public:
+    // constructor
+    explicit ArcCachePolicy(int capacity);
+
+    int insert(long long blockIdx, int freeSlot) override;
+    void accessed(int slot) override;
+    void removed(int slot) override;
+
+private:
+    // list of slot - none, accessed once, accessed more times
+    static const int NO_LIST = 0;
+    static const int RECENT_LIST = 1;
+    static const int FREQUENT_LIST = 2;
+
+    // slots of blocks accessed once, most recently used first
+    list<int> recentSlots;
+    // slots of blocks accessed more times, most recently used first
+    list<int> frequentSlots;
+    // indexes of blocks evicted from recent list, most recently evicted first
+    list<long long> recentGhosts;
+    // indexes of blocks evicted from frequent list, most recently evicted first
+    list<long long> frequentGhosts;
+    // evicted blocks by index - list (recent or frequent) and position in it
+    unordered_map<long long, pair<int, list<long long>::iterator>> ghosts;
+    // list of every slot
+    vector<int> slotLists;
+    // positions of used slots in their lists
+    vector<list<int>::iterator> positions;
+    // index of block in every slot
+    vector<long long> slotBlocks;
+    // target count of blocks accessed once
+    int recentTarget;
+
+    // evicts block from recent or frequent list by target and returns its slot (block is remembered as ghost)
+    int replace(bool frequentGhostHit);
+    // moves block from end of list to ghosts and returns its slot
+    int evictToGhosts(list<int> &slots, list<long long> &ghostBlocks, int ghostList);
+    // forgets the oldest ghost of list
+    void dropGhost(list<long long> &ghostBlocks);
+};
+
+
+#endif
@@ -0,0 +1,303 @@
+#include "Bitmap.h"
+#include "Constants.h"
+#include <stdlib.h>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// count of bits in one word
+static const int WORD_BITS = 64;
+// word with all items used
+static const uint64_t FULL_WORD = ~((uint64_t) 0);
+
+// get index of lowest zero bit in word which is not full
+static int lowestZeroBit(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(~word);
+#else
+    int bit = 0;
+    while(word & 1) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// get count of set bits in word
+static int bitsSet(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while(word) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+Bitmap::Bitmap() {
+    words = nullptr;
+    itemsCount = 0;
+    wordsCount = 0;
+    ownsWords = false;
+    shards = nullptr;
+    shardsCount = 0;
+    shardWords = 1;
+}
+
+Bitmap::~Bitmap() {
+    if(words != nullptr && ownsWords) {
+        free(words);
+    }
+    delete[] shards;
+}
+
+void Bitmap::init(int itemsCount) {
+    if(words != nullptr && ownsWords) {
+        free(words);
+    }
+
+    this->itemsCount = itemsCount;
+    wordsCount = bytesSizeFor(itemsCount) / sizeof(uint64_t);
+    words = (uint64_t *) malloc(wordsCount * sizeof(uint64_t));
+    memset(words, 0, wordsCount * sizeof(uint64_t));
+    ownsWords = true;
+    fillTail();
+    initShards();
+    dirtyPages.init(wordsCount * sizeof(uint64_t));
+}
+
+void Bitmap::attach(uint64_t *words, int itemsCount) {
+    if(this->words != nullptr && ownsWords) {
+        free(this->words);
+    }
+
+    this->words = words;
+    this->itemsCount = itemsCount;
+    wordsCount = bytesSizeFor(itemsCount) / sizeof(uint64_t);
+    ownsWords = false;
+    initShards();
+    dirtyPages.init(wordsCount * sizeof(uint64_t));
+    loaded();
+}
+
+bool Bitmap::isFull(int idx) const {
+    lock_guard<mutex> guard(getShard(idx).lock);
+    return (words[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1;
+}
+
+void Bitmap::setFull(int idx) {
+    lock_guard<mutex> guard(getShard(idx).lock);
+    setFullInShard(idx, 1);
+}
+
+void Bitmap::setEmpty(int idx) {
+    shard &itemShard = getShard(idx);
+    lock_guard<mutex> guard(itemShard.lock);
+    words[idx / WORD_BITS] &= ~((uint64_t) 1 << (idx % WORD_BITS));
+    markWordsDirty(idx / WORD_BITS, 1);
+
+    // freed item lies before cursor - move cursor back
+    if(idx / WORD_BITS < itemShard.hintWord) {
+        itemShard.hintWord = idx / WORD_BITS;
+    }
+}
+
+int Bitmap::allocate() {
+    int runLength;
+    return allocateRun(1, &runLength);
+}
+
+int Bitmap::allocateRun(int wanted, int *runLength) {
+    // shards are searched in order, so one thread gets the first free items - shard locked by another thread is skipped at first
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < shardsCount; i++) {
+            unique_lock<mutex> guard(shards[i].lock, defer_lock);
+            if(pass == 0 && !guard.try_lock()) {
+                continue;
+            }
+            if(pass == 1) {
+                guard.lock();
+            }
+
+            int start = findFreeInShard(shards[i]);
+            if(start == -1) {
+                continue;
+            }
+
+            // extend run while items of shard are free, empty words are skipped at once
+            int shardEnd = min(shards[i].endWord * WORD_BITS, itemsCount);
+            int end = start + 1;
+            while(end - start < wanted && end < shardEnd) {
+                if(end % WORD_BITS == 0 && words[end / WORD_BITS] == 0 && end - start + WORD_BITS <= wanted) {
+                    end += WORD_BITS;
+                }
+                else if(!((words[end / WORD_BITS] >> (end % WORD_BITS)) & 1)) {
+                    end++;
+                }
+                else {
+                    break;
+                }
+            }
+
+            setFullInShard(start, end - start);
+            *runLength = end - start;
+            return start;
+        }
+    }
+
+    *runLength = 0;
+    return -1;
+}
+
+void Bitmap::setFullRange(int idx, int count) {
+    // range is set by parts which lie in one shard
+    int end = idx + count;
+    while(idx < end) {
+        shard &itemShard = getShard(idx);
+        int partEnd = min(end, itemShard.endWord * WORD_BITS);
+        lock_guard<mutex> guard(itemShard.lock);
+        setFullInShard(idx, partEnd - idx);
+        idx = partEnd;
+    }
+}
+
+int Bitmap::countFull() const {
+    int count = 0;
+    for(int i = 0; i < wordsCount; i++) {
+        count += bitsSet(words[i]);
+    }
+
+    // do not count tail bits
+    return count - (wordsCount * WORD_BITS - itemsCount);
+}
+
+int Bitmap::getItemsCount() const {
+    return itemsCount;
+}
+
+uint64_t *Bitmap::getWords() {
+    return words;
+}
+
+int Bitmap::getBytesSize() const {
+    return wordsCount * sizeof(uint64_t);
+}
+
+int Bitmap::bytesSizeFor(int itemsCount) {
+    return (((long long) itemsCount + WORD_BITS - 1) / WORD_BITS) * sizeof(uint64_t);
+}
+
+void Bitmap::loaded() {
+    fillTail();
+    for(int i = 0; i < shardsCount; i++) {
+        shards[i].hintWord = shards[i].firstWord;
+    }
+    dirtyPages.clear();
+}
+
+DirtyPages &Bitmap::getDirtyPages() {
+    return dirtyPages;
+}
+
+void Bitmap::initShards() {
+    delete[] shards;
+
+    // shards have whole words, small bitmap has less shards
+    shardsCount = min((int) Constants::BITMAP_SHARDS_COUNT, max(wordsCount, 1));
+    shardWords = max((wordsCount + shardsCount - 1) / shardsCount, 1);
+    shardsCount = max((wordsCount + shardWords - 1) / shardWords, 1);
+    shards = new shard[shardsCount];
+    for(int i = 0; i < shardsCount; i++) {
+        shards[i].firstWord = i * shardWords;
+        shards[i].endWord = min((i + 1) * shardWords, wordsCount);
+        shards[i].hintWord = shards[i].firstWord;
+    }
+}
+
+Bitmap::shard &Bitmap::getShard(int idx) const {
+    return shards[idx / WORD_BITS / shardWords];
+}
+
+int Bitmap::findFreeInShard(shard &itemsShard) {
+    // skip full words from cursor
+    int wordIdx = findNotFullWord(itemsShard.hintWord, itemsShard.endWord);
+    itemsShard.hintWord = wordIdx;
+
+    if(wordIdx == itemsShard.endWord) {
+        // all items of shard are used
+        return -1;
+    }
+
+    return wordIdx * WORD_BITS + lowestZeroBit(words[wordIdx]);
+}
+
+void Bitmap::setFullInShard(int idx, int count) {
+    int end = idx + count;
+    int firstWord = idx / WORD_BITS;
+    while(idx < end) {
+        if(idx % WORD_BITS == 0 && end - idx >= WORD_BITS) {
+            // whole word at once
+            words[idx / WORD_BITS] = FULL_WORD;
+            idx += WORD_BITS;
+        }
+        else {
+            words[idx / WORD_BITS] |= (uint64_t) 1 << (idx % WORD_BITS);
+            idx++;
+        }
+    }
+    markWordsDirty(firstWord, (end - 1) / WORD_BITS - firstWord + 1);
+}
+
+void Bitmap::markWordsDirty(int firstWord, int count) {
+    lock_guard<mutex> guard(dirtyLock);
+    dirtyPages.markBytes((long long) firstWord * sizeof(uint64_t), (long long) count * sizeof(uint64_t));
+}
+
+int Bitmap::findNotFullWord(int from, int end) const {
+    int i = from;
+
+#if defined(__AVX2__)
+    // compare 4 words at once with full word
+    const __m256i full256 = _mm256_set1_epi64x(-1);
+    for(; i + 4 <= end; i += 4) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *) (words + i));
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, full256)) != -1) {
+            break;
+        }
+    }
+#elif defined(__SSE2__)
+    // compare 2 words at once with full word
+    const __m128i full128 = _mm_set1_epi32(-1);
+    for(; i + 2 <= end; i += 2) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (words + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, full128)) != 0xFFFF) {
+            break;
+        }
+    }
+#endif
+
+    // scalar search of the rest (or of the vector which contains not full word)
+    for(; i < end; i++) {
+        if(words[i] != FULL_WORD) {
+            return i;
+        }
+    }
+
+    return end;
+}
+
+void Bitmap::fillTail() {
+    int tailBits = itemsCount % WORD_BITS;
+    if(tailBits != 0) {
+        words[wordsCount - 1] |= FULL_WORD << tailBits;
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef ZOS_VFS_BITMAP_H
+#define ZOS_VFS_BITMAP_H
+
+#include <cstdint>
+#include <mutex>
+#include "DirtyPages.h"
+
+using namespace std;
+
+/*
+ * Class represents bit-packed bitmap of free/used items (inodes, data clusters) - words are split to shards with their own locks,
+ * so more threads can allocate and free items at once (thread skips shard used by another one while other shards have free items)
+ */
+class Bitmap {
+public:
+    // constructor
+    Bitmap();
+    // destructor
+    ~Bitmap();
+    // bitmap owns its memory, so it cannot be copied
+    Bitmap(const Bitmap &) = delete;
+    Bitmap &operator=(const Bitmap &) = delete;
+    // allocates bitmap for given count of items, all items are free
+    void init(int itemsCount);
+    // uses words owned by someone else (e.g. mapped image) for given count of items
+    void attach(uint64_t *words, int itemsCount);
+    // checks if item is used
+    bool isFull(int idx) const;
+    // marks item as used
+    void setFull(int idx);
+    // marks item as free
+    void setEmpty(int idx);
+    // marks first free item as used and returns its index, -1 if there is none
+    int allocate();
+    // marks first free run of items (at most wanted, it does not cross shards) as used, returns its start and length, -1 if there is none
+    int allocateRun(int wanted, int *runLength);
+    // marks count of items starting at idx as used
+    void setFullRange(int idx, int count);
+    // get count of used items (bitmap is not changed at the same time)
+    int countFull() const;
+    // get count of items
+    int getItemsCount() const;
+    // get words of bitmap (used for saving and loading)
+    uint64_t *getWords();
+    // get size of bitmap in bytes (whole words)
+    int getBytesSize() const;
+    // get size of bitmap in bytes for given count of items
+    static int bytesSizeFor(int itemsCount);
+    // must be called after words were loaded from outside - fixes tail bits and resets cursor
+    void loaded();
+    // get pages of words changed since bitmap was saved
+    DirtyPages &getDirtyPages();
+
+private:
+    /*
+     * Struct represents part of words which is searched and changed under its own lock
+     */
+    typedef struct theShard {
+        // lock of words of shard
+        mutex lock;
+        // index of the first word of shard and of the word behind the last one
+        int firstWord;
+        int endWord;
+        // index of word where search for free item starts - all words of shard before it are full
+        int hintWord;
+    } shard;
+
+    // bits of bitmap, bit set = item used
+    uint64_t *words;
+    // true if words were allocated by bitmap
+    bool ownsWords;
+    // count of items
+    int itemsCount;
+    // count of words
+    int wordsCount;
+    // shards of words
+    shard *shards;
+    // count of shards
+    int shardsCount;
+    // count of words in one shard (the last one can be shorter)
+    int shardWords;
+    // pages of words changed since bitmap was saved
+    DirtyPages dirtyPages;
+    // lock of changed pages, they are marked by more shards
+    mutex dirtyLock;
+
+    // splits words to shards, search of all shards starts at their first word
+    void initShards();
+    // get shard which contains item
+    shard &getShard(int idx) const;
+    // get index of first free item in shard, -1 if there is none (lock of shard is held)
+    int findFreeInShard(shard &itemsShard);
+    // marks count of items in one shard as used (lock of shard is held)
+    void setFullInShard(int idx, int count);
+    // marks words of bitmap as changed
+    void markWordsDirty(int firstWord, int count);
+    // get index of first word (starting at from, before end) which is not full, end if there is none
+    int findNotFullWord(int from, int end) const;
+    // marks bits behind the last item as used, so they are never returned as free
+    void fillTail();
+};
+
+
+#endif
@@ -0,0 +1,44 @@
+#include "BlockDevice.h"
+#include "Constants.h"
+#include "StdioBlockDevice.h"
+#include "PosixBlockDevice.h"
+#include "DirectBlockDevice.h"
+#include "MmapBlockDevice.h"
+#include "RamBlockDevice.h"
+
+char *BlockDevice::getMemory() {
+    return nullptr;
+}
+
+void BlockDevice::sync() {
+    flush();
+}
+
+bool BlockDevice::allocate(long long) {
+    return false;
+}
+
+int BlockDevice::getAsyncFd() {
+    return -1;
+}
+
+BlockDevice *BlockDevice::forStorage(const string &storage) {
+    if(storage == Constants::STORAGE_STDIO) {
+        return new StdioBlockDevice();
+    }
+    if(storage == Constants::STORAGE_PREAD) {
+        return new PosixBlockDevice();
+    }
+    if(storage == Constants::STORAGE_DIRECT) {
+        return new DirectBlockDevice();
+    }
+    if(storage == Constants::STORAGE_MMAP) {
+        return new MmapBlockDevice();
+    }
+    if(storage == Constants::STORAGE_RAM) {
+        return new RamBlockDevice();
+    }
+
+    // unknown storage
+    return nullptr;
+}
@@ -0,0 +1,44 @@
+#ifndef ZOS_VFS_BLOCKDEVICE_H
+#define ZOS_VFS_BLOCKDEVICE_H
+
+#include <string>
+
+using namespace std;
+
+/*
+ * Class represents storage of vfs image - it reads and writes bytes at given address of image
+ */
+class BlockDevice {
+public:
+    // destructor
+    virtual ~BlockDevice() = default;
+    // open existing image, false if it cannot be opened
+    virtual bool open(const char *name) = 0;
+    // create new (empty) image of given size, false if it cannot be created
+    virtual bool create(const char *name, long long bytesSize) = 0;
+    // change size of open image (new bytes are zeros), false if it cannot be changed
+    virtual bool resize(long long bytesSize) = 0;
+    // reserve space of image in file system without writing it, false if it is not supported
+    virtual bool allocate(long long bytesSize);
+    // close image, all changes are written
+    virtual void close() = 0;
+    // checks if image is open
+    virtual bool isOpen() const = 0;
+    // read bytes from image
+    virtual void read(long long address, void *buffer, long long bytesCount) = 0;
+    // write bytes to image
+    virtual void write(long long address, const void *buffer, long long bytesCount) = 0;
+    // start writing of changes to disk
+    virtual void flush() = 0;
+    // write changes to disk and wait until they are there (barrier of journal)
+    virtual void sync();
+    // get whole image in memory for direct access, nullptr if device does not keep it in memory
+    virtual char *getMemory();
+    // get file descriptor which can be used for asynchronous pread/pwrite of image, -1 if device does not allow it
+    virtual int getAsyncFd();
+    // create device for given storage name, nullptr if storage is unknown
+    static BlockDevice *forStorage(const string &storage);
+};
+
+
+#endif
@@ -0,0 +1,277 @@
+#include "BufferCache.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cstring>
+#include <stdlib.h>
+
+using namespace std;
+
+BufferCache::BufferCache() {
+    device = nullptr;
+    journal = nullptr;
+    address = 0;
+    blockSize = 0;
+    blocksCount = 0;
+    bytesSize = Constants::BUFFER_CACHE_SIZE;
+    policyName = Constants::CACHE_LRU;
+    policy = nullptr;
+    blocks = nullptr;
+    dirtyBytes = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    writebacks = 0;
+}
+
+BufferCache::~BufferCache() {
+    delete policy;
+    free(blocks);
+}
+
+bool BufferCache::configure(long long bytesSize, const string &policyName) {
+    CachePolicy *newPolicy = CachePolicy::forName(policyName, 1);
+    if(newPolicy == nullptr) {
+        return false;
+    }
+    delete newPolicy;
+
+    lock_guard<mutex> guard(cacheLock);
+    writeDirtyBlocks();
+    this->bytesSize = bytesSize;
+    this->policyName = policyName;
+    reset();
+    return true;
+}
+
+void BufferCache::open(BlockDevice *device, Journal *journal, long long address, int blockSize, long long blocksCount) {
+    lock_guard<mutex> guard(cacheLock);
+    this->device = device;
+    this->journal = journal;
+    this->address = address;
+    this->blockSize = blockSize;
+    this->blocksCount = blocksCount;
+    reset();
+}
+
+bool BufferCache::covers(long long address) const {
+    return !slots.empty() && address >= this->address && address < this->address + blocksCount * blockSize;
+}
+
+void BufferCache::read(long long address, void *buffer, long long bytesCount) {
+    long long offset = address - this->address;
+    long long firstBlockIdx = offset / blockSize;
+    long long lastBlockIdx = (offset + bytesCount - 1) / blockSize;
+    if(firstBlockIdx == lastBlockIdx) {
+        if(copyCachedBlock(firstBlockIdx, offset % blockSize, buffer, bytesCount)) {
+            return;
+        }
+
+        // block is loaded without lock, so more readers can load blocks at once
+        char *block = bytesCount == blockSize ? (char *) buffer : (char *) malloc(blockSize);
+        device->read(this->address + firstBlockIdx * blockSize, block, blockSize);
+        journal->patch(this->address + firstBlockIdx * blockSize, block, blockSize);
+        insertBlock(firstBlockIdx, block);
+        if(block != buffer) {
+            memcpy(buffer, block + offset % blockSize, bytesCount);
+            free(block);
+        }
+        return;
+    }
+
+    // cached blocks can have changes which are not in image yet
+    device->read(address, buffer, bytesCount);
+    journal->patch(address, buffer, bytesCount);
+    lock_guard<mutex> guard(cacheLock);
+    for(long long blockIdx = firstBlockIdx; blockIdx <= lastBlockIdx && !index.empty(); blockIdx++) {
+        unordered_map<long long, int>::iterator found = index.find(blockIdx);
+        if(found == index.end()) {
+            continue;
+        }
+
+        long long from = max(offset, blockIdx * blockSize);
+        long long to = min(offset + bytesCount, (blockIdx + 1) * blockSize);
+        memcpy((char *) buffer + (from - offset), blocks + (long long) found->second * blockSize + (from - blockIdx * blockSize), to - from);
+    }
+}
+
+void BufferCache::write(long long address, const void *buffer, long long bytesCount) {
+    lock_guard<mutex> guard(cacheLock);
+    long long offset = address - this->address;
+    long long written = 0;
+    while(written < bytesCount) {
+        long long blockIdx = (offset + written) / blockSize;
+        int from = (offset + written) % blockSize;
+        int bytes = min(bytesCount - written, (long long) blockSize - from);
+
+        unordered_map<long long, int>::iterator found = index.find(blockIdx);
+        if(found == index.end()) {
+            // block is not loaded only because of write
+            journal->write(address + written, (const char *) buffer + written, bytes);
+        }
+        else {
+            // changed range of block grows
+            cacheSlot &slot = slots[found->second];
+            memcpy(blocks + (long long) found->second * blockSize + from, (const char *) buffer + written, bytes);
+            dirtyBytes -= slot.dirtyTo - slot.dirtyFrom;
+            slot.dirtyFrom = slot.dirtyFrom == slot.dirtyTo ? from : min(slot.dirtyFrom, from);
+            slot.dirtyTo = max(slot.dirtyTo, from + bytes);
+            dirtyBytes += slot.dirtyTo - slot.dirtyFrom;
+            policy->accessed(found->second);
+        }
+
+        written += bytes;
+    }
+}
+
+void BufferCache::discard(long long address, long long bytesCount) {
+    lock_guard<mutex> guard(cacheLock);
+    if(index.empty()) {
+        return;
+    }
+
+    long long offset = address - this->address;
+    for(long long blockIdx = offset / blockSize; blockIdx <= (offset + bytesCount - 1) / blockSize; blockIdx++) {
+        unordered_map<long long, int>::iterator found = index.find(blockIdx);
+        if(found == index.end()) {
+            continue;
+        }
+
+        int slot = found->second;
+        dirtyBytes -= slots[slot].dirtyTo - slots[slot].dirtyFrom;
+        slots[slot].blockIdx = -1;
+        slots[slot].dirtyFrom = 0;
+        slots[slot].dirtyTo = 0;
+        policy->removed(slot);
+        index.erase(found);
+        freeSlots.push_back(slot);
+    }
+}
+
+void BufferCache::flush() {
+    lock_guard<mutex> guard(cacheLock);
+    writeDirtyBlocks();
+}
+
+void BufferCache::writeDirtyBlocks() {
+    if(dirtyBytes == 0) {
+        return;
+    }
+
+    // changed blocks are written in order of their addresses
+    vector<pair<long long, int>> dirtySlots;
+    for(int i = 0; i < slots.size(); i++) {
+        if(slots[i].dirtyFrom < slots[i].dirtyTo) {
+            dirtySlots.push_back(make_pair(slots[i].blockIdx, i));
+        }
+    }
+    sort(dirtySlots.begin(), dirtySlots.end());
+    for(int i = 0; i < dirtySlots.size(); i++) {
+        writeBack(dirtySlots[i].second);
+    }
+}
+
+long long BufferCache::getDirtyBytes() const {
+    return dirtyBytes;
+}
+
+string BufferCache::getPolicyName() const {
+    return policyName;
+}
+
+int BufferCache::getSize() const {
+    return index.size();
+}
+
+int BufferCache::getCapacity() const {
+    return slots.size();
+}
+
+long long BufferCache::getHits() const {
+    return hits;
+}
+
+long long BufferCache::getMisses() const {
+    return misses;
+}
+
+long long BufferCache::getEvictions() const {
+    return evictions;
+}
+
+long long BufferCache::getWritebacks() const {
+    return writebacks;
+}
+
+bool BufferCache::copyCachedBlock(long long blockIdx, int from, void *buffer, long long bytesCount) {
+    lock_guard<mutex> guard(cacheLock);
+    unordered_map<long long, int>::iterator found = index.find(blockIdx);
+    if(found == index.end()) {
+        return false;
+    }
+
+    hits++;
+    policy->accessed(found->second);
+    memcpy(buffer, blocks + (long long) found->second * blockSize + from, bytesCount);
+    return true;
+}
+
+void BufferCache::insertBlock(long long blockIdx, const char *block) {
+    lock_guard<mutex> guard(cacheLock);
+    misses++;
+    if(index.find(blockIdx) != index.end()) {
+        // another reader loaded block in the meantime
+        return;
+    }
+
+    int freeSlot = -1;
+    if(!freeSlots.empty()) {
+        freeSlot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    // policy chooses block which is evicted if there is no free slot
+    int slot = policy->insert(blockIdx, freeSlot);
+    if(freeSlot == -1) {
+        if(slots[slot].dirtyFrom < slots[slot].dirtyTo) {
+            writeBack(slot);
+            writebacks++;
+        }
+        index.erase(slots[slot].blockIdx);
+        evictions++;
+    }
+
+    memcpy(blocks + (long long) slot * blockSize, block, blockSize);
+    slots[slot].blockIdx = blockIdx;
+    index[blockIdx] = slot;
+}
+
+void BufferCache::writeBack(int slot) {
+    cacheSlot &written = slots[slot];
+    journal->write(address + written.blockIdx * blockSize + written.dirtyFrom, blocks + (long long) slot * blockSize + written.dirtyFrom,
+        written.dirtyTo - written.dirtyFrom);
+    dirtyBytes -= written.dirtyTo - written.dirtyFrom;
+    written.dirtyFrom = 0;
+    written.dirtyTo = 0;
+}
+
+void BufferCache::reset() {
+    // cache is used only when area was opened
+    long long capacity = blockSize == 0 ? 0 : min(bytesSize / blockSize, blocksCount);
+
+    delete policy;
+    policy = CachePolicy::forName(policyName, capacity);
+    free(blocks);
+    blocks = capacity == 0 ? nullptr : (char *) malloc(capacity * blockSize);
+
+    cacheSlot freeSlot;
+    freeSlot.blockIdx = -1;
+    freeSlot.dirtyFrom = 0;
+    freeSlot.dirtyTo = 0;
+    slots.assign(capacity, freeSlot);
+    index.clear();
+    freeSlots.clear();
+    for(int i = capacity - 1; i >= 0; i--) {
+        freeSlots.push_back(i);
+    }
+    dirtyBytes = 0;
+}
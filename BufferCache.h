@@ -0,0 +1,118 @@
+#ifndef ZOS_VFS_BUFFERCACHE_H
+#define ZOS_VFS_BUFFERCACHE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "BlockDevice.h"
+#include "Journal.h"
+#include "CachePolicy.h"
+
+using namespace std;
+
+/*
+ * Class represents cache of blocks (clusters) of data area - directory, indirect and data clusters are not read again while they are cached,
+ * changes of cached blocks are kept until flush or eviction (write-back) and only changed range of block is written to journal then,
+ * more readers can use cache at once (blocks are loaded from image without lock)
+ */
+class BufferCache {
+public:
+    // constructor
+    BufferCache();
+    // destructor
+    ~BufferCache();
+    // sets max bytes of cached blocks and policy of eviction, false if policy is unknown (changed blocks are flushed first)
+    bool configure(long long bytesSize, const string &policyName);
+    // caches blocks of given size in area at given address, blocks are read from device and written to journal (cached blocks are dropped)
+    void open(BlockDevice *device, Journal *journal, long long address, int blockSize, long long blocksCount);
+    // checks if address is in cached area
+    bool covers(long long address) const;
+    // reads bytes from cached area - bytes of more blocks are read directly, so long reads do not evict other blocks
+    void read(long long address, void *buffer, long long bytesCount);
+    // writes bytes to cached area - cached blocks are changed, bytes of other blocks are written to journal
+    void write(long long address, const void *buffer, long long bytesCount);
+    // drops cached blocks in given range without writing their changes (blocks were freed or overwritten)
+    void discard(long long address, long long bytesCount);
+    // writes changed ranges of all blocks to journal
+    void flush();
+    // get bytes of changed ranges which were not written
+    long long getDirtyBytes() const;
+    // get name of policy of eviction
+    string getPolicyName() const;
+    // get count of cached blocks
+    int getSize() const;
+    // get max count of cached blocks
+    int getCapacity() const;
+    // get count of block reads served from cache
+    long long getHits() const;
+    // get count of block reads which loaded block
+    long long getMisses() const;
+    // get count of evicted blocks
+    long long getEvictions() const;
+    // get count of changed blocks written on eviction
+    long long getWritebacks() const;
+
+private:
+    /*
+     * Struct represents one slot of cache
+     */
+    typedef struct theCacheSlot {
+        // index of cached block, -1 if slot is free
+        long long blockIdx;
+        // changed range of block (from is equal to to if block is not changed)
+        int dirtyFrom;
+        int dirtyTo;
+    } cacheSlot;
+
+    // storage of image
+    BlockDevice *device;
+    // journal which gets written blocks
+    Journal *journal;
+    // address of cached area
+    long long address;
+    // size of block [B]
+    int blockSize;
+    // count of blocks in cached area
+    long long blocksCount;
+    // max bytes of cached blocks
+    long long bytesSize;
+    // name of policy of eviction
+    string policyName;
+    // policy of eviction
+    CachePolicy *policy;
+    // bytes of cached blocks (slot after slot)
+    char *blocks;
+    // slots of cache
+    vector<cacheSlot> slots;
+    // slots by index of block
+    unordered_map<long long, int> index;
+    // free slots
+    vector<int> freeSlots;
+    // bytes of changed ranges
+    long long dirtyBytes;
+    // count of block reads served from cache
+    long long hits;
+    // count of block reads which loaded block
+    long long misses;
+    // count of evicted blocks
+    long long evictions;
+    // count of changed blocks written on eviction
+    long long writebacks;
+    // lock of blocks, slots and policy
+    mutex cacheLock;
+
+    // copies bytes of cached block to buffer, false if block is not cached
+    bool copyCachedBlock(long long blockIdx, int from, void *buffer, long long bytesCount);
+    // puts block loaded from image to cache, block of other slot is evicted if there is no free slot
+    void insertBlock(long long blockIdx, const char *block);
+    // writes changed ranges of all blocks to journal
+    void writeDirtyBlocks();
+    // writes changed range of block in slot to journal
+    void writeBack(int slot);
+    // drops all blocks and allocates slots for current size and policy
+    void reset();
+};
+
+
+#endif
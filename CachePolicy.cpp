@@ -0,0 +1,48 @@
+#include "CachePolicy.h"
+#include "Constants.h"
+#include "ClockCachePolicy.h"
+#include "ArcCachePolicy.h"
+
+CachePolicy::CachePolicy(int capacity) {
+    this->capacity = capacity;
+}
+
+int CachePolicy::insert(long long, int freeSlot) {
+    if(positions.empty()) {
+        positions.resize(capacity);
+    }
+
+    // least recently used block is evicted
+    int slot = freeSlot;
+    if(slot == -1) {
+        slot = recentSlots.back();
+        recentSlots.pop_back();
+    }
+
+    recentSlots.push_front(slot);
+    positions[slot] = recentSlots.begin();
+    return slot;
+}
+
+void CachePolicy::accessed(int slot) {
+    recentSlots.splice(recentSlots.begin(), recentSlots, positions[slot]);
+}
+
+void CachePolicy::removed(int slot) {
+    recentSlots.erase(positions[slot]);
+}
+
+CachePolicy *CachePolicy::forName(const string &name, int capacity) {
+    if(name == Constants::CACHE_LRU) {
+        return new CachePolicy(capacity);
+    }
+    if(name == Constants::CACHE_CLOCK) {
+        return new ClockCachePolicy(capacity);
+    }
+    if(name == Constants::CACHE_ARC) {
+        return new ArcCachePolicy(capacity);
+    }
+
+    // unknown policy
+    return nullptr;
+}
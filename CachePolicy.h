@@ -0,0 +1,40 @@
+#ifndef ZOS_VFS_CACHEPOLICY_H
+#define ZOS_VFS_CACHEPOLICY_H
+
+#include <string>
+#include <list>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Class represents policy of buffer cache which chooses block to evict, base class evicts least recently used block
+ */
+class CachePolicy {
+public:
+    // constructor
+    explicit CachePolicy(int capacity);
+    // destructor
+    virtual ~CachePolicy() = default;
+    // get slot for new block - given free slot (-1 if all slots are used) or slot of evicted block
+    virtual int insert(long long blockIdx, int freeSlot);
+    // block in slot was accessed
+    virtual void accessed(int slot);
+    // block in slot was dropped, slot is free now
+    virtual void removed(int slot);
+    // create policy for given name, nullptr if policy is unknown
+    static CachePolicy *forName(const string &name, int capacity);
+
+protected:
+    // count of slots
+    int capacity;
+
+private:
+    // used slots, most recently used first
+    list<int> recentSlots;
+    // positions of used slots in list
+    vector<list<int>::iterator> positions;
+};
+
+
+#endif
@@ -0,0 +1,174 @@
+#include "ChunkIndex.h"
+#include <stdlib.h>
+#include <cstring>
+
+using namespace std;
+
+// primes of hash function
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+// count of lanes which are hashed independently
+static const int LANES_COUNT = 4;
+
+// rotate word left
+static uint64_t rotateLeft(uint64_t word, int bits) {
+    return (word << bits) | (word >> (64 - bits));
+}
+
+// mix word to lane
+static uint64_t mixWord(uint64_t lane, uint64_t word) {
+    return rotateLeft(lane + word * PRIME2, 31) * PRIME1;
+}
+
+ChunkIndex::ChunkIndex() {
+    hashes = nullptr;
+    ownsHashes = false;
+    clustersCount = 0;
+    hashedCount = 0;
+    duplicatesCount = 0;
+    hashingTime = 0;
+}
+
+ChunkIndex::~ChunkIndex() {
+    if(hashes != nullptr && ownsHashes) {
+        free(hashes);
+    }
+}
+
+void ChunkIndex::init(int clustersCount) {
+    if(hashes != nullptr && ownsHashes) {
+        free(hashes);
+    }
+
+    this->clustersCount = clustersCount;
+    hashes = (uint64_t *) calloc(clustersCount, sizeof(uint64_t));
+    ownsHashes = true;
+    clustersByHash.clear();
+    dirtyPages.init(bytesSizeFor(clustersCount));
+}
+
+void ChunkIndex::attach(uint64_t *hashes, int clustersCount) {
+    if(this->hashes != nullptr && ownsHashes) {
+        free(this->hashes);
+    }
+
+    this->hashes = hashes;
+    this->clustersCount = clustersCount;
+    ownsHashes = false;
+    dirtyPages.init(bytesSizeFor(clustersCount));
+    loaded();
+}
+
+void ChunkIndex::loaded() {
+    clustersByHash.clear();
+    for(int i = 0; i < clustersCount; i++) {
+        if(hashes[i] != 0) {
+            clustersByHash[hashes[i]] = i;
+        }
+    }
+    dirtyPages.clear();
+}
+
+uint64_t ChunkIndex::hash(const char *data, int bytesCount) {
+    // independent lanes of words, so more multiplications run at once
+    uint64_t lanes[LANES_COUNT] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+    int i = 0;
+    for(; i + LANES_COUNT * (int) sizeof(uint64_t) <= bytesCount; i += LANES_COUNT * sizeof(uint64_t)) {
+        for(int j = 0; j < LANES_COUNT; j++) {
+            uint64_t word;
+            memcpy(&word, data + i + j * sizeof(uint64_t), sizeof(uint64_t));
+            lanes[j] = mixWord(lanes[j], word);
+        }
+    }
+    uint64_t result = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18) + bytesCount;
+
+    // the rest of words and bytes
+    for(; i + (int) sizeof(uint64_t) <= bytesCount; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        result = rotateLeft(result ^ mixWord(0, word), 27) * PRIME1 + PRIME3;
+    }
+    for(; i < bytesCount; i++) {
+        result = rotateLeft(result ^ ((unsigned char) data[i] * PRIME3), 11) * PRIME1;
+    }
+
+    // avalanche
+    result ^= result >> 33;
+    result *= PRIME2;
+    result ^= result >> 29;
+    result *= PRIME3;
+    result ^= result >> 32;
+
+    return result == 0 ? 1 : result;
+}
+
+int ChunkIndex::find(uint64_t chunkHash) const {
+    unordered_map<uint64_t, int>::const_iterator found = clustersByHash.find(chunkHash);
+    if(found == clustersByHash.end()) {
+        return -1;
+    }
+    return found->second;
+}
+
+void ChunkIndex::insert(int clusterIdx, uint64_t chunkHash) {
+    // cluster with the same hash but different content stays unindexed
+    if(clustersByHash.count(chunkHash) != 0) {
+        return;
+    }
+
+    clustersByHash[chunkHash] = clusterIdx;
+    hashes[clusterIdx] = chunkHash;
+    dirtyPages.markBytes(clusterIdx * sizeof(uint64_t), sizeof(uint64_t));
+}
+
+void ChunkIndex::remove(int clusterIdx) {
+    if(hashes[clusterIdx] == 0) {
+        return;
+    }
+
+    clustersByHash.erase(hashes[clusterIdx]);
+    hashes[clusterIdx] = 0;
+    dirtyPages.markBytes(clusterIdx * sizeof(uint64_t), sizeof(uint64_t));
+}
+
+void ChunkIndex::addHashed(int chunksCount, long long nanoseconds) {
+    hashedCount += chunksCount;
+    hashingTime += nanoseconds;
+}
+
+void ChunkIndex::addDuplicate() {
+    duplicatesCount++;
+}
+
+long long ChunkIndex::getHashedCount() const {
+    return hashedCount;
+}
+
+long long ChunkIndex::getDuplicatesCount() const {
+    return duplicatesCount;
+}
+
+long long ChunkIndex::getHashingTime() const {
+    return hashingTime;
+}
+
+int ChunkIndex::getSize() const {
+    return clustersByHash.size();
+}
+
+uint64_t *ChunkIndex::getHashes() {
+    return hashes;
+}
+
+int ChunkIndex::getBytesSize() const {
+    return bytesSizeFor(clustersCount);
+}
+
+int ChunkIndex::bytesSizeFor(int clustersCount) {
+    return clustersCount * sizeof(uint64_t);
+}
+
+DirtyPages &ChunkIndex::getDirtyPages() {
+    return dirtyPages;
+}
@@ -0,0 +1,78 @@
+#ifndef ZOS_VFS_CHUNKINDEX_H
+#define ZOS_VFS_CHUNKINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include "DirtyPages.h"
+
+using namespace std;
+
+/*
+ * Class represents index of data clusters by hash of their content (used for deduplication),
+ * hash of every cluster is stored in image, the index is built from hashes when image is loaded
+ */
+class ChunkIndex {
+public:
+    // constructor
+    ChunkIndex();
+    // destructor
+    ~ChunkIndex();
+    // index owns its memory, so it cannot be copied
+    ChunkIndex(const ChunkIndex &) = delete;
+    ChunkIndex &operator=(const ChunkIndex &) = delete;
+    // allocates hashes for given count of clusters, no cluster is indexed
+    void init(int clustersCount);
+    // uses hashes owned by someone else (e.g. mapped image) for given count of clusters
+    void attach(uint64_t *hashes, int clustersCount);
+    // must be called after hashes were loaded from outside - builds index
+    void loaded();
+    // get hash of chunk of data (never zero - zero marks cluster without hash)
+    static uint64_t hash(const char *data, int bytesCount);
+    // get index of cluster with given hash, -1 if there is none
+    int find(uint64_t chunkHash) const;
+    // adds cluster with given hash to index
+    void insert(int clusterIdx, uint64_t chunkHash);
+    // removes cluster from index (when it is freed)
+    void remove(int clusterIdx);
+    // adds hashed chunks and time spent by hashing and verifying to statistics
+    void addHashed(int chunksCount, long long nanoseconds);
+    // adds chunk stored as reference to existing cluster to statistics
+    void addDuplicate();
+    // get count of hashed chunks since start
+    long long getHashedCount() const;
+    // get count of chunks stored as references since start
+    long long getDuplicatesCount() const;
+    // get time spent by hashing and verifying since start [ns]
+    long long getHashingTime() const;
+    // get count of indexed clusters
+    int getSize() const;
+    // get hashes (used for saving and loading)
+    uint64_t *getHashes();
+    // get size of hashes in bytes
+    int getBytesSize() const;
+    // get size of hashes in bytes for given count of clusters
+    static int bytesSizeFor(int clustersCount);
+    // get pages of hashes changed since they were saved
+    DirtyPages &getDirtyPages();
+
+private:
+    // hash of content of every cluster, zero for cluster which is not indexed
+    uint64_t *hashes;
+    // true if hashes were allocated by this class
+    bool ownsHashes;
+    // count of clusters
+    int clustersCount;
+    // index of cluster by hash
+    unordered_map<uint64_t, int> clustersByHash;
+    // count of hashed chunks
+    long long hashedCount;
+    // count of chunks stored as references
+    long long duplicatesCount;
+    // time spent by hashing and verifying [ns]
+    long long hashingTime;
+    // pages of hashes changed since they were saved
+    DirtyPages dirtyPages;
+};
+
+
+#endif
@@ -0,0 +1,31 @@
+#include "ClockCachePolicy.h"
+
+ClockCachePolicy::ClockCachePolicy(int capacity): CachePolicy(capacity) {
+    referenced.resize(capacity);
+    hand = 0;
+}
+
+int ClockCachePolicy::insert(long long, int freeSlot) {
+    int slot = freeSlot;
+    if(slot == -1) {
+        // accessed blocks get second chance, all slots are used so hand stops in the second round at latest
+        while(referenced[hand]) {
+            referenced[hand] = false;
+            hand = (hand + 1) % capacity;
+        }
+        slot = hand;
+        hand = (hand + 1) % capacity;
+    }
+
+    // block read only once is evicted when hand comes to it
+    referenced[slot] = false;
+    return slot;
+}
+
+void ClockCachePolicy::accessed(int slot) {
+    referenced[slot] = true;
+}
+
+void ClockCachePolicy::removed(int slot) {
+    referenced[slot] = false;
+}
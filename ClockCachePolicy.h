@@ -0,0 +1,27 @@
+#ifndef ZOS_VFS_CLOCKCACHEPOLICY_H
+#define ZOS_VFS_CLOCKCACHEPOLICY_H
+
+#include <vector>
+#include "CachePolicy.h"
+
+/*
+ * Class represents CLOCK policy - hand goes around slots and evicts the first block which was not accessed since hand passed it
+ */
+class ClockCachePolicy : public CachePolicy {
+public:
+    // constructor
+    explicit ClockCachePolicy(int capacity);
+
+    int insert(long long blockIdx, int freeSlot) override;
+    void accessed(int slot) override;
+    void removed(int slot) override;
+
+private:
+    // true for slots whose block was accessed since hand passed them
+    vector<bool> referenced;
+    // slot checked next
+    int hand;
+};
+
+
+#endif
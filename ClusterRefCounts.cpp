@@ -0,0 +1,99 @@
+#include "ClusterRefCounts.h"
+#include <stdlib.h>
+
+using namespace std;
+
+// max count of additional references of one cluster
+static const int MAX_COUNT = UINT16_MAX;
+
+ClusterRefCounts::ClusterRefCounts() {
+    counts = nullptr;
+    ownsCounts = false;
+    clustersCount = 0;
+    sharedCount = 0;
+}
+
+ClusterRefCounts::~ClusterRefCounts() {
+    if(counts != nullptr && ownsCounts) {
+        free(counts);
+    }
+}
+
+void ClusterRefCounts::init(int clustersCount) {
+    if(counts != nullptr && ownsCounts) {
+        free(counts);
+    }
+
+    this->clustersCount = clustersCount;
+    counts = (uint16_t *) calloc(bytesSizeFor(clustersCount), sizeof(char));
+    ownsCounts = true;
+    sharedCount = 0;
+    dirtyPages.init(bytesSizeFor(clustersCount));
+}
+
+void ClusterRefCounts::attach(uint16_t *counts, int clustersCount) {
+    if(this->counts != nullptr && ownsCounts) {
+        free(this->counts);
+    }
+
+    this->counts = counts;
+    this->clustersCount = clustersCount;
+    ownsCounts = false;
+    dirtyPages.init(bytesSizeFor(clustersCount));
+    loaded();
+}
+
+void ClusterRefCounts::loaded() {
+    sharedCount = 0;
+    for(int i = 0; i < clustersCount; i++) {
+        if(counts[i] != 0) {
+            sharedCount++;
+        }
+    }
+    dirtyPages.clear();
+}
+
+int ClusterRefCounts::get(int clusterIdx) const {
+    return counts[clusterIdx];
+}
+
+bool ClusterRefCounts::isSaturated(int clusterIdx) const {
+    return counts[clusterIdx] == MAX_COUNT;
+}
+
+void ClusterRefCounts::increment(int clusterIdx) {
+    if(counts[clusterIdx] == 0) {
+        sharedCount++;
+    }
+    counts[clusterIdx]++;
+    dirtyPages.markBytes(clusterIdx * sizeof(uint16_t), sizeof(uint16_t));
+}
+
+void ClusterRefCounts::decrement(int clusterIdx) {
+    counts[clusterIdx]--;
+    if(counts[clusterIdx] == 0) {
+        sharedCount--;
+    }
+    dirtyPages.markBytes(clusterIdx * sizeof(uint16_t), sizeof(uint16_t));
+}
+
+int ClusterRefCounts::getSharedCount() const {
+    return sharedCount;
+}
+
+uint16_t *ClusterRefCounts::getCounts() {
+    return counts;
+}
+
+int ClusterRefCounts::getBytesSize() const {
+    return bytesSizeFor(clustersCount);
+}
+
+int ClusterRefCounts::bytesSizeFor(int clustersCount) {
+    // rounded to whole words, so next area stays aligned
+    return (((long long) clustersCount * sizeof(uint16_t) + sizeof(uint64_t) - 1) / sizeof(uint64_t)) * sizeof(uint64_t);
+}
+
+DirtyPages &ClusterRefCounts::getDirtyPages() {
+    return dirtyPages;
+}
@@ -0,0 +1,61 @@
+#ifndef ZOS_VFS_CLUSTERREFCOUNTS_H
+#define ZOS_VFS_CLUSTERREFCOUNTS_H
+
+#include <cstdint>
+#include "DirtyPages.h"
+
+using namespace std;
+
+/*
+ * Class represents counts of additional references to data clusters shared by more files,
+ * cluster with zero count has one owner (or it is free - see data clusters bitmap)
+ */
+class ClusterRefCounts {
+public:
+    // constructor
+    ClusterRefCounts();
+    // destructor
+    ~ClusterRefCounts();
+    // counts own their memory, so they cannot be copied
+    ClusterRefCounts(const ClusterRefCounts &) = delete;
+    ClusterRefCounts &operator=(const ClusterRefCounts &) = delete;
+    // allocates counts for given count of clusters, no cluster is shared
+    void init(int clustersCount);
+    // uses counts owned by someone else (e.g. mapped image) for given count of clusters
+    void attach(uint16_t *counts, int clustersCount);
+    // must be called after counts were loaded from outside - counts shared clusters
+    void loaded();
+    // get count of additional references to cluster
+    int get(int clusterIdx) const;
+    // checks if cluster cannot take more references
+    bool isSaturated(int clusterIdx) const;
+    // adds reference to cluster
+    void increment(int clusterIdx);
+    // removes additional reference from cluster
+    void decrement(int clusterIdx);
+    // get count of clusters with additional references
+    int getSharedCount() const;
+    // get counts (used for saving and loading)
+    uint16_t *getCounts();
+    // get size of counts in bytes (rounded to whole words)
+    int getBytesSize() const;
+    // get size of counts in bytes for given count of clusters
+    static int bytesSizeFor(int clustersCount);
+    // get pages of counts changed since they were saved
+    DirtyPages &getDirtyPages();
+
+private:
+    // count of additional references of every cluster
+    uint16_t *counts;
+    // true if counts were allocated by this class
+    bool ownsCounts;
+    // count of clusters
+    int clustersCount;
+    // count of clusters with additional references
+    int sharedCount;
+    // pages of counts changed since they were saved
+    DirtyPages dirtyPages;
+};
+
+
+#endif
@@ -19,6 +19,24 @@ const string Constants::OUTCP = "outcp";
 const string Constants::LOAD = "load";
 const string Constants::FORMAT = "format";
 const string Constants::LN = "ln";
+const string Constants::STATS = "stats";
+const string Constants::CACHE = "cache";
+const string Constants::RECURSIVE_OPTION = "-r";
+const string Constants::SERVE = "serve";
+const string Constants::STORAGE_STDIO = "stdio";
+const string Constants::STORAGE_PREAD = "pread";
+const string Constants::STORAGE_DIRECT = "direct";
+const string Constants::STORAGE_MMAP = "mmap";
+const string Constants::STORAGE_RAM = "ram";
+const int Constants::DIRECT_IO_ALIGNMENT = 4096;
+const string Constants::IO_SYNC = "sync";
+const string Constants::IO_URING = "uring";
+const string Constants::IO_THREADS = "threads";
+const int Constants::DEFAULT_QUEUE_DEPTH = 8;
+const int Constants::IO_THREADS_COUNT = 4;
+const string Constants::CACHE_LRU = "lru";
+const string Constants::CACHE_CLOCK = "clock";
+const string Constants::CACHE_ARC = "arc";
 const string Constants::UNKNOWN_COMMAND_MSG = "Unknown command detected";
 const string Constants::NOT_FORMATTED_MSG = "The file system is not formatted";
 const string Constants::COMMAND_SUCCESS = "OK";
@@ -29,6 +47,48 @@ const string Constants::PATH_NOT_FOUND = "PATH NOT FOUND";
 const string Constants::EXIST = "EXIST";
 const string Constants::NOT_EMPTY = "NOT EMPTY";
 const string Constants::FILE_NOT_FOUND = "FILE NOT FOUND";
+const string Constants::IMAGE_MIGRATED_MSG = "VFS image was migrated to the current format";
+const string Constants::JOURNAL_REPLAYED_MSG = "Journal of VFS image was replayed - transactions: ";
+const string Constants::MMAP_FAILED_MSG = "VFS image could not be mapped - pread/pwrite is used";
+const string Constants::PREALLOC_FAILED_MSG = "Space of image could not be preallocated - image is sparse";
+const string Constants::URING_FAILED_MSG = "io_uring is not available - thread pool is used";
+const string Constants::DIRECT_FAILED_MSG = "O_DIRECT is not supported - page cache is used";
+const string Constants::MEMORY_MSG = "NOT ENOUGH MEMORY";
+const string Constants::ITEM_SKIPPED_MSG = "ITEM SKIPPED";
+const string Constants::SOCKET_FAILED_MSG = "Socket of server could not be opened";
+const string Constants::HOST_FILE_NOT_ATTACHED_MSG = "HOST FILE MUST BE ATTACHED";
+const string Constants::UNKNOWN_IMAGE_MSG = "VFS image has unknown format";
+const string Constants::OPTION_LAYOUT = "layout";
+const string Constants::LAYOUT_CLASSIC = "classic";
+const string Constants::LAYOUT_EXTENTS = "extents";
+const string Constants::OPTION_DIRS = "dirs";
+const string Constants::DIRS_LINEAR = "linear";
+const string Constants::DIRS_HASH = "hash";
+const string Constants::OPTION_INLINE = "inline";
+const string Constants::OPTION_ON = "on";
+const string Constants::OPTION_OFF = "off";
+const string Constants::OPTION_TAILS = "tails";
+const string Constants::OPTION_REFLINK = "reflink";
+const string Constants::OPTION_DEDUP = "dedup";
+const string Constants::OPTION_COMPRESS = "compress";
+const string Constants::OPTION_JOURNAL = "journal";
+const string Constants::OPTION_CLUSTER = "cluster";
+const string Constants::OPTION_INODE_RATIO = "inode_ratio";
+const string Constants::OPTION_CLASS = "class";
+const string Constants::CLASS_SMALL = "small";
+const string Constants::CLASS_GENERAL = "general";
+const string Constants::CLASS_MEDIA = "media";
+const string Constants::OPTION_ALLOC = "alloc";
+const string Constants::ALLOC_SPARSE = "sparse";
+const string Constants::ALLOC_PREALLOC = "prealloc";
+const string Constants::ALLOC_ZERO = "zero";
+const string Constants::UNKNOWN_OPTION_MSG = "UNKNOWN OPTION";
+const string Constants::INVALID_SIZE_MSG = "INVALID SIZE";
+const string Constants::BAD_LAYOUT_MSG = "IMAGE CANNOT HOLD THIS LAYOUT";
+const string Constants::DIR_FULL_MSG = "DIRECTORY IS FULL";
+const string Constants::OPTIONS_CONFLICT_MSG = "OPTIONS CANNOT BE COMBINED";
+const string Constants::CORRUPTED_CHUNK_MSG = "Compressed data chunk is corrupted!";
+const string Constants::INLINE_INFO = "inline";
 const string Constants::FULL_REFERENCES_MSG = "No more references to data clusters - file is too big!";
 char * Constants::SELF_REF = ".";
 char * Constants::PARENT_REF = "..";
\ No newline at end of file
@@ -48,6 +48,54 @@ public:
     static const string FORMAT;
     // ln command
     static const string LN;
+    // stats command
+    static const string STATS;
+    // cache command
+    static const string CACHE;
+
+    // option of incp and outcp - copy whole directory tree
+    static const string RECURSIVE_OPTION;
+    // count of threads which read or write files of copied tree
+    static const int TREE_WORKERS_COUNT = 4;
+    // count of files of copied tree read ahead
+    static const int TREE_PREFETCH_FILES = 16;
+
+    // storage of image - buffered stdio stream
+    static const string STORAGE_STDIO;
+    // storage of image - pread and pwrite of file descriptor
+    static const string STORAGE_PREAD;
+    // storage of image - O_DIRECT reads and writes which bypass page cache
+    static const string STORAGE_DIRECT;
+    // storage of image - image mapped to memory
+    static const string STORAGE_MMAP;
+    // storage of image - whole image in memory, written back on close
+    static const string STORAGE_RAM;
+    // engine of image reads and writes - synchronous calls of block device
+    static const string IO_SYNC;
+    // engine of image reads and writes - io_uring ring of file descriptor of image
+    static const string IO_URING;
+    // engine of image reads and writes - pool of threads which call pread and pwrite
+    static const string IO_THREADS;
+    // server mode - sessions of clients of unix socket share one image
+    static const string SERVE;
+    // request frame - command line, file of host for incp or outcp can be attached (SCM_RIGHTS) and it is used instead of given path
+    static const int FRAME_COMMAND = 1;
+    // response frame - part of output of command
+    static const int FRAME_OUTPUT = 2;
+    // response frame - command is finished (empty payload)
+    static const int FRAME_END = 3;
+    // max payload of output frame [B]
+    static const int FRAME_OUTPUT_SIZE = 65536;
+    // max payload of command frame [B]
+    static const int FRAME_COMMAND_SIZE = 65536;
+    // count of connections waiting for accept
+    static const int SERVER_BACKLOG = 64;
+    // default count of image reads and writes in flight
+    static const int DEFAULT_QUEUE_DEPTH;
+    // max count of threads of thread pool engine
+    static const int IO_THREADS_COUNT;
+    // alignment of buffers, addresses and sizes for O_DIRECT [B]
+    static const int DIRECT_IO_ALIGNMENT;
     // unknown command msg
     static const string UNKNOWN_COMMAND_MSG;
     // vfs not formatted msg
@@ -62,14 +110,47 @@ public:
     static char *SELF_REF;
     // traversal reference to parent
     static char *PARENT_REF;
-    // ratio of inodes bitmap
-    constexpr static const double INODES_BITMAP_SIZE_RATIO = 0.001;
+    // default count of bytes of image per one inode
+    static const int BYTES_PER_INODE = 1000;
     // count of direct references
     static const int DIRECTS_COUNT = 5;
+    // count of extents stored directly in inode
+    static const int INODE_EXTENTS_COUNT = 3;
+    // code for not existing cluster reference
+    static const int NO_CLUSTER = -1;
     // max name of item
     static const int ITEM_MAX_NAME_LEN = 12;
-    // size of cluster [B]
+    // default size of cluster [B]
     static const int CLUSTER_SIZE = 8192;
+    // allowed sizes of cluster [B] (power of two)
+    static const int MIN_CLUSTER_SIZE = 512;
+    static const int MAX_CLUSTER_SIZE = 1048576;
+    // max count of digits of size given by user, so it fits to long long
+    static const int MAX_SIZE_DIGITS = 18;
+    // size class of small files - size of cluster [B] and count of bytes per one inode
+    static const int SMALL_CLUSTER_SIZE = 1024;
+    static const int SMALL_BYTES_PER_INODE = 2048;
+    // size class of media blobs - size of cluster [B] and count of bytes per one inode
+    static const int MEDIA_CLUSTER_SIZE = 1048576;
+    static const int MEDIA_BYTES_PER_INODE = 4194304;
+    // count of bytes which are read and written at once when copying files (at least one cluster)
+    static const int WRITE_BATCH_SIZE = 1048576;
+    // max count of cluster indexes kept in block map cache
+    static const int BLOCK_MAP_CACHE_SIZE = 1048576;
+    // max count of items kept in dentry cache
+    static const int DENTRY_CACHE_SIZE = 4096;
+    // default max bytes of clusters kept in buffer cache [B]
+    static const int BUFFER_CACHE_SIZE = 16777216;
+    // policies of eviction of buffer cache
+    static const string CACHE_LRU;
+    static const string CACHE_CLOCK;
+    static const string CACHE_ARC;
+    // size of page of metadata (bitmaps, inodes) which is saved when it was changed [B]
+    static const int METADATA_PAGE_SIZE = 4096;
+    // max count of parts of bitmap with their own locks (threads allocate items in different parts at once)
+    static const int BITMAP_SHARDS_COUNT = 16;
+    // count of locks shared by inodes (inode idx modulo count)
+    static const int INODE_LOCKS_COUNT = 1024;
     // inode idx of root dir
     static const int ROOT_INODE_IDX = 0;
     // code for not existing inode
@@ -86,6 +167,138 @@ public:
     static const string EXIST;
     // file not found msg
     static const string FILE_NOT_FOUND;
+    // data of file are stored in inode (printed by info instead of clusters)
+    static const string INLINE_INFO;
+    // magic number of VFS image
+    static const int VFS_MAGIC = 0x5A4F5346;
+    // current version of on-disk format
+    static const int FORMAT_VERSION = 3;
+    // version of on-disk format with 32-bit sizes and addresses
+    static const int FORMAT_VERSION_32BIT = 2;
+    // feature - inodes reference data clusters by extents
+    static const int FEATURE_EXTENTS = 1;
+    // feature - directories are hash tables spanning more clusters
+    static const int FEATURE_HASHED_DIRS = 2;
+    // feature - data of small files are stored in inodes
+    static const int FEATURE_INLINE_DATA = 4;
+    // feature - tails of files share data clusters
+    static const int FEATURE_TAIL_PACKING = 8;
+    // feature - data clusters can be shared by more files (copy shares clusters of source)
+    static const int FEATURE_REFLINK = 16;
+    // feature - chunks with content of existing data cluster are stored as references to it (requires FEATURE_REFLINK)
+    static const int FEATURE_DEDUP = 32;
+    // feature - data chunks of files are compressed to fragments of clusters (requires FEATURE_TAIL_PACKING, excludes FEATURE_REFLINK)
+    static const int FEATURE_COMPRESSION = 64;
+    // feature - changes of metadata are written to journal before they are written in place
+    static const int FEATURE_JOURNAL = 128;
+    // all features known to this version
+    static const int SUPPORTED_FEATURES = FEATURE_EXTENTS | FEATURE_HASHED_DIRS | FEATURE_INLINE_DATA | FEATURE_TAIL_PACKING | FEATURE_REFLINK | FEATURE_DEDUP
+        | FEATURE_COMPRESSION | FEATURE_JOURNAL;
+    // features whose structures are shared by items (clusters of tails, references, hashes), commands which change items run alone with them
+    static const int SHARED_STRUCTURES_FEATURES = FEATURE_TAIL_PACKING | FEATURE_REFLINK | FEATURE_DEDUP | FEATURE_COMPRESSION;
+    // max size of journal [B]
+    static const int JOURNAL_SIZE = 4194304;
+    // journal takes at most this part of image
+    static const int JOURNAL_IMAGE_PART = 64;
+    // image with smaller journal has no journal [B]
+    static const int MIN_JOURNAL_SIZE = 65536;
+    // inode flag - data of file are stored in inode
+    static const int INODE_FLAG_INLINE = 1;
+    // max size of data stored in inode [B]
+    static const int INLINE_DATA_SIZE = 32;
+    // inode flag - the last data cluster of file is shared with tails of other files
+    static const int INODE_FLAG_TAIL = 2;
+    // count of fragments which cluster shared by tails is divided into
+    static const int FRAGMENTS_PER_CLUSTER = 16;
+    // inode flag - references of file point to compressed chunks (index of first fragment) instead of clusters
+    static const int INODE_FLAG_COMPRESSED = 4;
+    // size of header of compressed chunk with size of compressed data [B]
+    static const int COMPRESSED_HEADER_SIZE = sizeof(int);
+    // delimiter of format option name and value
+    static const char OPTION_DELIM = '=';
+    // format option - layout of references to data clusters
+    static const string OPTION_LAYOUT;
+    // layout with direct and indirect references
+    static const string LAYOUT_CLASSIC;
+    // layout with extents
+    static const string LAYOUT_EXTENTS;
+    // format option - format of directories
+    static const string OPTION_DIRS;
+    // directories with array of items in one cluster
+    static const string DIRS_LINEAR;
+    // directories with hash table of items
+    static const string DIRS_HASH;
+    // values of format options which turn feature on and off
+    static const string OPTION_ON;
+    static const string OPTION_OFF;
+    // format option - data of small files in inodes
+    static const string OPTION_INLINE;
+    // format option - tails of files in shared clusters
+    static const string OPTION_TAILS;
+    // format option - copies share data clusters
+    static const string OPTION_REFLINK;
+    // format option - deduplication of data chunks
+    static const string OPTION_DEDUP;
+    // format option - compression of data chunks
+    static const string OPTION_COMPRESS;
+    // format option - journal of metadata
+    static const string OPTION_JOURNAL;
+    // format option - size of cluster [B]
+    static const string OPTION_CLUSTER;
+    // format option - count of bytes of image per one inode
+    static const string OPTION_INODE_RATIO;
+    // format option - size class which sets defaults of cluster size and inode ratio
+    static const string OPTION_CLASS;
+    // size class of many small files - small clusters and more inodes
+    static const string CLASS_SMALL;
+    // size class of common files - default cluster size and inode ratio
+    static const string CLASS_GENERAL;
+    // size class of few big files - big clusters and less inodes
+    static const string CLASS_MEDIA;
+    // format option - allocation of image file
+    static const string OPTION_ALLOC;
+    // sparse image file (only metadata are written)
+    static const string ALLOC_SPARSE;
+    // space of image file is reserved by file system without writing
+    static const string ALLOC_PREALLOC;
+    // zeros are written to whole image file
+    static const string ALLOC_ZERO;
+    // unknown option msg
+    static const string UNKNOWN_OPTION_MSG;
+    // size is not a number with unit msg
+    static const string INVALID_SIZE_MSG;
+    // image is too small or too big for chosen cluster size and inode ratio msg
+    static const string BAD_LAYOUT_MSG;
+    // there is no space for item in linear directory msg
+    static const string DIR_FULL_MSG;
+    // chosen options exclude each other msg
+    static const string OPTIONS_CONFLICT_MSG;
+    // compressed chunk cannot be decompressed msg
+    static const string CORRUPTED_CHUNK_MSG;
+    // size of area reserved for super block at the start of image [B]
+    static const int SUPER_BLOCK_AREA_SIZE = 512;
+    // image was migrated to current format msg
+    static const string IMAGE_MIGRATED_MSG;
+    // committed transactions of journal were written in place msg
+    static const string JOURNAL_REPLAYED_MSG;
+    // image cannot be mapped to memory, pread and pwrite are used msg
+    static const string MMAP_FAILED_MSG;
+    // O_DIRECT is not supported, page cache is used msg
+    static const string DIRECT_FAILED_MSG;
+    // io_uring is not available, thread pool is used msg
+    static const string URING_FAILED_MSG;
+    // space of image cannot be preallocated, image is sparse msg
+    static const string PREALLOC_FAILED_MSG;
+    // there is not enough memory msg
+    static const string MEMORY_MSG;
+    // item of copied tree cannot be copied msg
+    static const string ITEM_SKIPPED_MSG;
+    // socket of server cannot be opened msg
+    static const string SOCKET_FAILED_MSG;
+    // client of server did not attach file of host msg (server does not open host paths for clients)
+    static const string HOST_FILE_NOT_ATTACHED_MSG;
+    // image cannot be read msg
+    static const string UNKNOWN_IMAGE_MSG;
 };
 
 
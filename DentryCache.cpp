@@ -0,0 +1,92 @@
+#include "DentryCache.h"
+#include "Constants.h"
+#include <string>
+
+using namespace std;
+
+DentryCache::DentryCache(int capacity) {
+    this->capacity = capacity;
+    hits = 0;
+    misses = 0;
+}
+
+bool DentryCache::lookup(int parentInodeIdx, const char *itemName, int *inodeIdx) {
+    lock_guard<mutex> guard(entriesLock);
+    unordered_map<string, list<entry>::iterator>::iterator found = index.find(createKey(parentInodeIdx, itemName));
+    if(found == index.end()) {
+        misses++;
+        return false;
+    }
+
+    // move entry to the front
+    entries.splice(entries.begin(), entries, found->second);
+    *inodeIdx = found->second->inodeIdx;
+    hits++;
+    return true;
+}
+
+void DentryCache::insert(int parentInodeIdx, const char *itemName, int inodeIdx) {
+    lock_guard<mutex> guard(entriesLock);
+    string key = createKey(parentInodeIdx, itemName);
+    unordered_map<string, list<entry>::iterator>::iterator found = index.find(key);
+    if(found != index.end()) {
+        // update existing entry and move it to the front
+        found->second->inodeIdx = inodeIdx;
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+
+    // evict least recently used entry
+    if(entries.size() >= capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    entry newEntry;
+    newEntry.key = key;
+    newEntry.parentInodeIdx = parentInodeIdx;
+    newEntry.inodeIdx = inodeIdx;
+    entries.push_front(newEntry);
+    index[key] = entries.begin();
+}
+
+void DentryCache::invalidateParent(int parentInodeIdx) {
+    lock_guard<mutex> guard(entriesLock);
+    list<entry>::iterator it = entries.begin();
+    while(it != entries.end()) {
+        if(it->parentInodeIdx == parentInodeIdx) {
+            index.erase(it->key);
+            it = entries.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
+
+void DentryCache::clear() {
+    lock_guard<mutex> guard(entriesLock);
+    entries.clear();
+    index.clear();
+}
+
+long long DentryCache::getHits() const {
+    return hits;
+}
+
+long long DentryCache::getMisses() const {
+    return misses;
+}
+
+int DentryCache::getSize() const {
+    return entries.size();
+}
+
+int DentryCache::getCapacity() const {
+    return capacity;
+}
+
+string DentryCache::createKey(int parentInodeIdx, const char *itemName) {
+    // names cannot contain path delimiter, so key is unique
+    return to_string(parentInodeIdx) + Constants::PATH_DELIM + itemName;
+}
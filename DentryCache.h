@@ -0,0 +1,66 @@
+#ifndef ZOS_VFS_DENTRYCACHE_H
+#define ZOS_VFS_DENTRYCACHE_H
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+using namespace std;
+
+/*
+ * Class represents LRU cache of directory entries - inode idx of item by parent inode idx and item name, it can be used by more threads
+ */
+class DentryCache {
+public:
+    // constructor
+    explicit DentryCache(int capacity);
+    // get inode idx of cached item, returns false if it is not cached (inode idx can be INODE_NOT_EXISTS_CODE for cached missing item)
+    bool lookup(int parentInodeIdx, const char *itemName, int *inodeIdx);
+    // cache inode idx of item (INODE_NOT_EXISTS_CODE for missing item)
+    void insert(int parentInodeIdx, const char *itemName, int inodeIdx);
+    // drop all items of given parent
+    void invalidateParent(int parentInodeIdx);
+    // drop all items
+    void clear();
+    // get count of successful lookups
+    long long getHits() const;
+    // get count of unsuccessful lookups
+    long long getMisses() const;
+    // get count of cached items
+    int getSize() const;
+    // get max count of cached items
+    int getCapacity() const;
+
+private:
+    /*
+     * Struct represents one cached entry
+     */
+    typedef struct theEntry {
+        // key - parent inode idx and name
+        string key;
+        // parent inode idx
+        int parentInodeIdx;
+        // inode idx of item
+        int inodeIdx;
+    } entry;
+
+    // max count of cached items
+    int capacity;
+    // entries, most recently used first
+    list<entry> entries;
+    // entries by key
+    unordered_map<string, list<entry>::iterator> index;
+    // count of successful lookups
+    long long hits;
+    // count of unsuccessful lookups
+    long long misses;
+    // lock of entries
+    mutex entriesLock;
+
+    // create key of entry
+    static string createKey(int parentInodeIdx, const char *itemName);
+};
+
+
+#endif
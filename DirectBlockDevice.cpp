@@ -0,0 +1,126 @@
+#include "DirectBlockDevice.h"
+#include "Constants.h"
+#include <iostream>
+#include <cstring>
+#include <stdlib.h>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+DirectBlockDevice::DirectBlockDevice() {
+    direct = false;
+    alignedBuffer = nullptr;
+    alignedBufferSize = 0;
+}
+
+DirectBlockDevice::~DirectBlockDevice() {
+    if(alignedBuffer != nullptr) {
+        free(alignedBuffer);
+    }
+}
+
+bool DirectBlockDevice::open(const char *name) {
+    return openDirect(name, O_RDWR);
+}
+
+bool DirectBlockDevice::create(const char *name, long long bytesSize) {
+    if(!openDirect(name, O_RDWR | O_TRUNC)) {
+        return false;
+    }
+
+    return resize(bytesSize);
+}
+
+bool DirectBlockDevice::resize(long long bytesSize) {
+    // whole aligned blocks are always transferred, so size of image is aligned too
+    long long alignment = Constants::DIRECT_IO_ALIGNMENT;
+    return ftruncate(fd, (bytesSize + alignment - 1) / alignment * alignment) == 0;
+}
+
+void DirectBlockDevice::read(long long address, void *buffer, long long bytesCount) {
+    if(!direct) {
+        PosixBlockDevice::read(address, buffer, bytesCount);
+        return;
+    }
+
+    // read whole aligned blocks containing requested bytes
+    lock_guard<mutex> guard(alignedBufferLock);
+    long long alignment = Constants::DIRECT_IO_ALIGNMENT;
+    long long start = address / alignment * alignment;
+    long long end = (address + bytesCount + alignment - 1) / alignment * alignment;
+    reserveAlignedBuffer(end - start);
+    memset(alignedBuffer, 0, end - start);
+    PosixBlockDevice::read(start, alignedBuffer, end - start);
+    memcpy(buffer, alignedBuffer + (address - start), bytesCount);
+}
+
+void DirectBlockDevice::write(long long address, const void *buffer, long long bytesCount) {
+    if(!direct) {
+        PosixBlockDevice::write(address, buffer, bytesCount);
+        return;
+    }
+
+    lock_guard<mutex> guard(alignedBufferLock);
+    long long alignment = Constants::DIRECT_IO_ALIGNMENT;
+    long long start = address / alignment * alignment;
+    long long end = (address + bytesCount + alignment - 1) / alignment * alignment;
+    reserveAlignedBuffer(end - start);
+
+    // blocks which are written only partially are read first
+    if(start != address) {
+        memset(alignedBuffer, 0, alignment);
+        PosixBlockDevice::read(start, alignedBuffer, alignment);
+    }
+    if(end != address + bytesCount && (end - alignment != start || start == address)) {
+        memset(alignedBuffer + (end - start - alignment), 0, alignment);
+        PosixBlockDevice::read(end - alignment, alignedBuffer + (end - start - alignment), alignment);
+    }
+
+    memcpy(alignedBuffer + (address - start), buffer, bytesCount);
+    PosixBlockDevice::write(start, alignedBuffer, end - start);
+}
+
+void DirectBlockDevice::flush() {
+    if(!direct) {
+        return;
+    }
+
+    // data are written to disk directly, only metadata of file are left
+    fdatasync(fd);
+}
+
+int DirectBlockDevice::getAsyncFd() {
+    // requests must go through aligned buffer
+    return direct ? -1 : fd;
+}
+
+bool DirectBlockDevice::openDirect(const char *name, int flags) {
+    direct = openFile(name, flags | O_DIRECT);
+    if(direct) {
+        return true;
+    }
+
+    // file system does not support O_DIRECT
+    if(!openFile(name, flags)) {
+        return false;
+    }
+    cout << Constants::DIRECT_FAILED_MSG << endl;
+    return true;
+}
+
+void DirectBlockDevice::reserveAlignedBuffer(long long bytesSize) {
+    if(bytesSize <= alignedBufferSize) {
+        return;
+    }
+
+    if(alignedBuffer != nullptr) {
+        free(alignedBuffer);
+    }
+    void *memory = nullptr;
+    if(posix_memalign(&memory, Constants::DIRECT_IO_ALIGNMENT, bytesSize) != 0) {
+        // request which needs it fails, device stays usable
+        throw runtime_error(Constants::MEMORY_MSG);
+    }
+    alignedBuffer = (char *) memory;
+    alignedBufferSize = bytesSize;
+}
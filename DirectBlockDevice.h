@@ -0,0 +1,41 @@
+#ifndef ZOS_VFS_DIRECTBLOCKDEVICE_H
+#define ZOS_VFS_DIRECTBLOCKDEVICE_H
+
+#include <mutex>
+#include "PosixBlockDevice.h"
+
+/*
+ * Class represents image accessed with O_DIRECT (bypassing page cache of system) through aligned buffer
+ */
+class DirectBlockDevice : public PosixBlockDevice {
+public:
+    // constructor
+    DirectBlockDevice();
+    // destructor
+    ~DirectBlockDevice() override;
+    bool open(const char *name) override;
+    bool create(const char *name, long long bytesSize) override;
+    bool resize(long long bytesSize) override;
+    void read(long long address, void *buffer, long long bytesCount) override;
+    void write(long long address, const void *buffer, long long bytesCount) override;
+    void flush() override;
+    int getAsyncFd() override;
+
+private:
+    // if image is really opened with O_DIRECT
+    bool direct;
+    // aligned buffer used for transfers
+    char *alignedBuffer;
+    // size of aligned buffer
+    long long alignedBufferSize;
+    // lock of aligned buffer
+    mutex alignedBufferLock;
+
+    // open file with O_DIRECT, without it if file system does not support it
+    bool openDirect(const char *name, int flags);
+    // make sure aligned buffer has at least given size
+    void reserveAlignedBuffer(long long bytesSize);
+};
+
+
+#endif
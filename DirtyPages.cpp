@@ -0,0 +1,66 @@
+#include "DirtyPages.h"
+#include "Constants.h"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+DirtyPages::DirtyPages() {
+    bytesSize = 0;
+}
+
+void DirtyPages::init(long long bytesSize) {
+    this->bytesSize = bytesSize;
+    pages.assign((bytesSize + Constants::METADATA_PAGE_SIZE - 1) / Constants::METADATA_PAGE_SIZE, false);
+    dirtyPagesIdxs.clear();
+}
+
+void DirtyPages::markBytes(long long offset, long long length) {
+    int firstPage = offset / Constants::METADATA_PAGE_SIZE;
+    int lastPage = (offset + length - 1) / Constants::METADATA_PAGE_SIZE;
+    for(int i = firstPage; i <= lastPage; i++) {
+        if(!pages[i]) {
+            pages[i] = true;
+            dirtyPagesIdxs.push_back(i);
+        }
+    }
+}
+
+void DirtyPages::markAll() {
+    markBytes(0, bytesSize);
+}
+
+void DirtyPages::clear() {
+    for(int i = 0; i < dirtyPagesIdxs.size(); i++) {
+        pages[dirtyPagesIdxs[i]] = false;
+    }
+    dirtyPagesIdxs.clear();
+}
+
+bool DirtyPages::any() const {
+    return !dirtyPagesIdxs.empty();
+}
+
+void DirtyPages::getDirtyRuns(vector<long long> *offsets, vector<long long> *lengths) {
+    sort(dirtyPagesIdxs.begin(), dirtyPagesIdxs.end());
+
+    int i = 0;
+    while(i < dirtyPagesIdxs.size()) {
+        // neighbouring changed pages are joined to one run
+        int runStart = dirtyPagesIdxs[i];
+        int runEnd = runStart + 1;
+        i++;
+        while(i < dirtyPagesIdxs.size() && dirtyPagesIdxs[i] == runEnd) {
+            runEnd++;
+            i++;
+        }
+
+        long long offset = (long long) runStart * Constants::METADATA_PAGE_SIZE;
+        long long end = (long long) runEnd * Constants::METADATA_PAGE_SIZE;
+        if(end > bytesSize) {
+            end = bytesSize;
+        }
+        offsets->push_back(offset);
+        lengths->push_back(end - offset);
+    }
+}
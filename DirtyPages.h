@@ -0,0 +1,38 @@
+#ifndef ZOS_VFS_DIRTYPAGES_H
+#define ZOS_VFS_DIRTYPAGES_H
+
+#include <vector>
+
+using namespace std;
+
+/*
+ * Class tracks which pages of metadata area were changed since it was saved
+ */
+class DirtyPages {
+public:
+    // constructor
+    DirtyPages();
+    // init tracking of area of given size, all pages are clean
+    void init(long long bytesSize);
+    // marks pages with given bytes as changed
+    void markBytes(long long offset, long long length);
+    // marks all pages as changed
+    void markAll();
+    // marks all pages as saved
+    void clear();
+    // checks if any page was changed
+    bool any() const;
+    // get runs of changed pages as byte offsets and lengths (clipped to size of area)
+    void getDirtyRuns(vector<long long> *offsets, vector<long long> *lengths);
+
+private:
+    // size of tracked area [B]
+    long long bytesSize;
+    // flags of changed pages
+    vector<bool> pages;
+    // indexes of changed pages, so clean pages do not have to be iterated
+    vector<int> dirtyPagesIdxs;
+};
+
+
+#endif
@@ -0,0 +1,140 @@
+#include "FragmentAllocator.h"
+#include <algorithm>
+#include "Constants.h"
+
+using namespace std;
+
+// count of bits in one word
+static const int WORD_BITS = 64;
+// mask of all fragments of one cluster
+static const int CLUSTER_MASK = (1 << Constants::FRAGMENTS_PER_CLUSTER) - 1;
+
+FragmentAllocator::FragmentAllocator() {
+    clustersCount = 0;
+    sharedClustersCount = 0;
+    clustersByFreeRun.resize(Constants::FRAGMENTS_PER_CLUSTER);
+}
+
+void FragmentAllocator::init(int clustersCount) {
+    this->clustersCount = clustersCount;
+    fragments.init(clustersCount * Constants::FRAGMENTS_PER_CLUSTER);
+    loaded();
+}
+
+void FragmentAllocator::attach(uint64_t *words, int clustersCount) {
+    this->clustersCount = clustersCount;
+    fragments.attach(words, clustersCount * Constants::FRAGMENTS_PER_CLUSTER);
+    loaded();
+}
+
+void FragmentAllocator::loaded() {
+    fragments.loaded();
+    for(int i = 0; i < clustersByFreeRun.size(); i++) {
+        clustersByFreeRun[i].clear();
+    }
+    sharedClustersCount = 0;
+
+    // find shared clusters, words without used fragments are skipped at once
+    int clustersPerWord = WORD_BITS / Constants::FRAGMENTS_PER_CLUSTER;
+    for(int i = 0; i < clustersCount; i++) {
+        if(i % clustersPerWord == 0 && fragments.getWords()[i / clustersPerWord] == 0) {
+            i += clustersPerWord - 1;
+            continue;
+        }
+        clusterChanged(i, 0, getClusterMask(i));
+    }
+}
+
+int FragmentAllocator::findFree(int fragmentsCount) {
+    // cluster with the shortest sufficient run is used, so longer runs stay for longer tails
+    for(int run = fragmentsCount; run < Constants::FRAGMENTS_PER_CLUSTER; run++) {
+        if(clustersByFreeRun[run].empty()) {
+            continue;
+        }
+
+        int clusterIdx = *clustersByFreeRun[run].begin();
+        int mask = getClusterMask(clusterIdx);
+        int runMask = (1 << fragmentsCount) - 1;
+        for(int i = 0; i + fragmentsCount <= Constants::FRAGMENTS_PER_CLUSTER; i++) {
+            if((mask & (runMask << i)) == 0) {
+                return clusterIdx * Constants::FRAGMENTS_PER_CLUSTER + i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+void FragmentAllocator::setFull(int fragmentIdx, int fragmentsCount) {
+    int clusterIdx = fragmentIdx / Constants::FRAGMENTS_PER_CLUSTER;
+    int oldMask = getClusterMask(clusterIdx);
+    fragments.setFullRange(fragmentIdx, fragmentsCount);
+    clusterChanged(clusterIdx, oldMask, getClusterMask(clusterIdx));
+}
+
+bool FragmentAllocator::setEmpty(int fragmentIdx, int fragmentsCount) {
+    int clusterIdx = fragmentIdx / Constants::FRAGMENTS_PER_CLUSTER;
+    int oldMask = getClusterMask(clusterIdx);
+    for(int i = 0; i < fragmentsCount; i++) {
+        fragments.setEmpty(fragmentIdx + i);
+    }
+    int newMask = getClusterMask(clusterIdx);
+    clusterChanged(clusterIdx, oldMask, newMask);
+
+    return newMask == 0;
+}
+
+bool FragmentAllocator::isFull(int fragmentIdx) const {
+    return fragments.isFull(fragmentIdx);
+}
+
+int FragmentAllocator::getSharedClustersCount() const {
+    return sharedClustersCount;
+}
+
+uint64_t *FragmentAllocator::getWords() {
+    return fragments.getWords();
+}
+
+int FragmentAllocator::getBytesSize() const {
+    return fragments.getBytesSize();
+}
+
+int FragmentAllocator::bytesSizeFor(int clustersCount) {
+    return Bitmap::bytesSizeFor(clustersCount * Constants::FRAGMENTS_PER_CLUSTER);
+}
+
+DirtyPages &FragmentAllocator::getDirtyPages() {
+    return fragments.getDirtyPages();
+}
+
+int FragmentAllocator::getClusterMask(int clusterIdx) {
+    long long firstBit = (long long) clusterIdx * Constants::FRAGMENTS_PER_CLUSTER;
+    return (fragments.getWords()[firstBit / WORD_BITS] >> (firstBit % WORD_BITS)) & CLUSTER_MASK;
+}
+
+int FragmentAllocator::longestFreeRun(int mask) {
+    int longest = 0;
+    int current = 0;
+    for(int i = 0; i < Constants::FRAGMENTS_PER_CLUSTER; i++) {
+        if(mask & (1 << i)) {
+            current = 0;
+        }
+        else {
+            current++;
+            longest = max(longest, current);
+        }
+    }
+    return longest;
+}
+
+void FragmentAllocator::clusterChanged(int clusterIdx, int oldMask, int newMask) {
+    // free cluster is not shared, full cluster cannot take more fragments
+    if(oldMask != 0 && longestFreeRun(oldMask) > 0) {
+        clustersByFreeRun[longestFreeRun(oldMask)].erase(clusterIdx);
+    }
+    if(newMask != 0 && longestFreeRun(newMask) > 0) {
+        clustersByFreeRun[longestFreeRun(newMask)].insert(clusterIdx);
+    }
+    sharedClustersCount += (newMask != 0) - (oldMask != 0);
+}
@@ -0,0 +1,63 @@
+#ifndef ZOS_VFS_FRAGMENTALLOCATOR_H
+#define ZOS_VFS_FRAGMENTALLOCATOR_H
+
+#include <cstdint>
+#include <set>
+#include <vector>
+#include "Bitmap.h"
+
+using namespace std;
+
+/*
+ * Class represents allocator of fragments of data clusters which are shared by tails of files,
+ * every cluster has FRAGMENTS_PER_CLUSTER bits in bitmap, clusters with free fragments are kept by their longest free run
+ */
+class FragmentAllocator {
+public:
+    // constructor
+    FragmentAllocator();
+    // allocates bitmap for given count of clusters, all fragments are free
+    void init(int clustersCount);
+    // uses words owned by someone else (e.g. mapped image) for given count of clusters
+    void attach(uint64_t *words, int clustersCount);
+    // must be called after words were loaded from outside - finds clusters with free fragments
+    void loaded();
+    // get index of first fragment of free run of given length in already shared cluster, -1 if there is none
+    int findFree(int fragmentsCount);
+    // marks count of fragments starting at idx as used (all of them are in one cluster)
+    void setFull(int fragmentIdx, int fragmentsCount);
+    // marks count of fragments starting at idx as free, returns true if whole cluster is free now
+    bool setEmpty(int fragmentIdx, int fragmentsCount);
+    // checks if fragment is used
+    bool isFull(int fragmentIdx) const;
+    // get count of clusters which hold some fragments
+    int getSharedClustersCount() const;
+    // get words of bitmap (used for saving and loading)
+    uint64_t *getWords();
+    // get size of bitmap in bytes (whole words)
+    int getBytesSize() const;
+    // get size of bitmap in bytes for given count of clusters
+    static int bytesSizeFor(int clustersCount);
+    // get pages of words changed since bitmap was saved
+    DirtyPages &getDirtyPages();
+
+private:
+    // bits of fragments, bit set = fragment used
+    Bitmap fragments;
+    // count of clusters
+    int clustersCount;
+    // clusters with some used and some free fragments by length of their longest free run
+    vector<set<int>> clustersByFreeRun;
+    // count of clusters which hold some fragments
+    int sharedClustersCount;
+
+    // get bits of fragments of cluster
+    int getClusterMask(int clusterIdx);
+    // get length of longest run of free fragments in mask of cluster
+    static int longestFreeRun(int mask);
+    // moves cluster to the right set after its mask was changed
+    void clusterChanged(int clusterIdx, int oldMask, int newMask);
+};
+
+
+#endif
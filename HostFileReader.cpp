@@ -0,0 +1,110 @@
+#include "HostFileReader.h"
+#include <stdlib.h>
+
+HostFileReader::HostFileReader(const vector<string> &paths, int buffersCount, int bufferSize, int reservedBuffers, int threadsCount) {
+    this->paths = paths;
+    this->bufferSize = bufferSize;
+    this->reservedBuffers = reservedBuffers;
+    buffers = (char *) malloc((long long) buffersCount * bufferSize * sizeof(char));
+    for(int i = buffersCount - 1; i >= 0; i--) {
+        freeBuffers.push_back(i);
+    }
+    prefetchedFile notRead = {nullptr, -1, -1, 0, false};
+    files.assign(paths.size(), notRead);
+    nextFileIdx = 0;
+    nextTakenIdx = 0;
+    stopping = false;
+
+    // more threads than files would not have work
+    for(int i = 0; i < threadsCount && i < paths.size(); i++) {
+        workers.emplace_back(&HostFileReader::work, this);
+    }
+}
+
+HostFileReader::~HostFileReader() {
+    {
+        lock_guard<mutex> guard(readerLock);
+        stopping = true;
+    }
+    bufferReleased.notify_all();
+    for(int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    for(int i = nextTakenIdx; i < files.size(); i++) {
+        if(files[i].file != nullptr) {
+            fclose(files[i].file);
+        }
+    }
+    free(buffers);
+}
+
+bool HostFileReader::isRead(int fileIdx) {
+    lock_guard<mutex> guard(readerLock);
+    return files[fileIdx].read;
+}
+
+prefetchedFile HostFileReader::take(int fileIdx) {
+    unique_lock<mutex> guard(readerLock);
+    fileRead.wait(guard, [this, fileIdx] { return files[fileIdx].read; });
+    nextTakenIdx = fileIdx + 1;
+    return files[fileIdx];
+}
+
+char *HostFileReader::getBuffer(int bufferIdx) {
+    return buffers + (long long) bufferIdx * bufferSize;
+}
+
+int HostFileReader::tryAcquireBuffer() {
+    lock_guard<mutex> guard(readerLock);
+    if(freeBuffers.empty()) {
+        return -1;
+    }
+    int bufferIdx = freeBuffers.back();
+    freeBuffers.pop_back();
+    return bufferIdx;
+}
+
+void HostFileReader::releaseBuffer(int bufferIdx) {
+    {
+        lock_guard<mutex> guard(readerLock);
+        freeBuffers.push_back(bufferIdx);
+    }
+    bufferReleased.notify_one();
+}
+
+void HostFileReader::work() {
+    while(true) {
+        // files get buffers in order, so file which is taken next is never left without buffer
+        int fileIdx;
+        int bufferIdx;
+        {
+            unique_lock<mutex> guard(readerLock);
+            bufferReleased.wait(guard, [this] {
+                return stopping || nextFileIdx == files.size() || freeBuffers.size() > reservedBuffers;
+            });
+            if(stopping || nextFileIdx == files.size()) {
+                return;
+            }
+            fileIdx = nextFileIdx++;
+            bufferIdx = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+
+        // read the first bytes of file, size of pipe is not known
+        prefetchedFile prefetched = {fopen(paths[fileIdx].c_str(), "rb"), -1, bufferIdx, 0, true};
+        if(prefetched.file != nullptr) {
+            if(fseeko(prefetched.file, 0, SEEK_END) == 0) {
+                prefetched.size = ftello(prefetched.file);
+                fseeko(prefetched.file, 0, SEEK_SET);
+            }
+            prefetched.bytesCount = fread(getBuffer(bufferIdx), sizeof(char), bufferSize, prefetched.file);
+        }
+
+        {
+            lock_guard<mutex> guard(readerLock);
+            files[fileIdx] = prefetched;
+        }
+        fileRead.notify_all();
+    }
+}
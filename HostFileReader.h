@@ -0,0 +1,83 @@
+#ifndef ZOS_VFS_HOSTFILEREADER_H
+#define ZOS_VFS_HOSTFILEREADER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+
+using namespace std;
+
+/*
+ * Struct represents file of host whose first bytes were read by worker
+ */
+struct prefetchedFile {
+    // opened file, nullptr if it cannot be opened
+    FILE *file;
+    // size of file [B], -1 if it is not known (pipe)
+    long long size;
+    // index of buffer with first bytes of file
+    int bufferIdx;
+    // count of bytes in buffer
+    int bytesCount;
+    // true when worker read the first bytes
+    bool read;
+};
+
+/*
+ * Class represents pool of workers which read files of host ahead - files are read in order of their indexes, every file
+ * gets one buffer from pool and keeps it until it is released, some buffers are kept for reads of the rest of big files
+ */
+class HostFileReader {
+public:
+    // constructor - workers start reading files with given paths
+    HostFileReader(const vector<string> &paths, int buffersCount, int bufferSize, int reservedBuffers, int threadsCount);
+    // destructor - workers are stopped, files which were not taken are closed
+    ~HostFileReader();
+    // checks if the first bytes of file with given index are read
+    bool isRead(int fileIdx);
+    // waits until file with given index is read and takes it - its buffer and file must be released by caller
+    prefetchedFile take(int fileIdx);
+    // get buffer with given index
+    char *getBuffer(int bufferIdx);
+    // takes free buffer (reserved buffers can be taken too), -1 if there is none
+    int tryAcquireBuffer();
+    // returns buffer to pool, so it can be used for another file
+    void releaseBuffer(int bufferIdx);
+
+private:
+    // paths of files
+    vector<string> paths;
+    // files read ahead
+    vector<prefetchedFile> files;
+    // size of one buffer [B]
+    int bufferSize;
+    // count of buffers which workers do not use
+    int reservedBuffers;
+    // memory of buffers (buffer after buffer)
+    char *buffers;
+    // free buffers
+    vector<int> freeBuffers;
+    // index of next file which is not read
+    int nextFileIdx;
+    // index of next file which is not taken
+    int nextTakenIdx;
+    // true when workers should end
+    bool stopping;
+    // lock of files and buffers
+    mutex readerLock;
+    // announces buffer was released
+    condition_variable bufferReleased;
+    // announces file was read
+    condition_variable fileRead;
+    // threads of workers
+    vector<thread> workers;
+
+    // reads files until all files are read or reader is stopped
+    void work();
+};
+
+
+#endif
@@ -0,0 +1,122 @@
+#include "IOEngine.h"
+#include "Constants.h"
+#include "UringIOEngine.h"
+#include "ThreadPoolIOEngine.h"
+#include <iostream>
+#include <unistd.h>
+
+IOEngine::IOEngine(BlockDevice *device, int queueDepth) {
+    this->device = device;
+    this->queueDepth = queueDepth;
+    inFlight = 0;
+}
+
+void IOEngine::submitRead(long long address, void *buffer, int bytesCount, int tag) {
+    submit(false, address, (char *) buffer, bytesCount, tag);
+}
+
+void IOEngine::submitWrite(long long address, const void *buffer, int bytesCount, int tag) {
+    submit(true, address, (char *) buffer, bytesCount, tag);
+}
+
+int IOEngine::waitCompletion() {
+    // request finished earlier
+    if(!completedTags.empty()) {
+        int tag = completedTags.front();
+        completedTags.pop_front();
+        return tag;
+    }
+
+    if(inFlight == 0) {
+        return -1;
+    }
+
+    inFlight--;
+    return reapCompletion();
+}
+
+void IOEngine::drain() {
+    while(waitCompletion() != -1) {
+    }
+}
+
+int IOEngine::getQueueDepth() const {
+    return queueDepth;
+}
+
+IOEngine *IOEngine::forName(const string &name, BlockDevice *device, int queueDepth) {
+    if(name == Constants::IO_SYNC) {
+        return new IOEngine(device, queueDepth);
+    }
+    if(name == Constants::IO_URING) {
+        UringIOEngine *engine = new UringIOEngine(device, queueDepth);
+        if(engine->init()) {
+            return engine;
+        }
+
+        // kernel does not provide io_uring
+        delete engine;
+        cout << Constants::URING_FAILED_MSG << endl;
+        return new ThreadPoolIOEngine(device, queueDepth);
+    }
+    if(name == Constants::IO_THREADS) {
+        return new ThreadPoolIOEngine(device, queueDepth);
+    }
+
+    // unknown engine
+    return nullptr;
+}
+
+bool IOEngine::startRequest(const ioRequest &) {
+    return false;
+}
+
+int IOEngine::reapCompletion() {
+    return -1;
+}
+
+void IOEngine::transfer(const ioRequest &request) {
+    // transfer can be done partially, the rest is transferred again
+    char *buffer = request.buffer;
+    long long address = request.address;
+    int bytesCount = request.bytesCount;
+    while(bytesCount > 0) {
+        ssize_t bytesDone;
+        if(request.write) {
+            bytesDone = pwrite(request.fd, buffer, bytesCount, address);
+        }
+        else {
+            bytesDone = pread(request.fd, buffer, bytesCount, address);
+        }
+        if(bytesDone <= 0) {
+            return;
+        }
+        buffer += bytesDone;
+        address += bytesDone;
+        bytesCount -= bytesDone;
+    }
+}
+
+void IOEngine::submit(bool write, long long address, char *buffer, int bytesCount, int tag) {
+    ioRequest request = {write, device->getAsyncFd(), address, buffer, bytesCount, tag};
+
+    // queue is full - wait for one request
+    if(request.fd != -1 && inFlight >= queueDepth) {
+        completedTags.push_back(reapCompletion());
+        inFlight--;
+    }
+
+    if(request.fd != -1 && startRequest(request)) {
+        inFlight++;
+        return;
+    }
+
+    // device cannot be accessed asynchronously (or engine is synchronous)
+    if(write) {
+        device->write(address, buffer, bytesCount);
+    }
+    else {
+        device->read(address, buffer, bytesCount);
+    }
+    completedTags.push_back(tag);
+}
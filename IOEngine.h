@@ -0,0 +1,74 @@
+#ifndef ZOS_VFS_IOENGINE_H
+#define ZOS_VFS_IOENGINE_H
+
+#include <string>
+#include <deque>
+#include "BlockDevice.h"
+
+using namespace std;
+
+/*
+ * Structure of one read or write request of image
+ */
+struct ioRequest {
+    // true for write, false for read
+    bool write;
+    // file descriptor of image
+    int fd;
+    // address in image
+    long long address;
+    // data
+    char *buffer;
+    // count of bytes
+    int bytesCount;
+    // tag of request, it is returned when request is finished
+    int tag;
+};
+
+/*
+ * Class represents engine which keeps reads and writes of image in flight, base class does them synchronously
+ */
+class IOEngine {
+public:
+    // constructor
+    IOEngine(BlockDevice *device, int queueDepth);
+    // destructor
+    virtual ~IOEngine() = default;
+    // start reading bytes from image to buffer (buffer must not be used until request is finished)
+    void submitRead(long long address, void *buffer, int bytesCount, int tag);
+    // start writing bytes from buffer to image (buffer must not be changed until request is finished)
+    void submitWrite(long long address, const void *buffer, int bytesCount, int tag);
+    // wait for any request to finish and get its tag, -1 if there is no request
+    int waitCompletion();
+    // wait for all requests to finish
+    void drain();
+    // get count of requests which can be in flight at once
+    int getQueueDepth() const;
+    // create engine for given name, nullptr if engine is unknown
+    static IOEngine *forName(const string &name, BlockDevice *device, int queueDepth);
+
+protected:
+    // storage of image
+    BlockDevice *device;
+    // count of requests which can be in flight at once
+    int queueDepth;
+
+    // start request, false if it must be done synchronously
+    virtual bool startRequest(const ioRequest &request);
+    // wait for started request to finish and get its tag
+    virtual int reapCompletion();
+    // do the request synchronously with pread/pwrite
+    static void transfer(const ioRequest &request);
+
+private:
+    // count of started requests which were not reaped
+    int inFlight;
+    // tags of finished requests which were not returned
+    deque<int> completedTags;
+
+    // submit request of given type
+    void submit(bool write, long long address, char *buffer, int bytesCount, int tag);
+};
+
+
+#endif
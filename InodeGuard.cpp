@@ -0,0 +1,40 @@
+#include "InodeGuard.h"
+
+using namespace std;
+
+InodeGuard::InodeGuard(InodeLocks *locks) {
+    this->locks = locks;
+    shared = false;
+}
+
+InodeGuard::~InodeGuard() {
+    unlock();
+}
+
+void InodeGuard::lock(const vector<int> &inodeIdxs) {
+    unlock();
+    locks->lock(inodeIdxs);
+    lockedIdxs = inodeIdxs;
+    shared = false;
+}
+
+void InodeGuard::lockShared(int inodeIdx) {
+    unlock();
+    locks->lockShared(inodeIdx);
+    lockedIdxs.push_back(inodeIdx);
+    shared = true;
+}
+
+void InodeGuard::unlock() {
+    if(lockedIdxs.empty()) {
+        return;
+    }
+
+    if(shared) {
+        locks->unlockShared(lockedIdxs[0]);
+    }
+    else {
+        locks->unlock(lockedIdxs);
+    }
+    lockedIdxs.clear();
+}
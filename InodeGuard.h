@@ -0,0 +1,39 @@
+#ifndef ZOS_VFS_INODEGUARD_H
+#define ZOS_VFS_INODEGUARD_H
+
+#include <vector>
+#include "InodeLocks.h"
+
+using namespace std;
+
+/*
+ * Class represents inodes locked by one command - guard holds one group of locks at once (new group is locked after the previous one is unlocked),
+ * locks are unlocked when guard is destroyed (also when command fails)
+ */
+class InodeGuard {
+public:
+    // constructor - nothing is locked
+    explicit InodeGuard(InodeLocks *locks);
+    // destructor - locked inodes are unlocked
+    ~InodeGuard();
+    // guard holds locks, so it cannot be copied
+    InodeGuard(const InodeGuard &) = delete;
+    InodeGuard &operator=(const InodeGuard &) = delete;
+    // locks inodes for changes
+    void lock(const vector<int> &inodeIdxs);
+    // locks inode for reading
+    void lockShared(int inodeIdx);
+    // unlocks locked inodes
+    void unlock();
+
+private:
+    // table of locks
+    InodeLocks *locks;
+    // locked inodes
+    vector<int> lockedIdxs;
+    // true if inodes are locked for reading
+    bool shared;
+};
+
+
+#endif
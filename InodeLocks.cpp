@@ -0,0 +1,36 @@
+#include "InodeLocks.h"
+#include <algorithm>
+
+using namespace std;
+
+void InodeLocks::lockShared(int inodeIdx) {
+    locks[inodeIdx % Constants::INODE_LOCKS_COUNT].lock_shared();
+}
+
+void InodeLocks::unlockShared(int inodeIdx) {
+    locks[inodeIdx % Constants::INODE_LOCKS_COUNT].unlock_shared();
+}
+
+void InodeLocks::lock(const vector<int> &inodeIdxs) {
+    vector<int> locksIdxs = getLocksIdxs(inodeIdxs);
+    for(int i = 0; i < locksIdxs.size(); i++) {
+        locks[locksIdxs[i]].lock();
+    }
+}
+
+void InodeLocks::unlock(const vector<int> &inodeIdxs) {
+    vector<int> locksIdxs = getLocksIdxs(inodeIdxs);
+    for(int i = locksIdxs.size() - 1; i >= 0; i--) {
+        locks[locksIdxs[i]].unlock();
+    }
+}
+
+vector<int> InodeLocks::getLocksIdxs(const vector<int> &inodeIdxs) {
+    vector<int> locksIdxs;
+    for(int i = 0; i < inodeIdxs.size(); i++) {
+        locksIdxs.push_back(inodeIdxs[i] % Constants::INODE_LOCKS_COUNT);
+    }
+    sort(locksIdxs.begin(), locksIdxs.end());
+    locksIdxs.erase(unique(locksIdxs.begin(), locksIdxs.end()), locksIdxs.end());
+    return locksIdxs;
+}
@@ -0,0 +1,34 @@
+#ifndef ZOS_VFS_INODELOCKS_H
+#define ZOS_VFS_INODELOCKS_H
+
+#include <vector>
+#include <shared_mutex>
+#include "Constants.h"
+
+using namespace std;
+
+/*
+ * Class represents locks of inodes - inodes share locks of fixed table (inode idx modulo size of table), item can be read by more threads at once
+ * and changed by one thread, more inodes are locked in order of their locks, so threads never wait for each other in cycle
+ */
+class InodeLocks {
+public:
+    // locks inode for reading
+    void lockShared(int inodeIdx);
+    // unlocks inode locked for reading
+    void unlockShared(int inodeIdx);
+    // locks inodes for changes
+    void lock(const vector<int> &inodeIdxs);
+    // unlocks inodes locked for changes
+    void unlock(const vector<int> &inodeIdxs);
+
+private:
+    // table of locks
+    shared_timed_mutex locks[Constants::INODE_LOCKS_COUNT];
+
+    // get indexes of locks of inodes in order, lock shared by more inodes is there once
+    static vector<int> getLocksIdxs(const vector<int> &inodeIdxs);
+};
+
+
+#endif
@@ -0,0 +1,489 @@
+#include "Journal.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// magic number of journal and its transactions
+static const uint32_t JOURNAL_MAGIC = 0x4A524E4C;
+// journal and transactions are aligned to blocks [B], the first block holds header of journal
+static const int JOURNAL_BLOCK_SIZE = 512;
+// record with changed bytes
+static const int RECORD_CHANGE = 0;
+// record with revoked range
+static const int RECORD_REVOKE = 1;
+// odd constants which mix words of checksum
+static const uint64_t CHECKSUM_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t CHECKSUM_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+/*
+ * Header of journal - transactions which may need replay start at given offset
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    long long firstSequence;
+    long long firstOffset;
+} journalHeader;
+
+/*
+ * Header of transaction in journal, checksum covers whole transaction (with zero checksum)
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t recordsCount;
+    uint64_t checksum;
+    long long sequence;
+    // transactions up to this sequence are in place
+    long long checkpointed;
+    // size of transaction with header and padding
+    long long bytesCount;
+} transactionHeader;
+
+/*
+ * Header of record in transaction - changed bytes follow header of change record
+ */
+typedef struct {
+    long long address;
+    long long bytesCount;
+    int type;
+    int reserved;
+} recordHeader;
+
+Journal::Journal() {
+    device = nullptr;
+    address = 0;
+    size = 0;
+    active = false;
+    pendingBytes = 0;
+    sequence = 1;
+    head = JOURNAL_BLOCK_SIZE;
+    commitsCount = 0;
+    journaledBytes = 0;
+    barriersCount = 0;
+    savepointSet = false;
+    savepointPendingBytes = 0;
+    savepointRevokedCount = 0;
+}
+
+void Journal::open(BlockDevice *device, long long address, long long size, bool active) {
+    this->device = device;
+    this->address = address;
+    this->size = size;
+    this->active = active && size > 0;
+    sequence = 1;
+    head = JOURNAL_BLOCK_SIZE;
+    clear();
+}
+
+void Journal::format() {
+    if(size == 0) {
+        return;
+    }
+    sequence = 1;
+    head = JOURNAL_BLOCK_SIZE;
+    writeHeader(sequence, head);
+}
+
+int Journal::replay() {
+    if(size == 0) {
+        return 0;
+    }
+    journalHeader header;
+    device->read(address, &header, sizeof(journalHeader));
+    if(header.magic != JOURNAL_MAGIC) {
+        return 0;
+    }
+
+    // committed transactions follow each other from the first one, torn transaction has bad checksum
+    vector<string> transactions;
+    sequence = header.firstSequence;
+    head = header.firstOffset;
+    while(head >= JOURNAL_BLOCK_SIZE && head + (long long) sizeof(transactionHeader) <= size) {
+        transactionHeader transaction;
+        device->read(address + head, &transaction, sizeof(transactionHeader));
+        if(transaction.magic != JOURNAL_MAGIC || transaction.sequence != sequence || transaction.bytesCount < (long long) sizeof(transactionHeader)
+                || transaction.bytesCount > size - head) {
+            break;
+        }
+        string bytes(transaction.bytesCount, '\0');
+        device->read(address + head, &bytes[0], transaction.bytesCount);
+        memset(&bytes[offsetof(transactionHeader, checksum)], 0, sizeof(uint64_t));
+        if(checksum(bytes.data(), bytes.size()) != transaction.checksum) {
+            break;
+        }
+        transactions.push_back(bytes);
+        head += transaction.bytesCount;
+        sequence++;
+    }
+    if(transactions.empty()) {
+        return 0;
+    }
+
+    // transactions which were in place when the last one was committed are skipped
+    transactionHeader last;
+    memcpy(&last, transactions.back().data(), sizeof(transactionHeader));
+    int first = 0;
+    while(sequence - (long long) transactions.size() + first <= last.checkpointed) {
+        first++;
+    }
+
+    // read records of transactions
+    vector<vector<recordHeader>> records(transactions.size());
+    vector<vector<long long>> dataOffsets(transactions.size());
+    for(int i = first; i < transactions.size(); i++) {
+        transactionHeader transaction;
+        memcpy(&transaction, transactions[i].data(), sizeof(transactionHeader));
+        long long offset = sizeof(transactionHeader);
+        for(int j = 0; j < transaction.recordsCount; j++) {
+            recordHeader record;
+            memcpy(&record, transactions[i].data() + offset, sizeof(recordHeader));
+            offset += sizeof(recordHeader);
+            records[i].push_back(record);
+            dataOffsets[i].push_back(offset);
+            if(record.type == RECORD_CHANGE) {
+                offset += record.bytesCount;
+            }
+        }
+    }
+
+    // apply changes in order, parts revoked by newer transactions are skipped
+    for(int i = first; i < transactions.size(); i++) {
+        for(int j = 0; j < records[i].size(); j++) {
+            if(records[i][j].type != RECORD_CHANGE) {
+                continue;
+            }
+            vector<pair<long long, long long>> parts;
+            parts.push_back(make_pair(records[i][j].address, records[i][j].address + records[i][j].bytesCount));
+            for(int k = i + 1; k < transactions.size(); k++) {
+                for(int l = 0; l < records[k].size(); l++) {
+                    if(records[k][l].type != RECORD_REVOKE) {
+                        continue;
+                    }
+                    long long revokedStart = records[k][l].address;
+                    long long revokedEnd = revokedStart + records[k][l].bytesCount;
+                    vector<pair<long long, long long>> kept;
+                    for(int m = 0; m < parts.size(); m++) {
+                        if(parts[m].first < revokedStart) {
+                            kept.push_back(make_pair(parts[m].first, min(parts[m].second, revokedStart)));
+                        }
+                        if(parts[m].second > revokedEnd) {
+                            kept.push_back(make_pair(max(parts[m].first, revokedEnd), parts[m].second));
+                        }
+                    }
+                    parts = kept;
+                }
+            }
+            for(int m = 0; m < parts.size(); m++) {
+                device->write(parts[m].first, transactions[i].data() + dataOffsets[i][j] + (parts[m].first - records[i][j].address),
+                        parts[m].second - parts[m].first);
+            }
+        }
+    }
+
+    // replayed changes are in place, journal is empty
+    device->sync();
+    writeHeader(sequence, head);
+    device->sync();
+    barriersCount += 2;
+    return transactions.size() - first;
+}
+
+void Journal::close() {
+    if(!active) {
+        return;
+    }
+
+    // all changes are in place after barrier, so nothing has to be replayed
+    commit();
+    device->sync();
+    barriersCount++;
+    writeHeader(sequence, head);
+}
+
+void Journal::write(long long address, const void *buffer, long long bytesCount) {
+    lock_guard<mutex> guard(changesLock);
+    if(!active) {
+        device->write(address, buffer, bytesCount);
+        return;
+    }
+
+    // new bytes are merged with changes they overlap or touch
+    long long start = address;
+    long long end = address + bytesCount;
+    string merged((const char *) buffer, bytesCount);
+    map<long long, string>::iterator it = changes.lower_bound(address);
+    if(it != changes.begin()) {
+        map<long long, string>::iterator previous = prev(it);
+        if(previous->first + (long long) previous->second.size() >= address) {
+            it = previous;
+        }
+    }
+    while(it != changes.end() && it->first <= address + bytesCount) {
+        long long changeEnd = it->first + it->second.size();
+        if(it->first < start) {
+            merged = it->second.substr(0, start - it->first) + merged;
+            start = it->first;
+        }
+        if(changeEnd > end) {
+            merged += it->second.substr(end - it->first);
+            end = changeEnd;
+        }
+        it = removeChange(it);
+    }
+    addChange(start, merged);
+}
+
+void Journal::revoke(long long address, long long bytesCount) {
+    lock_guard<mutex> guard(changesLock);
+    if(!active) {
+        return;
+    }
+
+    // changes in range are dropped, their parts out of range stay
+    long long end = address + bytesCount;
+    map<long long, string>::iterator it = changes.lower_bound(address);
+    if(it != changes.begin()) {
+        map<long long, string>::iterator previous = prev(it);
+        if(previous->first + (long long) previous->second.size() > address) {
+            it = previous;
+        }
+    }
+    while(it != changes.end() && it->first < end) {
+        long long changeStart = it->first;
+        string bytes = it->second;
+        long long changeEnd = changeStart + bytes.size();
+        it = removeChange(it);
+        if(changeStart < address) {
+            addChange(changeStart, bytes.substr(0, address - changeStart));
+        }
+        if(changeEnd > end) {
+            addChange(end, bytes.substr(end - changeStart));
+            break;
+        }
+    }
+    revoked.push_back(make_pair(address, bytesCount));
+}
+
+void Journal::patch(long long address, void *buffer, long long bytesCount) const {
+    lock_guard<mutex> guard(changesLock);
+    if(changes.empty()) {
+        return;
+    }
+
+    long long end = address + bytesCount;
+    map<long long, string>::const_iterator it = changes.lower_bound(address);
+    if(it != changes.begin()) {
+        map<long long, string>::const_iterator previous = prev(it);
+        if(previous->first + (long long) previous->second.size() > address) {
+            it = previous;
+        }
+    }
+    for(; it != changes.end() && it->first < end; it++) {
+        long long start = max(address, it->first);
+        long long changeEnd = min(end, it->first + (long long) it->second.size());
+        memcpy((char *) buffer + (start - address), it->second.data() + (start - it->first), changeEnd - start);
+    }
+}
+
+void Journal::commit() {
+    if(!active) {
+        // changes are already in image
+        device->flush();
+        return;
+    }
+    lock_guard<mutex> guard(changesLock);
+    if(changes.empty() && revoked.empty()) {
+        return;
+    }
+
+    // transaction which does not fit to journal is split to pieces which are committed one after another, every piece is atomic
+    long long pieceSize = (size - JOURNAL_BLOCK_SIZE) / JOURNAL_BLOCK_SIZE * JOURNAL_BLOCK_SIZE;
+    string transaction(sizeof(transactionHeader), '\0');
+    int recordsCount = 0;
+    for(int i = 0; i < revoked.size(); i++) {
+        if(transaction.size() + sizeof(recordHeader) > pieceSize) {
+            writeTransaction(&transaction, &recordsCount);
+        }
+        recordHeader record = {revoked[i].first, revoked[i].second, RECORD_REVOKE, 0};
+        transaction.append((const char *) &record, sizeof(recordHeader));
+        recordsCount++;
+    }
+    for(map<long long, string>::iterator it = changes.begin(); it != changes.end(); it++) {
+        // change is split if it does not fit to the rest of piece
+        long long offset = 0;
+        while(offset < (long long) it->second.size()) {
+            long long freeBytes = pieceSize - (long long) transaction.size() - (long long) sizeof(recordHeader);
+            if(freeBytes <= 0) {
+                writeTransaction(&transaction, &recordsCount);
+                continue;
+            }
+            long long bytesCount = min(freeBytes, (long long) it->second.size() - offset);
+            recordHeader record = {it->first + offset, bytesCount, RECORD_CHANGE, 0};
+            transaction.append((const char *) &record, sizeof(recordHeader));
+            transaction.append(it->second, offset, bytesCount);
+            recordsCount++;
+            offset += bytesCount;
+        }
+    }
+    writeTransaction(&transaction, &recordsCount);
+
+    commitsCount++;
+    clear();
+}
+
+void Journal::savepoint() {
+    lock_guard<mutex> guard(changesLock);
+    savepointSet = true;
+    undoLog.clear();
+    savepointPendingBytes = pendingBytes;
+    savepointRevokedCount = revoked.size();
+}
+
+void Journal::abort() {
+    lock_guard<mutex> guard(changesLock);
+    if(!savepointSet) {
+        clear();
+        return;
+    }
+
+    // changes made after savepoint are undone from the last one, savepoint stays
+    for(int i = undoLog.size() - 1; i >= 0; i--) {
+        if(undoLog[i].added) {
+            changes.erase(undoLog[i].address);
+        }
+        else {
+            changes[undoLog[i].address] = undoLog[i].bytes;
+        }
+    }
+    undoLog.clear();
+    revoked.resize(savepointRevokedCount);
+    pendingBytes = savepointPendingBytes;
+}
+
+long long Journal::getPendingBytes() const {
+    lock_guard<mutex> guard(changesLock);
+    return pendingBytes;
+}
+
+long long Journal::getSize() const {
+    return size;
+}
+
+bool Journal::isActive() const {
+    return active;
+}
+
+long long Journal::getCommitsCount() const {
+    return commitsCount;
+}
+
+long long Journal::getJournaledBytes() const {
+    return journaledBytes;
+}
+
+long long Journal::getBarriersCount() const {
+    return barriersCount;
+}
+
+void Journal::writeHeader(long long firstSequence, long long firstOffset) {
+    char block[JOURNAL_BLOCK_SIZE];
+    memset(block, 0, JOURNAL_BLOCK_SIZE);
+    journalHeader header = {JOURNAL_MAGIC, 0, firstSequence, firstOffset};
+    memcpy(block, &header, sizeof(journalHeader));
+    device->write(address, block, JOURNAL_BLOCK_SIZE);
+}
+
+void Journal::writeTransaction(string *transaction, int *recordsCount) {
+    if(*recordsCount == 0) {
+        return;
+    }
+
+    // padding to whole block
+    transaction->resize((transaction->size() + JOURNAL_BLOCK_SIZE - 1) / JOURNAL_BLOCK_SIZE * JOURNAL_BLOCK_SIZE, '\0');
+
+    if(head + (long long) transaction->size() > size) {
+        // ring wraps - older transactions must be in place before they are overwritten
+        device->sync();
+        barriersCount++;
+        head = JOURNAL_BLOCK_SIZE;
+        writeHeader(sequence, head);
+    }
+
+    transactionHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.recordsCount = *recordsCount;
+    header.checksum = 0;
+    header.sequence = sequence;
+    // changes of previous transaction are made durable by barrier of this one
+    header.checkpointed = sequence - 2;
+    header.bytesCount = transaction->size();
+    memcpy(&(*transaction)[0], &header, sizeof(transactionHeader));
+    header.checksum = checksum(transaction->data(), transaction->size());
+    memcpy(&(*transaction)[0], &header, sizeof(transactionHeader));
+
+    // one sequential write and one barrier, changes are written in place without waiting
+    device->write(address + head, transaction->data(), transaction->size());
+    device->sync();
+    barriersCount++;
+    long long offset = sizeof(transactionHeader);
+    for(int i = 0; i < *recordsCount; i++) {
+        recordHeader record;
+        memcpy(&record, transaction->data() + offset, sizeof(recordHeader));
+        offset += sizeof(recordHeader);
+        if(record.type == RECORD_CHANGE) {
+            device->write(record.address, transaction->data() + offset, record.bytesCount);
+            offset += record.bytesCount;
+        }
+    }
+
+    head += transaction->size();
+    sequence++;
+    journaledBytes += transaction->size();
+
+    // next piece starts with empty header
+    transaction->assign(sizeof(transactionHeader), '\0');
+    *recordsCount = 0;
+}
+
+uint64_t Journal::checksum(const char *data, long long bytesCount) {
+    // words are mixed one after another, so moved or swapped words change checksum
+    uint64_t result = CHECKSUM_PRIME1 ^ (uint64_t) bytesCount;
+    long long i = 0;
+    for(; i + (long long) sizeof(uint64_t) <= bytesCount; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        result ^= word * CHECKSUM_PRIME2;
+        result = ((result << 31) | (result >> 33)) * CHECKSUM_PRIME1;
+    }
+    for(; i < bytesCount; i++) {
+        result ^= (unsigned char) data[i] * CHECKSUM_PRIME2;
+        result = ((result << 31) | (result >> 33)) * CHECKSUM_PRIME1;
+    }
+    return result ^ (result >> 29);
+}
+
+map<long long, string>::iterator Journal::removeChange(map<long long, string>::iterator it) {
+    if(savepointSet) {
+        undoLog.push_back({it->first, false, it->second});
+    }
+    pendingBytes -= it->second.size();
+    return changes.erase(it);
+}
+
+void Journal::addChange(long long address, const string &bytes) {
+    if(savepointSet) {
+        undoLog.push_back({address, true, string()});
+    }
+    pendingBytes += bytes.size();
+    changes[address] = bytes;
+}
+
+void Journal::clear() {
+    changes.clear();
+    revoked.clear();
+    pendingBytes = 0;
+    savepointSet = false;
+    undoLog.clear();
+}
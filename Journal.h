@@ -0,0 +1,118 @@
+#ifndef ZOS_VFS_JOURNAL_H
+#define ZOS_VFS_JOURNAL_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include "BlockDevice.h"
+
+using namespace std;
+
+/*
+ * Class represents write-ahead journal of metadata - changes of transaction are kept in memory (reads of image are patched by them),
+ * committed transaction is written to ring in image with one barrier and then applied to its place without waiting (the next barrier makes it durable),
+ * ranges which stop being metadata are revoked, so older transactions do not overwrite them when journal is replayed,
+ * commands which change different items write to current transaction at once
+ */
+class Journal {
+public:
+    // constructor
+    Journal();
+    // uses ring at given address of image, changes are written directly to image if size is zero or journal is not active
+    void open(BlockDevice *device, long long address, long long size, bool active);
+    // writes empty journal to image
+    void format();
+    // applies transactions whose changes may not be in place yet, returns count of applied transactions
+    int replay();
+    // writes all changes in place and marks journal as empty
+    void close();
+    // writes bytes to image as a part of current transaction
+    void write(long long address, const void *buffer, long long bytesCount);
+    // drops changes of current transaction in given range, older transactions are not replayed to it
+    void revoke(long long address, long long bytesCount);
+    // copies changes of current transaction to bytes read from image
+    void patch(long long address, void *buffer, long long bytesCount) const;
+    // writes current transaction to journal and applies it in place, transaction bigger than journal is written in more pieces
+    void commit();
+    // marks current state of transaction, abort drops only changes made after it (until commit)
+    void savepoint();
+    // drops changes of current transaction made after savepoint (all changes if there is none), image stays in the state of the last commit
+    void abort();
+    // get bytes of changes in current transaction
+    long long getPendingBytes() const;
+    // get size of ring [B]
+    long long getSize() const;
+    // checks if changes go through journal
+    bool isActive() const;
+    // get count of committed transactions since start
+    long long getCommitsCount() const;
+    // get bytes written to journal since start
+    long long getJournaledBytes() const;
+    // get count of barriers since start
+    long long getBarriersCount() const;
+
+private:
+    /*
+     * Struct represents one change of ranges of transaction which is undone when transaction returns to savepoint
+     */
+    typedef struct {
+        // address of range
+        long long address;
+        // true if range was added, false if it was removed
+        bool added;
+        // bytes of removed range
+        string bytes;
+    } undoRecord;
+
+    // storage of image
+    BlockDevice *device;
+    // address of journal in image
+    long long address;
+    // size of journal [B]
+    long long size;
+    // true if changes go through journal
+    bool active;
+    // changed ranges of current transaction by address (ranges do not overlap)
+    map<long long, string> changes;
+    // revoked ranges of current transaction (address and size)
+    vector<pair<long long, long long>> revoked;
+    // bytes of changes in current transaction
+    long long pendingBytes;
+    // sequence number of next transaction
+    long long sequence;
+    // offset of next transaction in journal
+    long long head;
+    // count of committed transactions
+    long long commitsCount;
+    // bytes written to journal
+    long long journaledBytes;
+    // count of barriers
+    long long barriersCount;
+    // lock of changes of current transaction
+    mutable mutex changesLock;
+    // true if changes made after savepoint are logged
+    bool savepointSet;
+    // changes of ranges made after savepoint in their order - range was added (without bytes) or removed (with its bytes)
+    vector<undoRecord> undoLog;
+    // bytes of changes and count of revoked ranges at savepoint
+    long long savepointPendingBytes;
+    int savepointRevokedCount;
+
+    // writes header of journal - replay starts with transaction of given sequence at given offset
+    void writeHeader(long long firstSequence, long long firstOffset);
+    // writes transaction with given count of records to ring and then its changes in place, transaction is emptied
+    void writeTransaction(string *transaction, int *recordsCount);
+    // get checksum of bytes of transaction
+    static uint64_t checksum(const char *data, long long bytesCount);
+    // removes range of current transaction, it is logged after savepoint
+    map<long long, string>::iterator removeChange(map<long long, string>::iterator it);
+    // adds range to current transaction, it is logged after savepoint
+    void addChange(long long address, const string &bytes);
+    // clears current transaction
+    void clear();
+};
+
+
+#endif
@@ -0,0 +1,194 @@
+#include "LzCodec.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// shortest match which is encoded
+static const int MIN_MATCH = 4;
+// farthest match which can be referenced
+static const int MAX_OFFSET = 65535;
+// bits of hash of sequence in table of last positions
+static const int HASH_BITS = 12;
+// matches do not start in last bytes of data (they are literals)
+static const int MATCH_START_LIMIT = 12;
+// matches do not extend to last bytes of data
+static const int LAST_LITERALS = 5;
+// misses of match after which search steps faster (incompressible data are skipped quickly)
+static const int SKIP_TRIGGER = 6;
+// max length stored directly in half of token
+static const int TOKEN_LENGTH_MAX = 15;
+
+// read 4 bytes of data
+static uint32_t read32(const unsigned char *data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// get index of sequence in table of positions
+static int hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// writes length which does not fit to token, returns new position in output
+static int writeLength(unsigned char *output, int position, int length) {
+    while(length >= 255) {
+        output[position++] = 255;
+        length -= 255;
+    }
+    output[position++] = length;
+    return position;
+}
+
+// reads length which does not fit to token, returns -1 if data end
+static int readLength(const unsigned char *data, int bytesCount, int *position) {
+    int length = 0;
+    unsigned char byte;
+    do {
+        if(*position >= bytesCount) {
+            return -1;
+        }
+        byte = data[(*position)++];
+        length += byte;
+    } while(byte == 255);
+    return length;
+}
+
+// writes sequence of literals and match (match of length 0 ends data), returns new position in output, -1 if it does not fit
+static int writeSequence(unsigned char *output, int position, int capacity, const unsigned char *literals, int literalsCount, int offset, int matchLength) {
+    // token, lengths, literals and offset must fit
+    if((long long) position + 1 + literalsCount / 255 + 1 + literalsCount + 2 + matchLength / 255 + 1 > capacity) {
+        return -1;
+    }
+
+    int literalsToken = literalsCount < TOKEN_LENGTH_MAX ? literalsCount : TOKEN_LENGTH_MAX;
+    int matchToken = 0;
+    if(matchLength > 0) {
+        matchToken = matchLength - MIN_MATCH < TOKEN_LENGTH_MAX ? matchLength - MIN_MATCH : TOKEN_LENGTH_MAX;
+    }
+    output[position++] = (literalsToken << 4) | matchToken;
+    if(literalsToken == TOKEN_LENGTH_MAX) {
+        position = writeLength(output, position, literalsCount - TOKEN_LENGTH_MAX);
+    }
+    memcpy(output + position, literals, literalsCount);
+    position += literalsCount;
+
+    if(matchLength > 0) {
+        output[position++] = offset & 0xff;
+        output[position++] = offset >> 8;
+        if(matchToken == TOKEN_LENGTH_MAX) {
+            position = writeLength(output, position, matchLength - MIN_MATCH - TOKEN_LENGTH_MAX);
+        }
+    }
+    return position;
+}
+
+int LzCodec::compress(const char *data, int bytesCount, char *output, int capacity) {
+    const unsigned char *input = (const unsigned char *) data;
+    unsigned char *out = (unsigned char *) output;
+    int outPosition = 0;
+    int anchor = 0;
+
+    // last position of every hashed sequence
+    int positions[1 << HASH_BITS];
+    for(int i = 0; i < (1 << HASH_BITS); i++) {
+        positions[i] = -1;
+    }
+
+    int position = 0;
+    int misses = 0;
+    while(position < bytesCount - MATCH_START_LIMIT) {
+        uint32_t sequence = read32(input + position);
+        int hash = hashSequence(sequence);
+        int candidate = positions[hash];
+        positions[hash] = position;
+        if(candidate == -1 || position - candidate > MAX_OFFSET || read32(input + candidate) != sequence) {
+            position += 1 + (misses++ >> SKIP_TRIGGER);
+            continue;
+        }
+
+        // extend match
+        int matchLength = MIN_MATCH;
+        while(position + matchLength < bytesCount - LAST_LITERALS && input[candidate + matchLength] == input[position + matchLength]) {
+            matchLength++;
+        }
+
+        outPosition = writeSequence(out, outPosition, capacity, input + anchor, position - anchor, position - candidate, matchLength);
+        if(outPosition == -1) {
+            return 0;
+        }
+        position += matchLength;
+        anchor = position;
+        misses = 0;
+    }
+
+    // rest of data are literals
+    outPosition = writeSequence(out, outPosition, capacity, input + anchor, bytesCount - anchor, 0, 0);
+    if(outPosition == -1) {
+        return 0;
+    }
+    return outPosition;
+}
+
+int LzCodec::decompress(const char *data, int bytesCount, char *output, int capacity) {
+    const unsigned char *input = (const unsigned char *) data;
+    int position = 0;
+    int outPosition = 0;
+    while(position < bytesCount) {
+        int token = input[position++];
+
+        // literals
+        int literalsCount = token >> 4;
+        if(literalsCount == TOKEN_LENGTH_MAX) {
+            int length = readLength(input, bytesCount, &position);
+            if(length == -1) {
+                return -1;
+            }
+            literalsCount += length;
+        }
+        if(literalsCount > bytesCount - position || literalsCount > capacity - outPosition) {
+            return -1;
+        }
+        memcpy(output + outPosition, input + position, literalsCount);
+        position += literalsCount;
+        outPosition += literalsCount;
+
+        if(position == bytesCount) {
+            // the last sequence has no match
+            break;
+        }
+
+        // match
+        if(position + 2 > bytesCount) {
+            return -1;
+        }
+        int offset = input[position] | (input[position + 1] << 8);
+        position += 2;
+        int matchLength = token & TOKEN_LENGTH_MAX;
+        if(matchLength == TOKEN_LENGTH_MAX) {
+            int length = readLength(input, bytesCount, &position);
+            if(length == -1) {
+                return -1;
+            }
+            matchLength += length;
+        }
+        matchLength += MIN_MATCH;
+        if(offset == 0 || offset > outPosition || matchLength > capacity - outPosition) {
+            return -1;
+        }
+
+        if(offset >= matchLength) {
+            memcpy(output + outPosition, output + outPosition - offset, matchLength);
+        }
+        else {
+            // match overlaps bytes which it writes (repeated pattern)
+            for(int i = 0; i < matchLength; i++) {
+                output[outPosition + i] = output[outPosition + i - offset];
+            }
+        }
+        outPosition += matchLength;
+    }
+
+    return outPosition;
+}
@@ -0,0 +1,20 @@
+#ifndef ZOS_VFS_LZCODEC_H
+#define ZOS_VFS_LZCODEC_H
+
+
+using namespace std;
+
+/*
+ * Class contains LZ77 codec of data chunks - sequences of literals and matches in the LZ4 block style
+ * (token with lengths, literals, 2 B offset of match, longer lengths continue in bytes of 255)
+ */
+class LzCodec {
+public:
+    // compresses data to output, returns size of compressed data, 0 if it does not fit to capacity of output
+    static int compress(const char *data, int bytesCount, char *output, int capacity);
+    // decompresses data to output, returns size of decompressed data, -1 if data are corrupted or do not fit to capacity
+    static int decompress(const char *data, int bytesCount, char *output, int capacity);
+};
+
+
+#endif
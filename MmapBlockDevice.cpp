@@ -0,0 +1,117 @@
+#include "MmapBlockDevice.h"
+#include "Constants.h"
+#include <iostream>
+#include <cstring>
+#include <sys/mman.h>
+
+MmapBlockDevice::MmapBlockDevice() {
+    mappedImage = nullptr;
+    mappedSize = 0;
+}
+
+MmapBlockDevice::~MmapBlockDevice() {
+    close();
+}
+
+bool MmapBlockDevice::open(const char *name) {
+    close();
+    if(!PosixBlockDevice::open(name)) {
+        return false;
+    }
+
+    mapImage();
+    return true;
+}
+
+bool MmapBlockDevice::create(const char *name, long long bytesSize) {
+    close();
+    if(!PosixBlockDevice::create(name, bytesSize)) {
+        return false;
+    }
+
+    mapImage();
+    return true;
+}
+
+bool MmapBlockDevice::resize(long long bytesSize) {
+    // mapping is created again for new size
+    unmapImage();
+    bool resized = PosixBlockDevice::resize(bytesSize);
+    mapImage();
+    return resized;
+}
+
+void MmapBlockDevice::close() {
+    unmapImage();
+    PosixBlockDevice::close();
+}
+
+void MmapBlockDevice::read(long long address, void *buffer, long long bytesCount) {
+    if(mappedImage == nullptr) {
+        PosixBlockDevice::read(address, buffer, bytesCount);
+        return;
+    }
+
+    memcpy(buffer, mappedImage + address, bytesCount);
+}
+
+void MmapBlockDevice::write(long long address, const void *buffer, long long bytesCount) {
+    if(mappedImage == nullptr) {
+        PosixBlockDevice::write(address, buffer, bytesCount);
+        return;
+    }
+
+    memcpy(mappedImage + address, buffer, bytesCount);
+}
+
+void MmapBlockDevice::flush() {
+    if(mappedImage != nullptr) {
+        // changes are written by the system, it is only started here
+        msync(mappedImage, mappedSize, MS_ASYNC);
+    }
+}
+
+void MmapBlockDevice::sync() {
+    if(mappedImage != nullptr) {
+        msync(mappedImage, mappedSize, MS_SYNC);
+    }
+    PosixBlockDevice::sync();
+}
+
+char *MmapBlockDevice::getMemory() {
+    return mappedImage;
+}
+
+int MmapBlockDevice::getAsyncFd() {
+    // mapped image is accessed by memory copy
+    return mappedImage == nullptr ? fd : -1;
+}
+
+void MmapBlockDevice::unmapImage() {
+    if(mappedImage == nullptr) {
+        return;
+    }
+
+    msync(mappedImage, mappedSize, MS_SYNC);
+    munmap(mappedImage, mappedSize);
+    mappedImage = nullptr;
+    mappedSize = 0;
+}
+
+void MmapBlockDevice::mapImage() {
+    long long fileSize = getFileSize();
+    if(fileSize < Constants::SUPER_BLOCK_AREA_SIZE) {
+        // there is no image to map
+        return;
+    }
+
+    void *mapped = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapped == MAP_FAILED) {
+        // pread/pwrite is used instead
+        cout << Constants::MMAP_FAILED_MSG << endl;
+        return;
+    }
+
+    mappedImage = (char *) mapped;
+    mappedSize = fileSize;
+}
@@ -0,0 +1,39 @@
+#ifndef ZOS_VFS_MMAPBLOCKDEVICE_H
+#define ZOS_VFS_MMAPBLOCKDEVICE_H
+
+#include "PosixBlockDevice.h"
+
+/*
+ * Class represents image mapped to memory (shared mapping, changes are written by the system)
+ */
+class MmapBlockDevice : public PosixBlockDevice {
+public:
+    // constructor
+    MmapBlockDevice();
+    // destructor
+    ~MmapBlockDevice() override;
+    bool open(const char *name) override;
+    bool create(const char *name, long long bytesSize) override;
+    bool resize(long long bytesSize) override;
+    void close() override;
+    void read(long long address, void *buffer, long long bytesCount) override;
+    void write(long long address, const void *buffer, long long bytesCount) override;
+    void flush() override;
+    void sync() override;
+    char *getMemory() override;
+    int getAsyncFd() override;
+
+private:
+    // mapped image, nullptr if pread/pwrite is used instead
+    char *mappedImage;
+    // size of mapped image
+    long long mappedSize;
+
+    // map whole open file (pread/pwrite is used when it fails)
+    void mapImage();
+    // write back and unmap image
+    void unmapImage();
+};
+
+
+#endif
@@ -0,0 +1,106 @@
+#include "PosixBlockDevice.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+PosixBlockDevice::PosixBlockDevice() {
+    fd = -1;
+}
+
+PosixBlockDevice::~PosixBlockDevice() {
+    // virtual close of derived device is not available here
+    PosixBlockDevice::close();
+}
+
+bool PosixBlockDevice::open(const char *name) {
+    return openFile(name, O_RDWR);
+}
+
+bool PosixBlockDevice::create(const char *name, long long bytesSize) {
+    if(!openFile(name, O_RDWR | O_TRUNC)) {
+        return false;
+    }
+
+    // set size of image
+    return ftruncate(fd, bytesSize) == 0;
+}
+
+bool PosixBlockDevice::resize(long long bytesSize) {
+    return ftruncate(fd, bytesSize) == 0;
+}
+
+bool PosixBlockDevice::allocate(long long bytesSize) {
+    return fallocate(fd, 0, 0, bytesSize) == 0;
+}
+
+void PosixBlockDevice::close() {
+    if(fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool PosixBlockDevice::isOpen() const {
+    return fd != -1;
+}
+
+void PosixBlockDevice::read(long long address, void *buffer, long long bytesCount) {
+    // read can return less bytes than requested
+    char *target = (char *) buffer;
+    while(bytesCount > 0) {
+        ssize_t bytesRead = pread(fd, target, bytesCount, address);
+        if(bytesRead <= 0) {
+            return;
+        }
+        target += bytesRead;
+        address += bytesRead;
+        bytesCount -= bytesRead;
+    }
+}
+
+void PosixBlockDevice::write(long long address, const void *buffer, long long bytesCount) {
+    // write can store less bytes than requested
+    const char *source = (const char *) buffer;
+    while(bytesCount > 0) {
+        ssize_t bytesWritten = pwrite(fd, source, bytesCount, address);
+        if(bytesWritten <= 0) {
+            return;
+        }
+        source += bytesWritten;
+        address += bytesWritten;
+        bytesCount -= bytesWritten;
+    }
+}
+
+void PosixBlockDevice::flush() {
+    // data are already in page cache of system
+}
+
+void PosixBlockDevice::sync() {
+    if(fd != -1) {
+        fdatasync(fd);
+    }
+}
+
+int PosixBlockDevice::getAsyncFd() {
+    return fd;
+}
+
+bool PosixBlockDevice::openFile(const char *name, int flags) {
+    close();
+    if(flags & O_TRUNC) {
+        fd = ::open(name, flags | O_CREAT, 0644);
+    }
+    else {
+        fd = ::open(name, flags);
+    }
+    return fd != -1;
+}
+
+long long PosixBlockDevice::getFileSize() const {
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0) {
+        return 0;
+    }
+    return fileStat.st_size;
+}
@@ -0,0 +1,38 @@
+#ifndef ZOS_VFS_POSIXBLOCKDEVICE_H
+#define ZOS_VFS_POSIXBLOCKDEVICE_H
+
+#include "BlockDevice.h"
+
+/*
+ * Class represents image accessed through file descriptor with positional pread/pwrite (no seeking, no user space buffering)
+ */
+class PosixBlockDevice : public BlockDevice {
+public:
+    // constructor
+    PosixBlockDevice();
+    // destructor
+    ~PosixBlockDevice() override;
+    bool open(const char *name) override;
+    bool create(const char *name, long long bytesSize) override;
+    bool resize(long long bytesSize) override;
+    bool allocate(long long bytesSize) override;
+    void close() override;
+    bool isOpen() const override;
+    void read(long long address, void *buffer, long long bytesCount) override;
+    void write(long long address, const void *buffer, long long bytesCount) override;
+    void flush() override;
+    void sync() override;
+    int getAsyncFd() override;
+
+protected:
+    // file descriptor, -1 if image is not open
+    int fd;
+
+    // open file with given flags (O_CREAT is used with O_TRUNC), false if it cannot be opened
+    bool openFile(const char *name, int flags);
+    // get size of open file
+    long long getFileSize() const;
+};
+
+
+#endif
@@ -0,0 +1,118 @@
+#include "RamBlockDevice.h"
+#include <cstdio>
+#include <cstring>
+#include <stdlib.h>
+
+RamBlockDevice::RamBlockDevice() {
+    memory = nullptr;
+    memorySize = 0;
+}
+
+RamBlockDevice::~RamBlockDevice() {
+    close();
+}
+
+bool RamBlockDevice::open(const char *name) {
+    close();
+    FILE *file = fopen(name, "rb");
+    if(file == NULL) {
+        return false;
+    }
+
+    // load whole image
+    fseeko(file, 0, SEEK_END);
+    long long fileSize = ftello(file);
+    fseeko(file, 0, SEEK_SET);
+    memory = (char *) malloc(fileSize > 0 ? fileSize : 1);
+    if(memory == nullptr) {
+        fclose(file);
+        return false;
+    }
+    memorySize = fread(memory, sizeof(char), fileSize, file);
+    fclose(file);
+
+    this->name = name;
+    return true;
+}
+
+bool RamBlockDevice::create(const char *name, long long bytesSize) {
+    close();
+    memory = (char *) calloc(bytesSize, sizeof(char));
+    if(memory == nullptr) {
+        return false;
+    }
+    memorySize = bytesSize;
+
+    this->name = name;
+    return true;
+}
+
+bool RamBlockDevice::resize(long long bytesSize) {
+    char *resized = (char *) realloc(memory, bytesSize);
+    if(resized == nullptr) {
+        return false;
+    }
+
+    // new bytes are zeros
+    if(bytesSize > memorySize) {
+        memset(resized + memorySize, 0, bytesSize - memorySize);
+    }
+    memory = resized;
+    memorySize = bytesSize;
+    return true;
+}
+
+bool RamBlockDevice::allocate(long long) {
+    // whole image is already in memory
+    return true;
+}
+
+void RamBlockDevice::close() {
+    if(memory == nullptr) {
+        return;
+    }
+
+    // write image back to file
+    FILE *file = fopen(name.c_str(), "wb");
+    if(file != NULL) {
+        fwrite(memory, sizeof(char), memorySize, file);
+        fclose(file);
+    }
+
+    free(memory);
+    memory = nullptr;
+    memorySize = 0;
+}
+
+bool RamBlockDevice::isOpen() const {
+    return memory != nullptr;
+}
+
+void RamBlockDevice::read(long long address, void *buffer, long long bytesCount) {
+    // bytes behind the end of image are read as zeros
+    long long available = address < memorySize ? memorySize - address : 0;
+    if(available < bytesCount) {
+        memset((char *) buffer + available, 0, bytesCount - available);
+        bytesCount = available;
+    }
+
+    memcpy(buffer, memory + address, bytesCount);
+}
+
+void RamBlockDevice::write(long long address, const void *buffer, long long bytesCount) {
+    // bytes behind the end of image are not written
+    long long available = address < memorySize ? memorySize - address : 0;
+    if(available < bytesCount) {
+        bytesCount = available;
+    }
+
+    memcpy(memory + address, buffer, bytesCount);
+}
+
+void RamBlockDevice::flush() {
+    // image is written when it is closed
+}
+
+char *RamBlockDevice::getMemory() {
+    return memory;
+}
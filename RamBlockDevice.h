@@ -0,0 +1,36 @@
+#ifndef ZOS_VFS_RAMBLOCKDEVICE_H
+#define ZOS_VFS_RAMBLOCKDEVICE_H
+
+#include "BlockDevice.h"
+
+/*
+ * Class represents image held whole in memory (RAM disk), it is loaded on open and written back on close
+ */
+class RamBlockDevice : public BlockDevice {
+public:
+    // constructor
+    RamBlockDevice();
+    // destructor
+    ~RamBlockDevice() override;
+    bool open(const char *name) override;
+    bool create(const char *name, long long bytesSize) override;
+    bool resize(long long bytesSize) override;
+    bool allocate(long long bytesSize) override;
+    void close() override;
+    bool isOpen() const override;
+    void read(long long address, void *buffer, long long bytesCount) override;
+    void write(long long address, const void *buffer, long long bytesCount) override;
+    void flush() override;
+    char *getMemory() override;
+
+private:
+    // name of image file
+    string name;
+    // image in memory, nullptr if image is not open
+    char *memory;
+    // size of image
+    long long memorySize;
+};
+
+
+#endif
@@ -0,0 +1,144 @@
+#include "Session.h"
+#include "Constants.h"
+#include "StringUtils.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+using namespace std;
+
+Session::Session() {
+    output = &cout;
+    commandsCount = 0;
+    commandsTime = 0;
+    changeToRoot();
+}
+
+int Session::getCurrentInode() const {
+    return currentInode;
+}
+
+const string &Session::getPath() const {
+    return path;
+}
+
+void Session::changeDirectory(int inodeIdx, const string &target) {
+    currentInode = inodeIdx;
+
+    // path is absolute - parts of current path are not used
+    vector<string> pathParts;
+    if(!target.empty() && target[0] != Constants::PATH_DELIM) {
+        pathParts = StringUtils::split(path.substr(1), Constants::PATH_DELIM);
+    }
+
+    // iterate through user written path
+    vector<string> userPath = StringUtils::split(target, Constants::PATH_DELIM);
+    for(int i = 0; i < userPath.size(); i++) {
+        string current = userPath[i];
+        if(current.empty() || current == ".") {
+            // current dir
+            continue;
+        }
+        if(current == "..") {
+            // parent dir
+            if(!pathParts.empty()) {
+                pathParts.pop_back();
+            }
+            continue;
+        }
+        pathParts.push_back(current);
+    }
+
+    // join parts to full path, if parts are empty - path is root
+    path = "";
+    for(int i = 0; i < pathParts.size(); i++) {
+        path += Constants::PATH_DELIM + pathParts[i];
+    }
+    if(path.empty()) {
+        path = Constants::PATH_DELIM;
+    }
+}
+
+void Session::changeToRoot() {
+    currentInode = Constants::ROOT_INODE_IDX;
+    path = Constants::PATH_DELIM;
+}
+
+void Session::commandHandled(long long time) {
+    commandsCount++;
+    commandsTime += time;
+}
+
+long long Session::getCommandsCount() const {
+    return commandsCount;
+}
+
+long long Session::getCommandsTime() const {
+    return commandsTime;
+}
+
+ostream &Session::getOutput() const {
+    return *output;
+}
+
+bool Session::usesHostPaths() const {
+    return true;
+}
+
+FILE *Session::openHostFile(const string &path, const char *mode) {
+    return fopen(path.c_str(), mode);
+}
+
+void Session::closeHostFile(FILE *file) {
+    fclose(file);
+}
+
+void Session::writeOutput(const iovec *parts, int partsCount) {
+    output->flush();
+
+    // parts are written by as few calls as possible, call can write only part of them
+    vector<iovec> unwritten(parts, parts + partsCount);
+    int first = 0;
+    while(first < unwritten.size()) {
+        ssize_t written = writev(STDOUT_FILENO, unwritten.data() + first, min((int) unwritten.size() - first, IOV_MAX));
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written < 0) {
+            return;
+        }
+
+        // skip written parts
+        while(first < unwritten.size() && written >= (ssize_t) unwritten[first].iov_len) {
+            written -= unwritten[first].iov_len;
+            first++;
+        }
+        if(first < unwritten.size()) {
+            unwritten[first].iov_base = (char *) unwritten[first].iov_base + written;
+            unwritten[first].iov_len -= written;
+        }
+    }
+}
+
+long long Session::sendImageData(int imageFd, long long address, long long bytesCount) {
+    output->flush();
+
+    // data are copied by kernel, they do not go through memory of process
+    off_t offset = address;
+    long long sent = 0;
+    while(sent < bytesCount) {
+        ssize_t bytes = sendfile(STDOUT_FILENO, imageFd, &offset, bytesCount - sent);
+        if(bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if(bytes <= 0) {
+            // output which does not allow it (console) or the rest of range is written by caller
+            return sent;
+        }
+        sent += bytes;
+    }
+    return sent;
+}
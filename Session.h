@@ -0,0 +1,64 @@
+#ifndef ZOS_VFS_SESSION_H
+#define ZOS_VFS_SESSION_H
+
+#include <string>
+#include <iostream>
+#include <stdio.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+/*
+ * Class represents session of one client - its current directory, output and statistics, image is shared by all sessions,
+ * one session is used by one thread at once, base class prints output to console and opens files of host by their paths
+ */
+class Session {
+public:
+    // constructor - session starts in root dir
+    Session();
+    // destructor
+    virtual ~Session() = default;
+    // get inode idx of current dir
+    int getCurrentInode() const;
+    // get path of current dir
+    const string &getPath() const;
+    // changes current dir to dir with given inode idx, its path is given path (absolute or relative to current path)
+    void changeDirectory(int inodeIdx, const string &target);
+    // changes current dir to root
+    void changeToRoot();
+    // counts handled command and time spent by it [ns]
+    void commandHandled(long long time);
+    // get count of handled commands
+    long long getCommandsCount() const;
+    // get time spent by handled commands [ns]
+    long long getCommandsTime() const;
+    // get stream which gets output of commands
+    ostream &getOutput() const;
+    // checks if files of host can be opened by their paths
+    virtual bool usesHostPaths() const;
+    // opens file of host file system for incp, outcp or load, nullptr if it cannot be opened
+    virtual FILE *openHostFile(const string &path, const char *mode);
+    // closes file of host file system opened for incp or outcp
+    virtual void closeHostFile(FILE *file);
+    // writes data (any bytes) to output at once without copying them, output of stream is written first
+    virtual void writeOutput(const iovec *parts, int partsCount);
+    // writes range of image file straight to output, returns count of written bytes (0 if output does not allow it)
+    virtual long long sendImageData(int imageFd, long long address, long long bytesCount);
+
+protected:
+    // stream which gets output of commands
+    ostream *output;
+
+private:
+    // inode idx of current dir
+    int currentInode;
+    // path of current dir
+    string path;
+    // count of handled commands
+    long long commandsCount;
+    // time spent by handled commands [ns]
+    long long commandsTime;
+};
+
+
+#endif
@@ -0,0 +1,207 @@
+#include "SocketSession.h"
+#include "Constants.h"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+SocketSession::SocketSession(int socketFd): outputStream(this) {
+    this->socketFd = socketFd;
+    attachedFd = -1;
+    requestId = 0;
+    connected = true;
+    outputBuffer = (char *) malloc(Constants::FRAME_OUTPUT_SIZE);
+    setp(outputBuffer, outputBuffer + Constants::FRAME_OUTPUT_SIZE);
+    output = &outputStream;
+}
+
+SocketSession::~SocketSession() {
+    closeAttachedFd();
+    close(socketFd);
+    free(outputBuffer);
+}
+
+bool SocketSession::receiveCommand(string *commandLine) {
+    frameHeader header;
+    if(!receive(&header, sizeof(frameHeader))) {
+        return false;
+    }
+
+    // only commands are requested, too long command is not read
+    if(header.type != Constants::FRAME_COMMAND || header.length > Constants::FRAME_COMMAND_SIZE) {
+        return false;
+    }
+
+    requestId = header.requestId;
+    commandLine->assign(header.length, '\0');
+    return header.length == 0 || receive(&(*commandLine)[0], header.length);
+}
+
+void SocketSession::commandFinished() {
+    sendOutput();
+    sendFrame(Constants::FRAME_END, nullptr, 0);
+    // attached file was not used by command
+    closeAttachedFd();
+}
+
+bool SocketSession::usesHostPaths() const {
+    return false;
+}
+
+FILE *SocketSession::openHostFile(const string &, const char *mode) {
+    if(attachedFd == -1) {
+        return nullptr;
+    }
+
+    // file is used only once
+    FILE *file = fdopen(attachedFd, mode);
+    if(file != nullptr) {
+        attachedFd = -1;
+    }
+    return file;
+}
+
+void SocketSession::writeOutput(const iovec *parts, int partsCount) {
+    sendOutput();
+
+    // parts are split to frames which are not bigger than output frame
+    vector<iovec> frameParts;
+    int frameBytes = 0;
+    for(int i = 0; i < partsCount; i++) {
+        const char *data = (const char *) parts[i].iov_base;
+        long long bytesCount = parts[i].iov_len;
+        while(bytesCount > 0) {
+            int bytes = min(bytesCount, (long long) Constants::FRAME_OUTPUT_SIZE - frameBytes);
+            iovec part = {(void *) data, (size_t) bytes};
+            frameParts.push_back(part);
+            frameBytes += bytes;
+            data += bytes;
+            bytesCount -= bytes;
+
+            if(frameBytes == Constants::FRAME_OUTPUT_SIZE) {
+                sendFrame(Constants::FRAME_OUTPUT, frameParts.data(), frameParts.size());
+                frameParts.clear();
+                frameBytes = 0;
+            }
+        }
+    }
+    if(frameBytes > 0) {
+        sendFrame(Constants::FRAME_OUTPUT, frameParts.data(), frameParts.size());
+    }
+}
+
+long long SocketSession::sendImageData(int, long long, long long) {
+    return 0;
+}
+
+int SocketSession::overflow(int c) {
+    sendOutput();
+    if(c != traits_type::eof()) {
+        *pptr() = (char) c;
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int SocketSession::sync() {
+    return 0;
+}
+
+void SocketSession::sendOutput() {
+    iovec part = {pbase(), (size_t) (pptr() - pbase())};
+    if(part.iov_len > 0) {
+        sendFrame(Constants::FRAME_OUTPUT, &part, 1);
+    }
+    setp(outputBuffer, outputBuffer + Constants::FRAME_OUTPUT_SIZE);
+}
+
+void SocketSession::sendFrame(unsigned int type, const iovec *parts, int partsCount) {
+    if(!connected) {
+        return;
+    }
+
+    frameHeader header;
+    header.requestId = requestId;
+    header.type = type;
+    header.length = 0;
+
+    // header and payload are sent at once without copying them to one buffer
+    vector<iovec> frame(1 + partsCount);
+    frame[0].iov_base = &header;
+    frame[0].iov_len = sizeof(frameHeader);
+    for(int i = 0; i < partsCount; i++) {
+        frame[1 + i] = parts[i];
+        header.length += parts[i].iov_len;
+    }
+    msghdr message;
+    memset(&message, 0, sizeof(msghdr));
+    message.msg_iov = frame.data();
+    message.msg_iovlen = frame.size();
+
+    while(message.msg_iovlen > 0) {
+        ssize_t sent = sendmsg(socketFd, &message, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if(sent < 0) {
+            connected = false;
+            return;
+        }
+
+        // skip sent parts
+        while(message.msg_iovlen > 0 && sent >= (ssize_t) message.msg_iov->iov_len) {
+            sent -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if(message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = (char *) message.msg_iov->iov_base + sent;
+            message.msg_iov->iov_len -= sent;
+        }
+    }
+}
+
+bool SocketSession::receive(void *buffer, int bytesCount) {
+    int received = 0;
+    while(received < bytesCount) {
+        iovec part;
+        part.iov_base = (char *) buffer + received;
+        part.iov_len = bytesCount - received;
+        char control[CMSG_SPACE(sizeof(int))];
+        msghdr message;
+        memset(&message, 0, sizeof(msghdr));
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t bytes = recvmsg(socketFd, &message, MSG_CMSG_CLOEXEC);
+        if(bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if(bytes <= 0) {
+            return false;
+        }
+
+        // file descriptor sent with request
+        for(cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+            if(header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                closeAttachedFd();
+                memcpy(&attachedFd, CMSG_DATA(header), sizeof(int));
+            }
+        }
+        received += bytes;
+    }
+    return true;
+}
+
+void SocketSession::closeAttachedFd() {
+    if(attachedFd != -1) {
+        close(attachedFd);
+        attachedFd = -1;
+    }
+}
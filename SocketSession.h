@@ -0,0 +1,65 @@
+#ifndef ZOS_VFS_SOCKETSESSION_H
+#define ZOS_VFS_SOCKETSESSION_H
+
+#include <string>
+#include <streambuf>
+#include <ostream>
+#include "Session.h"
+#include "VFSDefinitions.h"
+
+using namespace std;
+
+/*
+ * Class represents session of client connected to unix socket of server - commands are read from request frames
+ * (client can send more requests without waiting for responses), output is sent in frames while command runs,
+ * file attached to request is used by incp, outcp or load, so its data do not go through socket (server does not open paths of client)
+ */
+class SocketSession : public Session, private streambuf {
+public:
+    // constructor - session owns connected socket
+    explicit SocketSession(int socketFd);
+    // destructor - socket and attached file are closed
+    ~SocketSession() override;
+    // reads next command, false if client closed connection or sent bad frame
+    bool receiveCommand(string *commandLine);
+    // sends the rest of output and end of command
+    void commandFinished();
+    // paths of client are not opened by server, client attaches its files
+    bool usesHostPaths() const override;
+    // opens attached file, nullptr if there is none
+    FILE *openHostFile(const string &path, const char *mode) override;
+    // sends data in output frames without copying them to buffer of output
+    void writeOutput(const iovec *parts, int partsCount) override;
+    // data of image are always read and sent in output frames
+    long long sendImageData(int imageFd, long long address, long long bytesCount) override;
+
+private:
+    // connected socket
+    int socketFd;
+    // file descriptor attached to current request, -1 if there is none
+    int attachedFd;
+    // id of current request
+    unsigned int requestId;
+    // false if sending failed (client is gone), the rest of output is dropped
+    bool connected;
+    // buffer of output which is not sent
+    char *outputBuffer;
+    // stream which gets output of commands
+    ostream outputStream;
+
+    // sends full buffer of output and puts char after it (streambuf)
+    int overflow(int c) override;
+    // output is sent when buffer is full or command is finished, not on every flush of stream (streambuf)
+    int sync() override;
+    // sends buffered output in one frame
+    void sendOutput();
+    // sends frame with given type and payload of current request, payload is made of given parts
+    void sendFrame(unsigned int type, const iovec *parts, int partsCount);
+    // reads given count of bytes, file descriptor which comes with them is attached, false if connection was closed
+    bool receive(void *buffer, int bytesCount);
+    // closes attached file descriptor which was not used
+    void closeAttachedFd();
+};
+
+
+#endif
@@ -0,0 +1,73 @@
+#include "StdioBlockDevice.h"
+#include <unistd.h>
+#include <fcntl.h>
+
+StdioBlockDevice::StdioBlockDevice() {
+    fp = NULL;
+}
+
+StdioBlockDevice::~StdioBlockDevice() {
+    close();
+}
+
+bool StdioBlockDevice::open(const char *name) {
+    close();
+    fp = fopen(name, "rb+");
+    return fp != NULL;
+}
+
+bool StdioBlockDevice::create(const char *name, long long bytesSize) {
+    close();
+    fp = fopen(name, "wb+");
+    if(fp == NULL) {
+        return false;
+    }
+
+    // set size of image
+    return ftruncate(fileno(fp), bytesSize) == 0;
+}
+
+bool StdioBlockDevice::resize(long long bytesSize) {
+    fflush(fp);
+    return ftruncate(fileno(fp), bytesSize) == 0;
+}
+
+bool StdioBlockDevice::allocate(long long bytesSize) {
+    return fallocate(fileno(fp), 0, 0, bytesSize) == 0;
+}
+
+void StdioBlockDevice::close() {
+    if(fp != NULL) {
+        fclose(fp);
+        fp = NULL;
+    }
+}
+
+bool StdioBlockDevice::isOpen() const {
+    return fp != NULL;
+}
+
+void StdioBlockDevice::read(long long address, void *buffer, long long bytesCount) {
+    lock_guard<mutex> guard(streamLock);
+    fseeko(fp, address, SEEK_SET);
+    fread(buffer, sizeof(char), bytesCount, fp);
+}
+
+void StdioBlockDevice::write(long long address, const void *buffer, long long bytesCount) {
+    lock_guard<mutex> guard(streamLock);
+    fseeko(fp, address, SEEK_SET);
+    fwrite(buffer, sizeof(char), bytesCount, fp);
+}
+
+void StdioBlockDevice::flush() {
+    lock_guard<mutex> guard(streamLock);
+    fflush(fp);
+}
+
+void StdioBlockDevice::sync() {
+    if(fp != NULL) {
+        lock_guard<mutex> guard(streamLock);
+        fflush(fp);
+        fdatasync(fileno(fp));
+    }
+}
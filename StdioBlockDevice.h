@@ -0,0 +1,36 @@
+#ifndef ZOS_VFS_STDIOBLOCKDEVICE_H
+#define ZOS_VFS_STDIOBLOCKDEVICE_H
+
+#include <cstdio>
+#include <mutex>
+#include "BlockDevice.h"
+
+/*
+ * Class represents image accessed through buffered stdio stream, position of stream is shared, so transfers are serialized
+ */
+class StdioBlockDevice : public BlockDevice {
+public:
+    // constructor
+    StdioBlockDevice();
+    // destructor
+    ~StdioBlockDevice() override;
+    bool open(const char *name) override;
+    bool create(const char *name, long long bytesSize) override;
+    bool resize(long long bytesSize) override;
+    bool allocate(long long bytesSize) override;
+    void close() override;
+    bool isOpen() const override;
+    void read(long long address, void *buffer, long long bytesCount) override;
+    void write(long long address, const void *buffer, long long bytesCount) override;
+    void flush() override;
+    void sync() override;
+
+private:
+    // file
+    FILE *fp;
+    // lock of stream position and buffer
+    mutex streamLock;
+};
+
+
+#endif
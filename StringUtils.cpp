@@ -21,3 +21,16 @@ vector <string> StringUtils::split(const string &s, char delim) {
     split(s, delim, back_inserter(elems));
     return elems;
 }
+
+bool StringUtils::isNumber(const string &s) {
+    if(s.empty()) {
+        return false;
+    }
+
+    for(int i = 0; i < s.length(); i++) {
+        if(s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
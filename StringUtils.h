@@ -14,6 +14,8 @@ class StringUtils {
 public:
     // splits given string based on delimiter into list of strings
     static vector<string> split(const string &s, char delim);
+    // checks if given string is not empty and contains only digits
+    static bool isNumber(const string &s);
 private:
     template <typename Out>
     // help method for split
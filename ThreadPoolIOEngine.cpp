@@ -0,0 +1,67 @@
+#include "ThreadPoolIOEngine.h"
+#include "Constants.h"
+
+ThreadPoolIOEngine::ThreadPoolIOEngine(BlockDevice *device, int queueDepth): IOEngine(device, queueDepth) {
+    stopping = false;
+
+    // more threads than requests in flight would not have work
+    int threadsCount = min(queueDepth, Constants::IO_THREADS_COUNT);
+    for(int i = 0; i < threadsCount; i++) {
+        workers.emplace_back(&ThreadPoolIOEngine::work, this);
+    }
+}
+
+ThreadPoolIOEngine::~ThreadPoolIOEngine() {
+    drain();
+
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    requestAdded.notify_all();
+    for(int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+bool ThreadPoolIOEngine::startRequest(const ioRequest &request) {
+    {
+        lock_guard<mutex> guard(queueLock);
+        pendingRequests.push_back(request);
+    }
+    requestAdded.notify_one();
+    return true;
+}
+
+int ThreadPoolIOEngine::reapCompletion() {
+    unique_lock<mutex> guard(queueLock);
+    requestFinished.wait(guard, [this] { return !finishedTags.empty(); });
+    int tag = finishedTags.front();
+    finishedTags.pop_front();
+    return tag;
+}
+
+void ThreadPoolIOEngine::work() {
+    while(true) {
+        // wait for request
+        ioRequest request;
+        {
+            unique_lock<mutex> guard(queueLock);
+            requestAdded.wait(guard, [this] { return stopping || !pendingRequests.empty(); });
+            if(pendingRequests.empty()) {
+                return;
+            }
+            request = pendingRequests.front();
+            pendingRequests.pop_front();
+        }
+
+        transfer(request);
+
+        // announce it is finished
+        {
+            lock_guard<mutex> guard(queueLock);
+            finishedTags.push_back(request.tag);
+        }
+        requestFinished.notify_one();
+    }
+}
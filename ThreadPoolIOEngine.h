@@ -0,0 +1,45 @@
+#ifndef ZOS_VFS_THREADPOOLIOENGINE_H
+#define ZOS_VFS_THREADPOOLIOENGINE_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "IOEngine.h"
+
+/*
+ * Class represents engine which does requests with pread/pwrite in pool of threads
+ */
+class ThreadPoolIOEngine : public IOEngine {
+public:
+    // constructor - starts threads
+    ThreadPoolIOEngine(BlockDevice *device, int queueDepth);
+    // destructor - waits for requests and stops threads
+    ~ThreadPoolIOEngine() override;
+
+protected:
+    bool startRequest(const ioRequest &request) override;
+    int reapCompletion() override;
+
+private:
+    // threads doing requests
+    vector<thread> workers;
+    // requests which were not started by any thread
+    deque<ioRequest> pendingRequests;
+    // tags of finished requests
+    deque<int> finishedTags;
+    // lock of both queues
+    mutex queueLock;
+    // signals new pending request
+    condition_variable requestAdded;
+    // signals new finished request
+    condition_variable requestFinished;
+    // if threads should end
+    bool stopping;
+
+    // work of one thread
+    void work();
+};
+
+
+#endif
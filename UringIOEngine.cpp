@@ -0,0 +1,165 @@
+#include "UringIOEngine.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// set up io_uring with given count of entries
+static int uringSetup(unsigned entries, io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+// submit requests and/or wait for completions
+static int uringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+UringIOEngine::UringIOEngine(BlockDevice *device, int queueDepth): IOEngine(device, queueDepth) {
+    ringFd = -1;
+    sqRing = MAP_FAILED;
+    sqRingSize = 0;
+    cqRing = MAP_FAILED;
+    cqRingSize = 0;
+    sqes = (io_uring_sqe *) MAP_FAILED;
+    sqEntries = 0;
+}
+
+UringIOEngine::~UringIOEngine() {
+    if(ringFd != -1) {
+        drain();
+    }
+
+    // release mappings and ring
+    if(sqes != MAP_FAILED) {
+        munmap(sqes, sqEntries * sizeof(io_uring_sqe));
+    }
+    if(cqRing != MAP_FAILED && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if(sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+    }
+    if(ringFd != -1) {
+        close(ringFd);
+    }
+}
+
+bool UringIOEngine::init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = uringSetup(queueDepth, &params);
+    if(ringFd < 0) {
+        ringFd = -1;
+        return false;
+    }
+
+    // map rings, kernels with single mmap feature share one mapping for both
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = max(sqRingSize, cqRingSize);
+        cqRingSize = sqRingSize;
+    }
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if(sqRing == MAP_FAILED) {
+        return false;
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing = sqRing;
+    }
+    else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if(cqRing == MAP_FAILED) {
+            return false;
+        }
+    }
+    sqEntries = params.sq_entries;
+    sqes = (io_uring_sqe *) mmap(nullptr, sqEntries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        return false;
+    }
+
+    // fields of rings
+    sqTail = (unsigned *) ((char *) sqRing + params.sq_off.tail);
+    sqMask = (unsigned *) ((char *) sqRing + params.sq_off.ring_mask);
+    sqArray = (unsigned *) ((char *) sqRing + params.sq_off.array);
+    cqHead = (unsigned *) ((char *) cqRing + params.cq_off.head);
+    cqTail = (unsigned *) ((char *) cqRing + params.cq_off.tail);
+    cqMask = (unsigned *) ((char *) cqRing + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe *) ((char *) cqRing + params.cq_off.cqes);
+
+    // one slot for every request in flight
+    slots.resize(queueDepth);
+    slotVectors.resize(queueDepth);
+    for(int i = queueDepth - 1; i >= 0; i--) {
+        freeSlots.push_back(i);
+    }
+    return true;
+}
+
+bool UringIOEngine::startRequest(const ioRequest &request) {
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    slots[slot] = request;
+    slotVectors[slot].iov_base = request.buffer;
+    slotVectors[slot].iov_len = request.bytesCount;
+
+    // fill entry (vectored operations are supported by all kernels with io_uring)
+    unsigned tail = *sqTail;
+    unsigned idx = tail & *sqMask;
+    io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = request.fd;
+    sqe->addr = (unsigned long long) &slotVectors[slot];
+    sqe->len = 1;
+    sqe->off = request.address;
+    sqe->user_data = slot;
+    sqArray[idx] = idx;
+
+    // publish entry and submit it
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    int submitted;
+    do {
+        submitted = uringEnter(ringFd, 1, 0, 0);
+    } while(submitted < 0 && errno == EINTR);
+
+    if(submitted != 1) {
+        // entry was not taken by kernel, so it is taken back
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        freeSlots.push_back(slot);
+        return false;
+    }
+    return true;
+}
+
+int UringIOEngine::reapCompletion() {
+    while(true) {
+        unsigned head = *cqHead;
+        if(head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            // nothing is finished - wait for one
+            uringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+            continue;
+        }
+
+        io_uring_cqe *cqe = &cqes[head & *cqMask];
+        int slot = (int) cqe->user_data;
+        int result = cqe->res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+        // failed or partial request is finished synchronously
+        ioRequest &request = slots[slot];
+        if(result < request.bytesCount) {
+            int bytesDone = result > 0 ? result : 0;
+            ioRequest rest = request;
+            rest.buffer += bytesDone;
+            rest.address += bytesDone;
+            rest.bytesCount -= bytesDone;
+            transfer(rest);
+        }
+
+        freeSlots.push_back(slot);
+        return request.tag;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef ZOS_VFS_URINGIOENGINE_H
+#define ZOS_VFS_URINGIOENGINE_H
+
+#include <vector>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "IOEngine.h"
+
+/*
+ * Class represents engine which submits requests to io_uring of kernel (raw system calls, no liburing)
+ */
+class UringIOEngine : public IOEngine {
+public:
+    // constructor
+    UringIOEngine(BlockDevice *device, int queueDepth);
+    // destructor - waits for requests and releases ring
+    ~UringIOEngine() override;
+    // set up ring, false if kernel does not provide io_uring
+    bool init();
+
+protected:
+    bool startRequest(const ioRequest &request) override;
+    int reapCompletion() override;
+
+private:
+    // file descriptor of ring, -1 if it was not set up
+    int ringFd;
+    // mapped submission queue ring
+    void *sqRing;
+    // size of mapped submission queue ring
+    size_t sqRingSize;
+    // mapped completion queue ring (can be the same mapping as submission queue ring)
+    void *cqRing;
+    // size of mapped completion queue ring
+    size_t cqRingSize;
+    // mapped submission queue entries
+    io_uring_sqe *sqes;
+    // count of submission queue entries
+    unsigned sqEntries;
+    // fields of submission queue ring
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    // fields of completion queue ring
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    io_uring_cqe *cqes;
+    // started requests by slot (slot index is user data of request)
+    vector<ioRequest> slots;
+    // vectors of started requests by slot, they must live until request is finished
+    vector<iovec> slotVectors;
+    // indexes of free slots
+    vector<int> freeSlots;
+};
+
+
+#endif
@@ -1,15 +1,54 @@
 #ifndef ZOS_VFS_VFSDEFINITIONS_H
 #define ZOS_VFS_VFSDEFINITIONS_H
 
-// empty keyword
-const char EMPTY = 0;
-// full keyword
-const char FULL = 1;
-
 /*
  * Struct represents super block of VFS
  */
 typedef struct theSuperBlock {
+    // magic number identifying VFS image
+    int magic;
+    // version of on-disk format
+    int version;
+    // features chosen at format time (FEATURE_* flags in Constants)
+    int features;
+    // size of one cluster [B]
+    int clusterSize;
+    // count of clusters
+    int clusterCount;
+    // count of inodes
+    int inodesCount;
+    // overall size of VFS [B]
+    long long diskSize;
+    // address of start of inode bitmap
+    long long inodesBitmapAddress;
+    // address of start of data clusters bitmap
+    long long dataClustersBitmapAddress;
+    // address of start of inodes
+    long long inodesAddress;
+    // address of start of data clusters
+    long long dataClustersAddress;
+    // address of start of bitmap of fragments shared by tails of files (used only with FEATURE_TAIL_PACKING)
+    long long fragmentsBitmapAddress;
+    // address of start of counts of references to shared data clusters (used only with FEATURE_REFLINK)
+    long long clusterRefsAddress;
+    // address of start of hashes of content of data clusters (used only with FEATURE_DEDUP)
+    long long chunkHashesAddress;
+    // address of start of journal of metadata (used only with FEATURE_JOURNAL)
+    long long journalAddress;
+    // size of journal of metadata [B]
+    long long journalSize;
+} superBlock;
+
+/*
+ * Struct represents super block of VFS images of version 2 (32-bit sizes and addresses)
+ */
+typedef struct theSuperBlock32 {
+    // magic number identifying VFS image
+    int magic;
+    // version of on-disk format
+    int version;
+    // features chosen at format time (FEATURE_* flags in Constants)
+    int features;
     // overall size of VFS [B]
     int diskSize;
     // size of one cluster [B]
@@ -26,7 +65,49 @@ typedef struct theSuperBlock {
     int inodesAddress;
     // address of start of data clusters
     int dataClustersAddress;
-} superBlock;
+} superBlock32;
+
+/*
+ * Struct represents super block of VFS images created before versioning (bitmaps with one byte per item)
+ */
+typedef struct theLegacySuperBlock {
+    // overall size of VFS [B]
+    int diskSize;
+    // size of one cluster [B]
+    int clusterSize;
+    // count of clusters
+    int clusterCount;
+    // count of inodes
+    int inodesCount;
+    // address of start of inode bitmap
+    int inodesBitmapAddress;
+    // address of start of data clusters bitmap
+    int dataClustersBitmapAddress;
+    // address of start of inodes
+    int inodesAddress;
+    // address of start of data clusters
+    int dataClustersAddress;
+} legacySuperBlock;
+
+/*
+ * Struct represents run of contiguous data clusters
+ */
+typedef struct theExtent {
+    // index of first data cluster
+    int start;
+    // count of data clusters
+    int length;
+} clusterExtent;
+
+/*
+ * Struct represents header of cluster which is a node of clusterExtent tree
+ */
+typedef struct theExtentNodeHeader {
+    // depth of node - 0 for leaf with extents, 1 for node with references to leaves
+    int depth;
+    // count of used entries in node
+    int count;
+} extentNodeHeader;
 
 /*
  * Struct represents inode of VFS
@@ -34,18 +115,51 @@ typedef struct theSuperBlock {
 typedef struct theInode {
     // if inode represents a directory
     bool isDirectory;
+    // INODE_FLAG_* flags in Constants (stored in padding, used only with FEATURE_INLINE_DATA)
+    unsigned char flags;
+    // index of first fragment of tail of file in the last data cluster (used only with INODE_FLAG_TAIL)
+    unsigned short tailFragment;
     // number of references pointing to this inode (used with hardlinks)
     int references;
     // size of item [B]
-    int size;
-    // direct references to data clusters
-    int directs[5];
-    // reference to data cluster with references to data clusters with actual data - first level indirect reference
-    int indirect1;
-    // reference to data cluster with references to data clusters with references to data clusters with actual data - second level indirect reference
-    int indirect2;
+    long long size;
+    // references to data clusters - layout is chosen at format time
+    union {
+        // classic layout
+        struct {
+            // direct references to data clusters
+            int directs[5];
+            // reference to data cluster with references to data clusters with actual data - first level indirect reference
+            int indirect1;
+            // reference to data cluster with references to data clusters with references to data clusters with actual data - second level indirect reference
+            int indirect2;
+        };
+        // extent layout
+        struct {
+            // first extents of item, unused extents have zero length
+            clusterExtent extents[3];
+            // reference to root cluster of extent tree with the rest of extents, -1 if there is no tree
+            int extentTree;
+        };
+        // data of small file stored in inode instead of data clusters (takes also padding at the end of inode)
+        char inlineData[32];
+    };
 } inode;
 
+/*
+ * Struct represents inode of VFS images of version 2 and older (32-bit size)
+ */
+typedef struct theInode32 {
+    // if inode represents a directory
+    bool isDirectory;
+    // number of references pointing to this inode (used with hardlinks)
+    int references;
+    // size of item [B]
+    int size;
+    // references to data clusters (same as in inode)
+    int clusterReferences[7];
+} inode32;
+
 /*
  * Struct represents one item of a dctory
  */
@@ -56,5 +170,18 @@ typedef struct theDirectoryItem {
     char name[12];
 } directoryItem;
 
+/*
+ * Struct represents header of frame of server protocol (native byte order, client is on the same host), payload follows header -
+ * request frames carry commands, response frames carry output of command of request with the same id and end of command
+ */
+typedef struct theFrameHeader {
+    // id of request chosen by client
+    unsigned int requestId;
+    // FRAME_* type in Constants
+    unsigned int type;
+    // count of bytes of payload
+    unsigned int length;
+} frameHeader;
+
 
 #endif
\ No newline at end of file
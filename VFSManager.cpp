@@ -1,215 +1,568 @@
 #include "VFSManager.h"
 #include "Constants.h"
 #include "StringUtils.h"
+#include "LzCodec.h"
 #include <string>
 #include <stdio.h>
 #include <stdlib.h>
 #include <cstring>
 #include <iostream>
 #include <vector>
-#include <fstream>
+#include <deque>
+#include <sstream>
 #include <math.h>
+#include <climits>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <functional>
+#include <stdexcept>
 
 using namespace std;
 
-VFSManager::VFSManager(char *vfsName): sb() {
+VFSManager::VFSManager(char *vfsName, BlockDevice *device, IOEngine *ioEngine): sb(), dentryCache(Constants::DENTRY_CACHE_SIZE) {
     this->vfsName = vfsName;
-    path[0] = Constants::PATH_DELIM;
-    path[1] = '\0';
-    inodesBitmap = nullptr;
-    dataBitmap = nullptr;
+    this->device = device;
+    this->ioEngine = ioEngine;
+    inodesMapped = false;
     inodes = nullptr;
-    currentInode = 0;
     formatted = false;
-    fp = NULL;
+    blockMapCacheSize = 0;
+    compressedBytesIn = 0;
+    compressedBytesOut = 0;
+    rawChunksCount = 0;
+    compressionTime = 0;
+    groupCommit = false;
+    savepointFreeClusters = 0;
+    savepointFreeFragments = 0;
+    journal.open(device, 0, 0, false);
 
     // load vfs if exists
-    fp = fopen(vfsName,"rb+");
-    if(fp != NULL) {
+    if(device->open(vfsName)) {
         // read super block
-        fread(&sb, sizeof(sb), 1, fp);
-
-        // read inodes bitmap
-        inodesBitmap = (char *) malloc(sb.inodesCount * sizeof(char));
-        fread(inodesBitmap, sizeof(char), sb.inodesCount, fp);
-
-        // read data clusters bitmap
-        dataBitmap = (char *) malloc(sb.clusterCount * sizeof(char));
-        fread(dataBitmap, sizeof(char), sb.clusterCount, fp);
-
-        // read inodes
-        inodes = (inode *) malloc(sb.inodesCount * sizeof(inode));
-        fread(inodes, sizeof(inode), sb.inodesCount, fp);
-
-        formatted = true;
+        readImage(0, &sb, sizeof(sb));
+
+        if(sb.magic == Constants::VFS_MAGIC && sb.version == Constants::FORMAT_VERSION && (sb.features & ~Constants::SUPPORTED_FEATURES) == 0) {
+            // image in current format
+            openJournal();
+            loadMetadata();
+            openBufferCache();
+            formatted = true;
+        }
+        else if(((sb.magic != Constants::VFS_MAGIC && migrateLegacyImage()) || sb.magic == Constants::VFS_MAGIC) && convertImage32()) {
+            // image from the time before versioning or with 32-bit sizes - it was converted
+            cout << Constants::IMAGE_MIGRATED_MSG << endl;
+            if(device->getMemory() != nullptr) {
+                // converted metadata will be accessed in image in memory
+                loadMetadata();
+            }
+            openBufferCache();
+            formatted = true;
+        }
+        else {
+            cout << Constants::UNKNOWN_IMAGE_MSG << endl;
+        }
     }
 }
 
 VFSManager::~VFSManager() {
-    if(fp != NULL) {
-        fclose(fp);
+    delete ioEngine;
+    for(int i = 0; i < packBuffers.size(); i++) {
+        free(packBuffers[i]);
+    }
+    bufferCache.flush();
+    journal.close();
+    detachMetadata();
+    if(inodes != nullptr) {
+        free(inodes);
     }
+    device->close();
+    delete device;
 }
 
-void VFSManager::handleCommand(string commandLine) {
+void VFSManager::handleCommand(Session &session, string commandLine) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
     // get the parts of command
     vector<string> parts = StringUtils::split(commandLine, Constants::COMMAND_DELIM);
 
+    if(!parts.empty() && readsOnly(parts[0])) {
+        // commands which only read image (or change only session) run at once
+        shared_lock<shared_timed_mutex> readLock(imageLock);
+        try {
+            executeCommand(session, parts);
+        }
+        catch(const exception &e) {
+            // image was not changed, only command fails
+            session.getOutput() << e.what() << endl;
+        }
+    }
+    else if(changesOwnItems(parts) && executeConcurrently(session, parts)) {
+        // changes of commands which ran at once are committed together when none of them runs
+        unique_lock<shared_timed_mutex> writeLock(imageLock);
+        if(formatted) {
+            saveMetadata();
+        }
+    }
+    else {
+        unique_lock<shared_timed_mutex> writeLock(imageLock);
+        try {
+            executeCommand(session, parts);
+        }
+        catch(const exception &e) {
+            // command cannot be finished (image is full or corrupted), its changes are dropped and other commands go on
+            session.getOutput() << e.what() << endl;
+            if(formatted) {
+                abortChanges();
+            }
+        }
+        // changes of failed command are committed too, so readers never change journal or buffer cache
+        if(formatted) {
+            saveMetadata();
+        }
+    }
+
+    session.commandHandled(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+void VFSManager::executeCommand(Session &session, const vector<string> &parts) {
     if(parts.empty()) {
-        cout << Constants::UNKNOWN_COMMAND_MSG << endl;
+        session.getOutput() << Constants::UNKNOWN_COMMAND_MSG << endl;
         return;
     }
 
+    // current dir could be removed by another session or image could be formatted
+    if(formatted) {
+        InodeGuard guard(&inodeLocks);
+        guard.lockShared(session.getCurrentInode());
+        if(!inodesBitmap.isFull(session.getCurrentInode()) || !inodes[session.getCurrentInode()].isDirectory) {
+            session.changeToRoot();
+        }
+    }
+
     string command = parts[0];
 
     // execute command
     if(command != Constants::FORMAT && !formatted) {
-        cout << Constants::NOT_FORMATTED_MSG << endl;
+        session.getOutput() << Constants::NOT_FORMATTED_MSG << endl;
+    }
+    else if((int) parts.size() - 1 < getArgumentsCount(command)) {
+        // missing arguments
+        session.getOutput() << Constants::UNKNOWN_COMMAND_MSG << endl;
     }
     else if(command == Constants::CP) {
-        cp(parts[1], parts[2]);
+        cp(session, parts[1], parts[2]);
     }
     else if(command == Constants::MV) {
-        mv(parts[1], parts[2]);
+        mv(session, parts[1], parts[2]);
     }
     else if(command == Constants::RM) {
-        rm(parts[1]);
+        rm(session, parts[1]);
     }
     else if(command == Constants::MKDIR) {
-        mkdir(parts[1]);
+        mkdir(session, parts[1]);
     }
     else if(command == Constants::RMDIR) {
-        rmdir(parts[1]);
+        rmdir(session, parts[1]);
     }
     else if(command == Constants::LS) {
         if(parts.size() == 2) {
-            ls(parts[1]);
+            ls(session, parts[1]);
         }
         else {
-            ls("");
+            ls(session, "");
         }
     }
     else if(command == Constants::CAT) {
-        cat(parts[1]);
+        cat(session, parts[1]);
     }
     else if(command == Constants::CD) {
-        cd(parts[1]);
+        cd(session, parts[1]);
     }
     else if(command == Constants::PWD) {
-        pwd();
-        cout << endl;
+        pwd(session);
+        session.getOutput() << endl;
     }
     else if(command == Constants::INFO) {
-        info(parts[1]);
+        info(session, parts[1]);
+    }
+    else if(command == Constants::INCP && parts[1] == Constants::RECURSIVE_OPTION) {
+        if(parts.size() == 4) {
+            incpTree(session, parts[2], parts[3]);
+        }
+        else {
+            session.getOutput() << Constants::UNKNOWN_COMMAND_MSG << endl;
+        }
     }
     else if(command == Constants::INCP) {
-        incp(parts[1], parts[2]);
+        incp(session, parts[1], parts[2]);
+    }
+    else if(command == Constants::OUTCP && parts[1] == Constants::RECURSIVE_OPTION) {
+        if(parts.size() == 4) {
+            outcpTree(session, parts[2], parts[3]);
+        }
+        else {
+            session.getOutput() << Constants::UNKNOWN_COMMAND_MSG << endl;
+        }
     }
     else if(command == Constants::OUTCP) {
-        outcp(parts[1], parts[2]);
+        outcp(session, parts[1], parts[2]);
     }
     else if(command == Constants::LOAD) {
-        load(parts[1]);
+        load(session, parts[1]);
     }
     else if(command == Constants::FORMAT) {
-        format(parts[1]);
+        format(session, parts[1], vector<string>(parts.begin() + 2, parts.end()));
     }
     else if(command == Constants::LN) {
-        ln(parts[1], parts[2]);
+        ln(session, parts[1], parts[2]);
+    }
+    else if(command == Constants::STATS) {
+        stats(session);
+    }
+    else if(command == Constants::CACHE) {
+        if(parts.size() == 3) {
+            cache(session, parts[1], parts[2]);
+        }
+        else {
+            cache(session, parts[1], bufferCache.getPolicyName());
+        }
     }
     else {
-        cout << Constants::UNKNOWN_COMMAND_MSG << endl;
+        session.getOutput() << Constants::UNKNOWN_COMMAND_MSG << endl;
     }
 }
 
-void VFSManager::pwd() {
-    cout << path;
+int VFSManager::getArgumentsCount(const string &command) {
+    if(command == Constants::CP || command == Constants::MV || command == Constants::INCP || command == Constants::OUTCP
+            || command == Constants::LN) {
+        return 2;
+    }
+    if(command == Constants::RM || command == Constants::MKDIR || command == Constants::RMDIR || command == Constants::CAT
+            || command == Constants::CD || command == Constants::INFO || command == Constants::LOAD || command == Constants::FORMAT
+            || command == Constants::CACHE) {
+        return 1;
+    }
+    return 0;
 }
 
-void VFSManager::format(string size) {
-    // set new state
-    path[0] = Constants::PATH_DELIM;
-    path[1] = '\0';
-    currentInode = 0;
-    formatted = false;
+bool VFSManager::readsOnly(const string &command) {
+    return command == Constants::LS || command == Constants::CAT || command == Constants::PWD || command == Constants::INFO
+        || command == Constants::OUTCP || command == Constants::CD;
+}
+
+bool VFSManager::changesOwnItems(const vector<string> &parts) {
+    // copy of tree commits its groups itself
+    return !parts.empty() && (parts[0] == Constants::MKDIR || parts[0] == Constants::RMDIR || parts[0] == Constants::RM || parts[0] == Constants::LN
+        || (parts[0] == Constants::INCP && parts.size() > 1 && parts[1] != Constants::RECURSIVE_OPTION));
+}
+
+bool VFSManager::executeConcurrently(Session &session, const vector<string> &parts) {
+    shared_lock<shared_timed_mutex> readLock(imageLock);
+    // clusters shared by items (tails, reflinks, deduplicated and compressed chunks) are changed only by command which runs alone
+    if(!formatted || (sb.features & Constants::SHARED_STRUCTURES_FEATURES) != 0) {
+        return false;
+    }
+
+    try {
+        executeCommand(session, parts);
+    }
+    catch(const exception &e) {
+        // other commands go on, so changes are not dropped - command freed items it created
+        session.getOutput() << e.what() << endl;
+    }
+    return true;
+}
+
+void VFSManager::pwd(const Session &session) {
+    session.getOutput() << session.getPath();
+}
+
+void VFSManager::format(Session &session, string size, vector<string> options) {
+    // parse options
+    int features = Constants::FEATURE_INLINE_DATA | Constants::FEATURE_JOURNAL;
+    string allocation = Constants::ALLOC_SPARSE;
+    // 0 - not set, value of size class or default is used
+    int clusterSize = 0;
+    int bytesPerInode = 0;
+    string sizeClass = Constants::CLASS_GENERAL;
+    for(int i = 0; i < options.size(); i++) {
+        vector<string> option = StringUtils::split(options[i], Constants::OPTION_DELIM);
+        if(option.size() != 2) {
+            session.getOutput() << Constants::UNKNOWN_OPTION_MSG << endl;
+            return;
+        }
+
+        if(option[0] == Constants::OPTION_LAYOUT && option[1] == Constants::LAYOUT_EXTENTS) {
+            features |= Constants::FEATURE_EXTENTS;
+        }
+        else if(option[0] == Constants::OPTION_LAYOUT && option[1] == Constants::LAYOUT_CLASSIC) {
+            features &= ~Constants::FEATURE_EXTENTS;
+        }
+        else if(option[0] == Constants::OPTION_DIRS && option[1] == Constants::DIRS_HASH) {
+            features |= Constants::FEATURE_HASHED_DIRS;
+        }
+        else if(option[0] == Constants::OPTION_DIRS && option[1] == Constants::DIRS_LINEAR) {
+            features &= ~Constants::FEATURE_HASHED_DIRS;
+        }
+        else if(option[0] == Constants::OPTION_INLINE && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_INLINE_DATA;
+        }
+        else if(option[0] == Constants::OPTION_INLINE && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_INLINE_DATA;
+        }
+        else if(option[0] == Constants::OPTION_TAILS && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_TAIL_PACKING;
+        }
+        else if(option[0] == Constants::OPTION_TAILS && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_TAIL_PACKING;
+        }
+        else if(option[0] == Constants::OPTION_REFLINK && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_REFLINK;
+        }
+        else if(option[0] == Constants::OPTION_REFLINK && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_REFLINK;
+        }
+        else if(option[0] == Constants::OPTION_DEDUP && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_DEDUP;
+        }
+        else if(option[0] == Constants::OPTION_DEDUP && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_DEDUP;
+        }
+        else if(option[0] == Constants::OPTION_COMPRESS && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_COMPRESSION;
+        }
+        else if(option[0] == Constants::OPTION_COMPRESS && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_COMPRESSION;
+        }
+        else if(option[0] == Constants::OPTION_JOURNAL && option[1] == Constants::OPTION_ON) {
+            features |= Constants::FEATURE_JOURNAL;
+        }
+        else if(option[0] == Constants::OPTION_JOURNAL && option[1] == Constants::OPTION_OFF) {
+            features &= ~Constants::FEATURE_JOURNAL;
+        }
+        else if(option[0] == Constants::OPTION_ALLOC && (option[1] == Constants::ALLOC_SPARSE || option[1] == Constants::ALLOC_PREALLOC || option[1] == Constants::ALLOC_ZERO)) {
+            allocation = option[1];
+        }
+        else if(option[0] == Constants::OPTION_CLASS && (option[1] == Constants::CLASS_SMALL || option[1] == Constants::CLASS_GENERAL || option[1] == Constants::CLASS_MEDIA)) {
+            sizeClass = option[1];
+        }
+        else if(option[0] == Constants::OPTION_CLUSTER && StringUtils::isNumber(option[1]) && option[1].length() <= 7) {
+            // cluster size must be power of two in allowed range
+            clusterSize = stoi(option[1]);
+            if(clusterSize < Constants::MIN_CLUSTER_SIZE || clusterSize > Constants::MAX_CLUSTER_SIZE || (clusterSize & (clusterSize - 1)) != 0) {
+                session.getOutput() << Constants::UNKNOWN_OPTION_MSG << endl;
+                return;
+            }
+        }
+        else if(option[0] == Constants::OPTION_INODE_RATIO && StringUtils::isNumber(option[1]) && option[1].length() <= 9 && stoi(option[1]) > 0) {
+            bytesPerInode = stoi(option[1]);
+        }
+        else {
+            session.getOutput() << Constants::UNKNOWN_OPTION_MSG << endl;
+            return;
+        }
+    }
+
+    // deduplicated clusters are shared by counting references
+    if(features & Constants::FEATURE_DEDUP) {
+        features |= Constants::FEATURE_REFLINK;
+    }
+
+    // compressed chunks are stored in fragments of clusters, which are not shared by reference counts
+    if(features & Constants::FEATURE_COMPRESSION) {
+        if(features & Constants::FEATURE_REFLINK) {
+            session.getOutput() << Constants::OPTIONS_CONFLICT_MSG << endl;
+            return;
+        }
+        features |= Constants::FEATURE_TAIL_PACKING;
+    }
+
+    // values which were not set are taken from size class
+    if(sizeClass == Constants::CLASS_SMALL) {
+        clusterSize = clusterSize == 0 ? Constants::SMALL_CLUSTER_SIZE : clusterSize;
+        bytesPerInode = bytesPerInode == 0 ? Constants::SMALL_BYTES_PER_INODE : bytesPerInode;
+    }
+    else if(sizeClass == Constants::CLASS_MEDIA) {
+        clusterSize = clusterSize == 0 ? Constants::MEDIA_CLUSTER_SIZE : clusterSize;
+        bytesPerInode = bytesPerInode == 0 ? Constants::MEDIA_BYTES_PER_INODE : bytesPerInode;
+    }
+    else {
+        clusterSize = clusterSize == 0 ? Constants::CLUSTER_SIZE : clusterSize;
+        bytesPerInode = bytesPerInode == 0 ? Constants::BYTES_PER_INODE : bytesPerInode;
+    }
 
     // get size in bytes
-    int bytesSize = getBytesSize(size);
+    long long bytesSize = getBytesSize(size);
+    if(bytesSize < 0) {
+        session.getOutput() << Constants::INVALID_SIZE_MSG << endl;
+        return;
+    }
+
+    // journal takes small part of image (whole blocks), small image has no journal
+    long long journalSize = 0;
+    if(features & Constants::FEATURE_JOURNAL) {
+        journalSize = min((long long) Constants::JOURNAL_SIZE, bytesSize / Constants::JOURNAL_IMAGE_PART);
+        journalSize -= journalSize % Constants::SUPER_BLOCK_AREA_SIZE;
+        if(journalSize < Constants::MIN_JOURNAL_SIZE) {
+            features &= ~Constants::FEATURE_JOURNAL;
+            journalSize = 0;
+        }
+    }
+
+    // count of inodes and clusters - every cluster needs one bit in data bitmap, one word is reserved for rounding of bitmap to whole words
+    long long inodesCount = bytesSize / bytesPerInode;
+    long long clusterCount = 0;
+    // with tail packing every cluster needs also bits in fragments bitmap, with reflinks it needs count of references (rounded to whole words too)
+    int clusterBits = 1;
+    int bitmapsCount = 1;
+    if(features & Constants::FEATURE_TAIL_PACKING) {
+        clusterBits += Constants::FRAGMENTS_PER_CLUSTER;
+        bitmapsCount++;
+    }
+    if(features & Constants::FEATURE_REFLINK) {
+        clusterBits += sizeof(uint16_t) * 8;
+        bitmapsCount++;
+    }
+    if(features & Constants::FEATURE_DEDUP) {
+        clusterBits += sizeof(uint64_t) * 8;
+    }
+    if(inodesCount > 0 && inodesCount <= INT_MAX) {
+        long long clustersAreaSize = bytesSize - Constants::SUPER_BLOCK_AREA_SIZE - journalSize - Bitmap::bytesSizeFor(inodesCount) - sizeof(inode) * inodesCount - sizeof(uint64_t) * bitmapsCount;
+        clusterCount = (clustersAreaSize * 8) / ((long long) clusterSize * 8 + clusterBits);
+    }
+    if(clusterCount <= 0 || clusterCount * clusterBits > INT_MAX) {
+        // there is no space for data or there are too many items
+        session.getOutput() << Constants::BAD_LAYOUT_MSG << endl;
+        return;
+    }
+
+    // set new state
+    formatted = false;
 
     // set super block
+    sb.magic = Constants::VFS_MAGIC;
+    sb.version = Constants::FORMAT_VERSION;
+    sb.features = features;
     sb.diskSize = bytesSize;
-    sb.clusterSize = Constants::CLUSTER_SIZE;
-    sb.inodesCount = (bytesSize * Constants::INODES_BITMAP_SIZE_RATIO) / 1;
-    sb.clusterCount = (bytesSize - sizeof(superBlock) - sizeof(char) * sb.inodesCount - sizeof(inode) * sb.inodesCount) / (Constants::CLUSTER_SIZE + 1);
-
-    // set addresses
-    sb.inodesBitmapAddress = sizeof(superBlock);
-    sb.dataClustersBitmapAddress = sb.inodesBitmapAddress + sizeof(char) * sb.inodesCount;
-    sb.inodesAddress = sb.dataClustersBitmapAddress + sizeof(char) * sb.clusterCount;
+    sb.clusterSize = clusterSize;
+    sb.inodesCount = inodesCount;
+    sb.clusterCount = clusterCount;
+
+    // set addresses - journal follows super block
+    sb.journalAddress = journalSize == 0 ? 0 : Constants::SUPER_BLOCK_AREA_SIZE;
+    sb.journalSize = journalSize;
+    sb.inodesBitmapAddress = Constants::SUPER_BLOCK_AREA_SIZE + journalSize;
+    sb.dataClustersBitmapAddress = sb.inodesBitmapAddress + Bitmap::bytesSizeFor(sb.inodesCount);
+    sb.fragmentsBitmapAddress = 0;
+    sb.inodesAddress = sb.dataClustersBitmapAddress + Bitmap::bytesSizeFor(sb.clusterCount);
+    if(sb.features & Constants::FEATURE_TAIL_PACKING) {
+        // fragments bitmap follows data clusters bitmap
+        sb.fragmentsBitmapAddress = sb.inodesAddress;
+        sb.inodesAddress += FragmentAllocator::bytesSizeFor(sb.clusterCount);
+    }
+    sb.clusterRefsAddress = 0;
+    if(sb.features & Constants::FEATURE_REFLINK) {
+        // counts of references follow bitmaps
+        sb.clusterRefsAddress = sb.inodesAddress;
+        sb.inodesAddress += ClusterRefCounts::bytesSizeFor(sb.clusterCount);
+    }
+    sb.chunkHashesAddress = 0;
+    if(sb.features & Constants::FEATURE_DEDUP) {
+        // hashes of clusters follow counts of references
+        sb.chunkHashesAddress = sb.inodesAddress;
+        sb.inodesAddress += ChunkIndex::bytesSizeFor(sb.clusterCount);
+    }
     sb.dataClustersAddress = sb.inodesAddress + sizeof(inode) * sb.inodesCount;
 
     // free vfs in memory
-    if(inodesBitmap != NULL) {
-        free(inodesBitmap);
-    }
-    if(dataBitmap != NULL) {
-        free(dataBitmap);
-    }
+    detachMetadata();
     if(inodes != NULL) {
         free(inodes);
     }
+    blockMapCache.clear();
+    blockMapCacheSize = 0;
+    dentryCache.clear();
+    pendingFreeClusters.clear();
+    pendingFreeFragments.clear();
+    savepointFreeClusters = 0;
+    savepointFreeFragments = 0;
 
     // allocate space and init
-    inodesBitmap = (char *) malloc(sb.inodesCount * sizeof(char));
-    memset(inodesBitmap, EMPTY, sb.inodesCount);
-    dataBitmap = (char *) malloc(sb.clusterCount * sizeof(char));
-    memset(dataBitmap, EMPTY, sb.clusterCount);
-    inodes = (inode *) malloc(sb.inodesCount * sizeof(inode));
-
-    // save vfs on hard drive
-    if(fp != NULL) {
-        fclose(fp);
-    }
-    fp = fopen(vfsName, "wb+");
-    if (fp == NULL)
-    {
+    inodesBitmap.init(sb.inodesCount);
+    dataBitmap.init(sb.clusterCount);
+    fragments.init(sb.features & Constants::FEATURE_TAIL_PACKING ? sb.clusterCount : 0);
+    clusterRefs.init(sb.features & Constants::FEATURE_REFLINK ? sb.clusterCount : 0);
+    chunkIndex.init(sb.features & Constants::FEATURE_DEDUP ? sb.clusterCount : 0);
+    // zeroed pages are provided by the system when they are touched
+    inodes = (inode *) calloc(sb.inodesCount, sizeof(inode));
+    dirtyInodes.init(sb.inodesCount * sizeof(inode));
+
+    // save vfs on hard drive - new image has its size and it is filled with zeros (sparse file)
+    device->close();
+    if(!device->create(vfsName, bytesSize)) {
         // cannot create file
-        cout << Constants::CANNOT_CREATE_FILE << endl;
+        session.getOutput() << Constants::CANNOT_CREATE_FILE << endl;
         return;
     }
-    fwrite(&sb, sizeof(sb), 1, fp);
-    fwrite(inodesBitmap, sizeof(char), sb.inodesCount, fp);
-    fwrite(dataBitmap, sizeof(char), sb.clusterCount, fp);
-    fwrite(inodes, sizeof(inode), sb.inodesCount, fp);
-    int bytesLeft = bytesSize - sizeof(superBlock) - sizeof(char) * sb.inodesCount - sizeof(char) * sb.clusterCount - sizeof(inode) * sb.inodesCount;
-    char *dataPlaceholder = (char *) malloc(bytesLeft * sizeof(char));
-    memset(dataPlaceholder, 0, bytesLeft);
-    fwrite(dataPlaceholder, sizeof(char), bytesLeft, fp);
-    free(dataPlaceholder);
-    fflush(fp);
+    if(allocation == Constants::ALLOC_PREALLOC && !device->allocate(bytesSize)) {
+        // file stays sparse
+        session.getOutput() << Constants::PREALLOC_FAILED_MSG << endl;
+    }
+    else if(allocation == Constants::ALLOC_ZERO) {
+        // zeros are written to data area - more clusters at once
+        int batchClusters = getBatchClusters();
+        int batchSize = sb.clusterSize * batchClusters;
+        char *zeros = (char *) calloc(batchSize, sizeof(char));
+        for(long long address = sb.dataClustersAddress; address < bytesSize; address += batchSize) {
+            writeImage(address, zeros, min((long long) batchSize, bytesSize - address));
+        }
+        free(zeros);
+    }
+
+    // only non-zero metadata are written - inodes are empty
+    saveSuperBlock();
+    writeImage(sb.inodesBitmapAddress, inodesBitmap.getWords(), inodesBitmap.getBytesSize());
+    writeImage(sb.dataClustersBitmapAddress, dataBitmap.getWords(), dataBitmap.getBytesSize());
+    if(sb.features & Constants::FEATURE_TAIL_PACKING) {
+        writeImage(sb.fragmentsBitmapAddress, fragments.getWords(), fragments.getBytesSize());
+    }
+    journal.open(device, sb.journalAddress, sb.journalSize, device->getMemory() == nullptr);
+    journal.format();
+    openBufferCache();
+    flushImage();
+
+    // metadata of new image will be accessed in image in memory
+    if(device->getMemory() != nullptr) {
+        loadMetadata();
+    }
 
     // set initial state - root dir
-    inodesBitmap[0] = FULL;
-    inodes[0].isDirectory = true;
-    inodes[0].references = 1;
-    inodes[0].size = 0;
+    inodesBitmap.setFull(0);
+    initInode(0, true, 1);
     addTraversalReference(0, 0);
     saveMetadata();
 
-    // now vfs is formatted
+    // now vfs is formatted, directories of session do not exist anymore
     formatted = true;
-    cout << Constants::COMMAND_SUCCESS << endl;
+    session.changeToRoot();
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::cp(string source, string target) {
+void VFSManager::cp(Session &session, string source, string target) {
     int sourceParentInodeIdx;
-    char *sourceName;
+    char *sourceName = nullptr;
     // parse path
-    parseParentPath(source, &sourceParentInodeIdx, &sourceName);
+    parseParentPath(session, source, &sourceParentInodeIdx, &sourceName);
 
     // inode not exist - file not found
     if(sourceParentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
+        free(sourceName);
         return;
     }
 
@@ -217,18 +570,21 @@ void VFSManager::cp(string source, string target) {
     int sourceInodeIdx = getItemInodeIdxByName(sourceParentInodeIdx, sourceName);
     // check if it was found and if it is file
     if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE || inodes[sourceInodeIdx].isDirectory) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
+        free(sourceName);
         return;
     }
 
     int targetParentInodeIdx;
-    char *targetName;
+    char *targetName = nullptr;
     // parse path
-    parseParentPath(target, &targetParentInodeIdx, &targetName);
+    parseParentPath(session, target, &targetParentInodeIdx, &targetName);
 
     // inode not exist - path not found
     if(targetParentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        free(targetName);
+        free(sourceName);
         return;
     }
 
@@ -245,77 +601,149 @@ void VFSManager::cp(string source, string target) {
         else {
             // if it is file
             if(sourceParentInodeIdx != targetParentInodeIdx) {
-                rm(target);
+                rm(session, target);
             }
             else {
                 if(strcmp(sourceName, targetName) == 0) {
-                    cout << Constants::COMMAND_SUCCESS << endl;
+                    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+                    free(targetName);
+                    free(sourceName);
                     return;
                 }
                 else {
-                    rm(target);
+                    rm(session, target);
                 }
             }
         }
     }
 
-    // create inode, mark it in inode map and init it
-    int newInodeIdx = getFreeInodeIdx();
-    inodesBitmap[newInodeIdx] = FULL;
-    inodes[newInodeIdx].isDirectory = false;
-    inodes[newInodeIdx].references = 1;
-    inodes[newInodeIdx].size = 0;
-
-    // add dir item to new parent folder
-    if(targetIsDirFlag) {
-        addDirectoryItem(targetParentInodeIdx, newInodeIdx, sourceName);
-    }
-    else {
-        addDirectoryItem(targetParentInodeIdx, newInodeIdx, targetName);
+    // check if item fits to target dir
+    if(!directoryHasSpace(targetParentInodeIdx)) {
+        session.getOutput() << Constants::DIR_FULL_MSG << endl;
+        free(targetName);
+        free(sourceName);
+        return;
     }
 
-    // now copy the data
-    // get the source data clusters indexes
-    int bytesSize = inodes[sourceInodeIdx].size;
-    vector<int> clustersToCopyIdxs = getDataClustersIdxs(sourceInodeIdx, ceil(bytesSize / (double) sb.clusterSize));
-    // load file data and write it to new location
-    char *buffer = (char *) malloc(sb.clusterSize * sizeof(char));
-    memset(buffer, 0, sb.clusterSize);
-    for(int i = 0; i < clustersToCopyIdxs.size(); i++) {
-        int bytesRead;
-        if(bytesSize >= sb.clusterSize) {
-            bytesRead = sb.clusterSize;
+    // buffers of data are allocated when data are copied
+    char *buffers = nullptr;
+    try {
+        // create inode, mark it in inode map and init it
+        int newInodeIdx = allocateInodeIdx();
+        initInode(newInodeIdx, false, 1);
+
+        // add dir item to new parent folder
+        if(targetIsDirFlag) {
+            addDirectoryItem(targetParentInodeIdx, newInodeIdx, sourceName);
         }
         else {
-            bytesRead = bytesSize;
+            addDirectoryItem(targetParentInodeIdx, newInodeIdx, targetName);
+        }
+
+        if(isInline(sourceInodeIdx)) {
+            // data are copied with inode
+            inodes[newInodeIdx].flags = inodes[sourceInodeIdx].flags;
+            inodes[newInodeIdx].size = inodes[sourceInodeIdx].size;
+            memcpy(inodes[newInodeIdx].inlineData, inodes[sourceInodeIdx].inlineData, Constants::INLINE_DATA_SIZE);
+            markInodeDirty(newInodeIdx);
+
+            free(targetName);
+            free(sourceName);
+            session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+            return;
+        }
+
+        if((sb.features & Constants::FEATURE_REFLINK) && reflinkData(sourceInodeIdx, newInodeIdx)) {
+            // copy shares data clusters of source
+            free(targetName);
+            free(sourceName);
+            session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+            return;
+        }
+
+        // now copy the data
+        // get the source data clusters indexes
+        long long bytesSize = inodes[sourceInodeIdx].size;
+        vector<int> clustersToCopyIdxs = getDataClustersIdxs(sourceInodeIdx, ceil(bytesSize / (double) sb.clusterSize));
+        // load file data and write it to new location - more clusters at once, writes of several batches are in flight
+        int batchClusters = getBatchClusters();
+        int batchSize = sb.clusterSize * batchClusters;
+        int buffersCount = ioEngine->getQueueDepth();
+        buffers = (char *) malloc(batchSize * buffersCount * sizeof(char));
+        vector<int> pendingRequests(buffersCount, 0);
+        vector<int> freeBuffers;
+        for(int i = 0; i < buffersCount; i++) {
+            freeBuffers.push_back(i);
         }
+        int i = 0;
+        while(i < clustersToCopyIdxs.size()) {
+            int bufferIdx = waitForFreeBuffer(&pendingRequests, &freeBuffers);
+            char *buffer = buffers + bufferIdx * batchSize;
+            int bufferBytes = 0;
+            for(int j = 0; j < batchClusters && i < clustersToCopyIdxs.size(); ) {
+                if(isCompressed(sourceInodeIdx)) {
+                    // compressed chunks are loaded one by one
+                    int bytesRead = min(bytesSize, (long long) sb.clusterSize);
+                    readCompressedChunk(clustersToCopyIdxs[i], buffer + bufferBytes, bytesRead);
+                    bufferBytes += bytesRead;
+                    bytesSize -= bytesRead;
+                    i++;
+                    j++;
+                    continue;
+                }
 
-        // load data
-        fseek(fp, sb.dataClustersAddress + clustersToCopyIdxs[i] * sb.clusterSize, SEEK_SET);
-        fread(buffer, sizeof(char), bytesRead, fp);
+                // contiguous source clusters are loaded at once
+                int runLength = getClustersRunLength(clustersToCopyIdxs, i, batchClusters - j);
+                if(hasPackedTail(sourceInodeIdx) && i + runLength == clustersToCopyIdxs.size() && runLength > 1) {
+                    // packed tail is loaded separately
+                    runLength--;
+                }
+                int bytesRead = min(bytesSize, (long long) runLength * sb.clusterSize);
+
+                // load data
+                readImage(sb.dataClustersAddress + getChunkAddress(sourceInodeIdx, i, clustersToCopyIdxs[i]), buffer + bufferBytes, bytesRead);
+
+                bufferBytes += bytesRead;
+                bytesSize -= bytesRead;
+                i += runLength;
+                j += runLength;
+            }
 
-        // store data
-        addDataChunk(newInodeIdx, buffer, bytesRead);
-        memset(buffer, 0, sb.clusterSize);
-        bytesSize -= bytesRead;
+            // store data
+            pendingRequests[bufferIdx] = addDataChunks(newInodeIdx, buffer, bufferBytes, bufferIdx);
+            if(pendingRequests[bufferIdx] == 0) {
+                // all chunks were already stored
+                freeBuffers.push_back(bufferIdx);
+            }
+        }
     }
+    catch(...) {
+        // copy is not finished (image is full or corrupted), its buffers are freed after their writes
+        ioEngine->drain();
+        unwrittenChunks.clear();
+        free(buffers);
+        free(targetName);
+        free(sourceName);
+        throw;
+    }
+    ioEngine->drain();
+    unwrittenChunks.clear();
 
     free(targetName);
     free(sourceName);
-    free(buffer);
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    free(buffers);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::mv(string source, string target) {
+void VFSManager::mv(Session &session, string source, string target) {
     int sourceParentInodeIdx;
     char *sourceName;
     // parse path
-    parseParentPath(source, &sourceParentInodeIdx, &sourceName);
+    parseParentPath(session, source, &sourceParentInodeIdx, &sourceName);
 
     // inode not exist - file not found
     if(sourceParentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
@@ -323,18 +751,18 @@ void VFSManager::mv(string source, string target) {
     int sourceInodeIdx = getItemInodeIdxByName(sourceParentInodeIdx, sourceName);
     // check if it was found and if it is file
     if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE || inodes[sourceInodeIdx].isDirectory) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
     int targetParentInodeIdx;
     char *targetName;
     // parse path
-    parseParentPath(target, &targetParentInodeIdx, &targetName);
+    parseParentPath(session, target, &targetParentInodeIdx, &targetName);
 
     // inode not exist - path not found
     if(targetParentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
@@ -351,11 +779,17 @@ void VFSManager::mv(string source, string target) {
         else {
             // if it is file
             if(sourceParentInodeIdx != targetParentInodeIdx) {
-                rm(target);
+                rm(session, target);
             }
         }
     }
 
+    // check if item fits to target dir (it stays in the same dir otherwise)
+    if(targetParentInodeIdx != sourceParentInodeIdx && !directoryHasSpace(targetParentInodeIdx)) {
+        session.getOutput() << Constants::DIR_FULL_MSG << endl;
+        return;
+    }
+
     // delete source file from parent folder
     deleteItemFromParentCluster(sourceParentInodeIdx, sourceName);
     // add dir item to new parent folder
@@ -368,291 +802,231 @@ void VFSManager::mv(string source, string target) {
 
     free(targetName);
     free(sourceName);
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::rm(string target) {
+void VFSManager::rm(Session &session, string target) {
     int parentInodeIdx;
     char *targetName;
     // parse path
-    parseParentPath(target, &parentInodeIdx, &targetName);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
     // inode not exist - path not found
     if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
-    // get inode idx of target file
-    int deleteFileInodeIdx = getItemInodeIdxByName(parentInodeIdx, targetName);
+    // lock parent with target file and get inode idx of it
+    InodeGuard guard(&inodeLocks);
+    int deleteFileInodeIdx;
+    lockItem(&guard, parentInodeIdx, targetName, &deleteFileInodeIdx);
     // check if it was found and if it is file
     if(deleteFileInodeIdx == Constants::INODE_NOT_EXISTS_CODE || inodes[deleteFileInodeIdx].isDirectory) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
+        free(targetName);
         return;
     }
 
     if(inodes[deleteFileInodeIdx].references > 1) {
         // for hardlinks
         inodes[deleteFileInodeIdx].references -= 1;
+        markInodeDirty(deleteFileInodeIdx);
         deleteItemFromParentCluster(parentInodeIdx, targetName);
-        saveMetadata();
-        cout << Constants::COMMAND_SUCCESS << endl;
+        free(targetName);
+        session.getOutput() << Constants::COMMAND_SUCCESS << endl;
         return;
     }
 
     // if it is not hardlink
-    // delete file from parent folder
+    // delete file from parent folder and free its inode with clusters
     deleteItemFromParentCluster(parentInodeIdx, targetName);
+    freeItem(deleteFileInodeIdx);
 
-    // remove from inode bitmap
-    inodesBitmap[deleteFileInodeIdx] = EMPTY;
-
-    // delete data clusters from data bitmap
-    vector<int> dataClustersIdxs = getDataClustersIdxs(deleteFileInodeIdx, ceil(inodes[deleteFileInodeIdx].size / (double) sb.clusterSize));
-    for(int i = 0; i < dataClustersIdxs.size(); i++) {
-        dataBitmap[dataClustersIdxs[i]] = EMPTY;
-    }
-
-    // delete indirect clusters from data bitmap
-    vector<int> indirectClustersIdxs = getIndirectClustersIdxs(deleteFileInodeIdx, ceil(inodes[deleteFileInodeIdx].size / (double) sb.clusterSize));
-    for(int i = 0; i < indirectClustersIdxs.size(); i++) {
-        dataBitmap[indirectClustersIdxs[i]] = EMPTY;
-    }
-
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    free(targetName);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::mkdir(string target) {
+void VFSManager::mkdir(Session &session, string target) {
     int parentInodeIdx;
     char *targetName;
     // parse path
-    parseParentPath(target, &parentInodeIdx, &targetName);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
     // inode not exist - path not found
     if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
-    // check if name is unique
-    if(!itemNameUnique(parentInodeIdx, targetName)) {
-        cout << Constants::EXIST << endl;
+    // check if dir can be created in parent
+    InodeGuard guard(&inodeLocks);
+    guard.lockShared(parentInodeIdx);
+    if(!canAddItem(session, parentInodeIdx, targetName)) {
+        free(targetName);
         return;
     }
+    guard.unlock();
 
-    // create inode, mark it in inode map and init it
-    int newInodeIdx = getFreeInodeIdx();
-    inodesBitmap[newInodeIdx] = FULL;
-    inodes[newInodeIdx].isDirectory = true;
-    inodes[newInodeIdx].references = 0;
-    inodes[newInodeIdx].size = 0;
+    // create inode and mark it in inode map, parent is checked again with it locked (another session could change it)
+    int newInodeIdx = allocateInodeIdx();
+    guard.lock({parentInodeIdx, newInodeIdx});
+    if(!canAddItem(session, parentInodeIdx, targetName)) {
+        inodesBitmap.setEmpty(newInodeIdx);
+        free(targetName);
+        return;
+    }
+    initInode(newInodeIdx, true, 0);
 
-    // add it to parent
-    addDirectoryItem(parentInodeIdx, newInodeIdx, targetName);
-    free(targetName);
+    try {
+        // add parent .. and current dir . first, dir is complete when it is added to parent
+        addTraversalReference(newInodeIdx, parentInodeIdx);
+        addDirectoryItem(parentInodeIdx, newInodeIdx, targetName);
+    }
+    catch(...) {
+        freeItem(newInodeIdx);
+        free(targetName);
+        throw;
+    }
 
-    // add parent .. and current dir .
-    addTraversalReference(newInodeIdx, parentInodeIdx);
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    free(targetName);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::rmdir(string target) {
+void VFSManager::rmdir(Session &session, string target) {
     int parentInodeIdx;
     char *targetName;
     // parse path
-    parseParentPath(target, &parentInodeIdx, &targetName);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
     // inode not exist or user wants to delete hidden dirs - path not found
     if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE || strcmp(targetName, ".") == 0 || strcmp(targetName, "..") == 0) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
-    // get inode idx of target dir
-    int deleteDirInodeIdx = getItemInodeIdxByName(parentInodeIdx, targetName);
+    // lock parent with target dir and get inode idx of it
+    InodeGuard guard(&inodeLocks);
+    int deleteDirInodeIdx;
+    lockItem(&guard, parentInodeIdx, targetName, &deleteDirInodeIdx);
     // check if it was found and if it is dir
     if(deleteDirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodes[deleteDirInodeIdx].isDirectory) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        free(targetName);
         return;
     }
     // check if dir is empty
-    if((inodes[deleteDirInodeIdx].size / sizeof(directoryItem)) > 2) {
-        cout << Constants::NOT_EMPTY << endl;
+    if(getAllDirectoryItems(deleteDirInodeIdx).size() > 2) {
+        session.getOutput() << Constants::NOT_EMPTY << endl;
+        free(targetName);
         return;
     }
 
-    // delete folder from parent folder
+    // delete folder from parent folder, then free all clusters of dir with clusters with references to them
     deleteItemFromParentCluster(parentInodeIdx, targetName);
+    freeItem(deleteDirInodeIdx);
 
-    // remove from bitmaps
-    dataBitmap[inodes[deleteDirInodeIdx].directs[0]] = EMPTY;
-    inodesBitmap[deleteDirInodeIdx] = EMPTY;
-
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    free(targetName);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::ls(string target) {
+void VFSManager::ls(Session &session, string target) {
     int lsDirInodeIdx;
-    if(target.empty()) {
-        // no path defined
-        lsDirInodeIdx = currentInode;
-    }
-    else {
-        // parse path
-        parsePath(target, &lsDirInodeIdx);
+    // parse path (no path defined - current dir)
+    parsePath(session, target, &lsDirInodeIdx);
 
-        // inode not exist - path not found
-        if(lsDirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodes[lsDirInodeIdx].isDirectory) {
-            cout << Constants::PATH_NOT_FOUND << endl;
-            return;
-        }
+    // inode not exist or it was removed by another session - path not found
+    InodeGuard guard(&inodeLocks);
+    if(lsDirInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+        guard.lockShared(lsDirInodeIdx);
+    }
+    if(lsDirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodesBitmap.isFull(lsDirInodeIdx) || !inodes[lsDirInodeIdx].isDirectory) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        return;
     }
 
     // get items of wanted dir
-    int itemsCount = inodes[lsDirInodeIdx].size / sizeof(directoryItem);
-    directoryItem *items = (directoryItem *) malloc(itemsCount * sizeof(directoryItem));
-    getAllDirectoryItems(items, lsDirInodeIdx, itemsCount);
+    vector<directoryItem> items = getAllDirectoryItems(lsDirInodeIdx);
 
     // iterate items and print them
-    for(int i = 0; i < itemsCount; i++) {
+    for(int i = 0; i < items.size(); i++) {
         if(inodes[items[i].inode].isDirectory) {
             // for directories
-            cout << "+" << items[i].name << endl;
+            session.getOutput() << "+" << items[i].name << endl;
         }
         else {
             // for files
-            cout << "-" << items[i].name << endl;
+            session.getOutput() << "-" << items[i].name << endl;
         }
     }
-    free(items);
 }
 
-void VFSManager::cat(string target) {
+void VFSManager::cat(Session &session, string target) {
     int targetInodeIdx;
     // parse path
-    parsePath(target, &targetInodeIdx);
+    parsePath(session, target, &targetInodeIdx);
 
     // inode not exist - file not found
     if(targetInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
-    // check if source is file
-    if(inodes[targetInodeIdx].isDirectory) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+    // check if source is file (it could be removed by another session)
+    InodeGuard guard(&inodeLocks);
+    guard.lockShared(targetInodeIdx);
+    if(!inodesBitmap.isFull(targetInodeIdx) || inodes[targetInodeIdx].isDirectory) {
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
-    // get info of file
-    int bytesSize = inodes[targetInodeIdx].size;
-    vector<int> fileDataClusters = getDataClustersIdxs(targetInodeIdx, ceil(bytesSize / (double) sb.clusterSize));
-
-    // load file data and write it to console
-    char *buffer = (char *) malloc((sb.clusterSize + 1) * sizeof(char));
-    memset(buffer, '\0', sb.clusterSize + 1);
-    for(int i = 0; i < fileDataClusters.size(); i++) {
-        int bytesToWrite;
-        if(bytesSize >= sb.clusterSize) {
-            bytesToWrite = sb.clusterSize;
-        }
-        else {
-            bytesToWrite = bytesSize;
-        }
-
-        readDataChunk(fileDataClusters[i], buffer, bytesToWrite);
-        cout << buffer << flush;
-
-        memset(buffer, '\0', sb.clusterSize + 1);
-        bytesSize -= bytesToWrite;
-    }
-
-    // free sources
-    free(buffer);
-    saveMetadata();
+    // data are written as they are read, without flushing them chunk by chunk
+    streamFileData(targetInodeIdx, [&session](const iovec *parts, int partsCount) {
+        session.writeOutput(parts, partsCount);
+    }, [&session](int imageFd, long long address, long long bytesCount) {
+        return session.sendImageData(imageFd, address, bytesCount);
+    });
 }
 
-void VFSManager::cd(string target) {
-    // update current inode
-    int cdDirInodeIdx;
+void VFSManager::cd(Session &session, string target) {
     if(target.empty()) {
         // no path defined - jump to root
-        currentInode = Constants::ROOT_INODE_IDX;
+        session.changeToRoot();
+        session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+        return;
     }
-    else {
-        // parse path
-        parsePath(target, &cdDirInodeIdx);
 
-        // inode not exist of it is not dir- path not found
-        if(cdDirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodes[cdDirInodeIdx].isDirectory) {
-            cout << Constants::PATH_NOT_FOUND << endl;
-            return;
-        }
-        currentInode = cdDirInodeIdx;
-    }
+    // parse path
+    int cdDirInodeIdx;
+    parsePath(session, target, &cdDirInodeIdx);
 
-    // update current working directory
-    if(target[0] == '/') {
-        // path is absolute
-        memset(path, 0, 1000);
-        strcpy(path, target.c_str());
+    // inode not exist of it is not dir- path not found
+    InodeGuard guard(&inodeLocks);
+    if(cdDirInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+        guard.lockShared(cdDirInodeIdx);
     }
-    else {
-        // path is relative
-        string stringPath(path);
-        vector<string> pathParts;
-        if(stringPath != "/") {
-            stringPath = stringPath.substr(1, stringPath.size() - 1);
-            pathParts = StringUtils::split(stringPath, Constants::PATH_DELIM);
-        }
-
-        // iterate through user written relative path
-        vector<string> userPath =  StringUtils::split(target, Constants::PATH_DELIM);
-        for(int i = 0; i < userPath.size(); i++) {
-            string current = userPath[i];
-            if(current == ".") {
-                // current dir
-                continue;
-            }
-            if(current == "..") {
-                // parent dir
-                if(!pathParts.empty()) {
-                    pathParts.erase(pathParts.begin() + pathParts.size() - 1);
-                }
-                continue;
-            }
-            pathParts.push_back(current);
-        }
-
-        memset(path, 0, 1000);
-        if(pathParts.empty()) {
-            // if parts are empty - path is root
-            strcpy(path, "/");
-        }
-        else {
-            // join parts to full path
-            stringPath = "/" + pathParts[0];
-            for(int i = 1; i < pathParts.size(); i++) {
-                stringPath += "/" + pathParts[i];
-            }
-            strcpy(path, stringPath.c_str());
-        }
+    if(cdDirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodesBitmap.isFull(cdDirInodeIdx) || !inodes[cdDirInodeIdx].isDirectory) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        return;
     }
-    cout << Constants::COMMAND_SUCCESS << endl;
+
+    // update current dir and working directory of session only
+    session.changeDirectory(cdDirInodeIdx, target);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::info(string target) {
+void VFSManager::info(Session &session, string target) {
     int targetInodeIdx;
     // parse path
-    parsePath(target, &targetInodeIdx);
+    parsePath(session, target, &targetInodeIdx);
 
-    // inode not exist - file not found
-    if(targetInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+    // inode not exist or it was removed by another session - file not found
+    InodeGuard guard(&inodeLocks);
+    if(targetInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+        guard.lockShared(targetInodeIdx);
+    }
+    if(targetInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodesBitmap.isFull(targetInodeIdx)) {
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
@@ -670,183 +1044,691 @@ void VFSManager::info(string target) {
     // print info
     if(targetInode.isDirectory) {
         // for dirs
-        cout << dirName << " - " << targetInode.size << " - i-node " << targetInodeIdx << " - " << targetInode.directs[0] << endl;
+        session.getOutput() << dirName << " - " << targetInode.size << " - i-node " << targetInodeIdx << " - " << getDataClusterIdxByChunkIdx(targetInodeIdx, 0) << endl;
     }
     else {
         // for files
-        cout << dirName << " - " << targetInode.size << " - i-node " << targetInodeIdx << " - " << flush;
+        session.getOutput() << dirName << " - " << targetInode.size << " - i-node " << targetInodeIdx << " - " << flush;
+        if(isInline(targetInodeIdx)) {
+            // there are no clusters
+            session.getOutput() << Constants::INLINE_INFO << endl;
+            return;
+        }
         vector<int> clusters = getDataClustersIdxs(targetInodeIdx, ceil(targetInode.size / (double) sb.clusterSize));
         for(int i = 0; i < clusters.size(); i++) {
-            cout << clusters[i] << " " << flush;
+            if(isCompressed(targetInodeIdx)) {
+                // cluster and first fragment of compressed chunk
+                session.getOutput() << clusters[i] / Constants::FRAGMENTS_PER_CLUSTER << ":" << clusters[i] % Constants::FRAGMENTS_PER_CLUSTER << " " << flush;
+                continue;
+            }
+            session.getOutput() << clusters[i] << " " << flush;
         }
-        cout << endl;
+        session.getOutput() << endl;
     }
 }
 
-void VFSManager::incp(string source, string target) {
+void VFSManager::incp(Session &session, string source, string target) {
     int parentInodeIdx;
     char *targetName;
     // parse path
-    parseParentPath(target, &parentInodeIdx, &targetName);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
     // inode not exist - path not found
     if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
-    // check if name is unique
-    if(!itemNameUnique(parentInodeIdx, targetName)) {
-        cout << Constants::EXIST << endl;
+    // check if file can be created in parent
+    InodeGuard guard(&inodeLocks);
+    guard.lockShared(parentInodeIdx);
+    if(!canAddItem(session, parentInodeIdx, targetName)) {
+        free(targetName);
         return;
     }
+    guard.unlock();
 
-    // transform name to char pointer
-    char *sourcePath = (char *) malloc((source.length() + 1) * sizeof(char));
-    strcpy(sourcePath, source.c_str());
-    // open target file
-    FILE *sourceFile = fopen(sourcePath, "rb");
+    // open source file
+    FILE *sourceFile = session.openHostFile(source, "rb");
     // check if file exists
     if(sourceFile == NULL) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+        session.getOutput() << (session.usesHostPaths() ? Constants::FILE_NOT_FOUND : Constants::HOST_FILE_NOT_ATTACHED_MSG) << endl;
+        free(targetName);
         return;
     }
 
-    // create inode, mark it in inode map and init it
-    int newInodeIdx = getFreeInodeIdx();
-    inodesBitmap[newInodeIdx] = FULL;
-    inodes[newInodeIdx].isDirectory = false;
-    inodes[newInodeIdx].references = 1;
-    inodes[newInodeIdx].size = 0;
+    // create inode, mark it in inode map and init it - it is locked alone while data are written, parent is not blocked
+    int newInodeIdx = allocateInodeIdx();
+    guard.lock({newInodeIdx});
+    initInode(newInodeIdx, false, 1);
+
+    // get size of file
+    fseeko(sourceFile, 0, SEEK_END);
+    long long sourceSize = ftello(sourceFile);
+    fseeko(sourceFile, 0, SEEK_SET);
+
+    // size of pipe or socket is not known, its data are always written to clusters
+    if((sb.features & Constants::FEATURE_INLINE_DATA) && sourceSize >= 0 && sourceSize <= Constants::INLINE_DATA_SIZE) {
+        // small file is stored in inode
+        inodes[newInodeIdx].size = fread(inodes[newInodeIdx].inlineData, sizeof(char), sourceSize, sourceFile);
+        inodes[newInodeIdx].flags |= Constants::INODE_FLAG_INLINE;
+        markInodeDirty(newInodeIdx);
+    }
+    else {
+        // load file data and write it to vfs - more clusters at once, next batch is read while previous ones are written,
+        // io engine keeps requests of one command, so files of more commands are written in turn
+        lock_guard<mutex> engineGuard(engineLock);
+        int batchClusters = getBatchClusters();
+        int batchSize = sb.clusterSize * batchClusters;
+        int buffersCount = ioEngine->getQueueDepth();
+        char *buffers = (char *) malloc(batchSize * buffersCount * sizeof(char));
+        vector<int> pendingRequests(buffersCount, 0);
+        vector<int> freeBuffers;
+        for(int i = 0; i < buffersCount; i++) {
+            freeBuffers.push_back(i);
+        }
+        try {
+            while(true) {
+                int bufferIdx = waitForFreeBuffer(&pendingRequests, &freeBuffers);
+                char *buffer = buffers + bufferIdx * batchSize;
+                int bytesRead = fread(buffer, sizeof(char), batchSize, sourceFile);
+                if(bytesRead <= 0) {
+                    break;
+                }
+                pendingRequests[bufferIdx] = addDataChunks(newInodeIdx, buffer, bytesRead, bufferIdx);
+                if(pendingRequests[bufferIdx] == 0) {
+                    // all chunks were already stored
+                    freeBuffers.push_back(bufferIdx);
+                }
+            }
+        }
+        catch(...) {
+            // file is not created, its buffers are freed after their writes
+            ioEngine->drain();
+            unwrittenChunks.clear();
+            free(buffers);
+            session.closeHostFile(sourceFile);
+            freeItem(newInodeIdx);
+            free(targetName);
+            throw;
+        }
+        ioEngine->drain();
+        unwrittenChunks.clear();
 
-    // load file data and write it to vfs
-    char *buffer = (char *) malloc(sb.clusterSize * sizeof(char));
-    memset(buffer, 0, sb.clusterSize);
-    int bytesRead;
-    while((bytesRead = fread(buffer, sizeof(char), sb.clusterSize, sourceFile)) > 0) {
-        addDataChunk(newInodeIdx, buffer, bytesRead);
-        memset(buffer, 0, sb.clusterSize);
+        free(buffers);
     }
 
     // free sources
-    free(buffer);
-    fclose(sourceFile);
+    session.closeHostFile(sourceFile);
 
-    // add it to parent
-    addDirectoryItem(parentInodeIdx, newInodeIdx, targetName);
+    // add it to parent - parent is checked again, another session could change it while data were written
+    guard.lock({parentInodeIdx, newInodeIdx});
+    if(!canAddItem(session, parentInodeIdx, targetName)) {
+        freeItem(newInodeIdx);
+        free(targetName);
+        return;
+    }
+    try {
+        addDirectoryItem(parentInodeIdx, newInodeIdx, targetName);
+    }
+    catch(...) {
+        freeItem(newInodeIdx);
+        free(targetName);
+        throw;
+    }
     free(targetName);
 
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::outcp(string source, string target) {
-    int sourceInodeIdx;
+void VFSManager::incpTree(Session &session, string source, string target) {
+    // trees of host are accessed by paths, which server does not open for clients
+    if(!session.usesHostPaths()) {
+        session.getOutput() << Constants::HOST_FILE_NOT_ATTACHED_MSG << endl;
+        return;
+    }
+
+    int parentInodeIdx;
+    char *targetName;
     // parse path
-    parsePath(source, &sourceInodeIdx);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
     // inode not exist - path not found
-    if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+    if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
-    // check if source is file
-    if(inodes[sourceInodeIdx].isDirectory) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+    // check if name is unique
+    if(!itemNameUnique(parentInodeIdx, targetName)) {
+        session.getOutput() << Constants::EXIST << endl;
+        free(targetName);
+        return;
+    }
+
+    // source must be directory of host
+    struct stat sourceStat;
+    if(stat(source.c_str(), &sourceStat) != 0 || !S_ISDIR(sourceStat.st_mode)) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        free(targetName);
+        return;
+    }
+
+    // list whole tree of host first, directories precede their items
+    vector<treeItem> items;
+    treeItem root = {source, targetName, -1, true, Constants::INODE_NOT_EXISTS_CODE};
+    items.push_back(root);
+    free(targetName);
+    listHostTree(session, 0, &items);
+
+    // files are read ahead by workers in order of tree, buffers for the rest of big files are kept
+    vector<string> filePaths;
+    for(int i = 0; i < items.size(); i++) {
+        if(!items[i].isDirectory) {
+            filePaths.push_back(items[i].hostPath);
+        }
+    }
+    int buffersCount = Constants::TREE_PREFETCH_FILES + ioEngine->getQueueDepth();
+    HostFileReader reader(filePaths, buffersCount, sb.clusterSize * getBatchClusters(), ioEngine->getQueueDepth(), Constants::TREE_WORKERS_COUNT);
+    vector<int> pendingRequests(buffersCount, 0);
+    int requestsInFlight = 0;
+
+    int fileIdx = 0;
+    for(int i = 0; i < items.size(); i++) {
+        treeItem &item = items[i];
+        int dirInodeIdx = item.parentIdx == -1 ? parentInodeIdx : items[item.parentIdx].inodeIdx;
+        prefetchedFile prefetched;
+        if(!item.isDirectory) {
+            // writes of previous files free buffers for workers while this one is read
+            while(!reader.isRead(fileIdx) && requestsInFlight > 0) {
+                finishTreeWrite(&reader, &pendingRequests, &requestsInFlight);
+            }
+            prefetched = reader.take(fileIdx++);
+        }
+
+        // item is skipped if it cannot be read, its parent was skipped or it does not fit to parent
+        if(dirInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !directoryHasSpace(dirInodeIdx) || (!item.isDirectory && prefetched.file == nullptr)) {
+            session.getOutput() << Constants::ITEM_SKIPPED_MSG << Constants::COMMAND_DELIM << item.hostPath << endl;
+            if(!item.isDirectory) {
+                if(prefetched.file != nullptr) {
+                    fclose(prefetched.file);
+                }
+                reader.releaseBuffer(prefetched.bufferIdx);
+            }
+            continue;
+        }
+
+        // create inode, mark it in inode map and init it
+        item.inodeIdx = allocateInodeIdx();
+        initInode(item.inodeIdx, item.isDirectory, item.isDirectory ? 0 : 1);
+        if(!item.isDirectory) {
+            importTreeFile(item.inodeIdx, prefetched, &reader, &pendingRequests, &requestsInFlight);
+        }
+
+        // add it to parent
+        addDirectoryItem(dirInodeIdx, item.inodeIdx, &item.name[0]);
+        if(item.isDirectory) {
+            addTraversalReference(item.inodeIdx, dirInodeIdx);
+        }
+
+        // metadata of items are committed in groups (as commands of script), data of files of group are written first
+        stageMetadata();
+        if(journal.getSize() > 0 && groupCommitDue()) {
+            while(requestsInFlight > 0) {
+                finishTreeWrite(&reader, &pendingRequests, &requestsInFlight);
+            }
+            unwrittenChunks.clear();
+            commitMetadata();
+        }
+    }
+
+    // wait for all writes, metadata of the last group are saved after command
+    while(requestsInFlight > 0) {
+        finishTreeWrite(&reader, &pendingRequests, &requestsInFlight);
+    }
+    unwrittenChunks.clear();
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+}
+
+void VFSManager::outcp(Session &session, string source, string target) {
+    int sourceInodeIdx;
+    // parse path
+    parsePath(session, source, &sourceInodeIdx);
+
+    // inode not exist - path not found
+    if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
+        return;
+    }
+
+    // check if source is file (it could be removed by another session)
+    InodeGuard guard(&inodeLocks);
+    guard.lockShared(sourceInodeIdx);
+    if(!inodesBitmap.isFull(sourceInodeIdx) || inodes[sourceInodeIdx].isDirectory) {
+        session.getOutput() << Constants::FILE_NOT_FOUND << endl;
         return;
     }
 
-    // transform name to char pointer
-    char *targetPath = (char *) malloc((target.length() + 1) * sizeof(char));
-    strcpy(targetPath, target.c_str());
     // open target file
-    FILE *targetFile = fopen(targetPath, "wb");
+    FILE *targetFile = session.openHostFile(target, "wb");
     // check if file exists
     if(targetFile == NULL) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+        session.getOutput() << (session.usesHostPaths() ? Constants::PATH_NOT_FOUND : Constants::HOST_FILE_NOT_ATTACHED_MSG) << endl;
         return;
     }
 
-    // get info of file
-    int bytesSize = inodes[sourceInodeIdx].size;
-    vector<int> fileDataClusters = getDataClustersIdxs(sourceInodeIdx, ceil(bytesSize / (double) sb.clusterSize));
+    exportFileData(sourceInodeIdx, targetFile);
+    session.closeHostFile(targetFile);
+
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+}
+
+void VFSManager::outcpTree(Session &session, string source, string target) {
+    // trees of host are accessed by paths, which server does not open for clients
+    if(!session.usesHostPaths()) {
+        session.getOutput() << Constants::HOST_FILE_NOT_ATTACHED_MSG << endl;
+        return;
+    }
+
+    int sourceInodeIdx;
+    // parse path
+    parsePath(session, source, &sourceInodeIdx);
+
+    // inode not exist or it is not dir - path not found
+    InodeGuard guard(&inodeLocks);
+    if(sourceInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+        guard.lockShared(sourceInodeIdx);
+    }
+    if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE || !inodesBitmap.isFull(sourceInodeIdx) || !inodes[sourceInodeIdx].isDirectory) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        return;
+    }
+    guard.unlock();
+
+    // list whole tree of vfs, directories precede their items
+    vector<treeItem> items;
+    treeItem root = {target, "", -1, true, sourceInodeIdx};
+    items.push_back(root);
+    listVfsTree(0, &items);
+
+    // target dir of host cannot be created - path not found
+    if(::mkdir(target.c_str(), 0755) != 0 && errno != EEXIST) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        return;
+    }
 
-    // load file data and write it to fs
-    char *buffer = (char *) malloc(sb.clusterSize * sizeof(char));
-    memset(buffer, 0, sb.clusterSize);
-    for(int i = 0; i < fileDataClusters.size(); i++) {
-        int bytesToWrite;
-        if(bytesSize >= sb.clusterSize) {
-            bytesToWrite = sb.clusterSize;
+    // directories are created first, so workers can write files in any order
+    vector<int> fileItems;
+    for(int i = 1; i < items.size(); i++) {
+        if(!items[i].isDirectory) {
+            fileItems.push_back(i);
         }
-        else {
-            bytesToWrite = bytesSize;
+        else if(::mkdir(items[i].hostPath.c_str(), 0755) != 0 && errno != EEXIST) {
+            session.getOutput() << Constants::ITEM_SKIPPED_MSG << Constants::COMMAND_DELIM << items[i].hostPath << endl;
+        }
+    }
+
+    // workers take files one by one, image is only read, so they do not need lock
+    vector<char> written(fileItems.size(), false);
+    int nextFile = 0;
+    mutex filesLock;
+    vector<thread> workers;
+    for(int i = 0; i < Constants::TREE_WORKERS_COUNT && i < fileItems.size(); i++) {
+        workers.emplace_back([this, &items, &fileItems, &written, &nextFile, &filesLock] {
+            while(true) {
+                int fileIdx;
+                {
+                    lock_guard<mutex> guard(filesLock);
+                    if(nextFile == fileItems.size()) {
+                        return;
+                    }
+                    fileIdx = nextFile++;
+                }
+
+                // file could be removed by another session since tree was listed
+                treeItem &item = items[fileItems[fileIdx]];
+                InodeGuard guard(&inodeLocks);
+                guard.lockShared(item.inodeIdx);
+                if(!inodesBitmap.isFull(item.inodeIdx) || inodes[item.inodeIdx].isDirectory) {
+                    continue;
+                }
+                FILE *targetFile = fopen(item.hostPath.c_str(), "wb");
+                if(targetFile != nullptr) {
+                    exportFileData(item.inodeIdx, targetFile);
+                    written[fileIdx] = fclose(targetFile) == 0;
+                }
+            }
+        });
+    }
+    for(int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    // files which could not be written
+    for(int i = 0; i < fileItems.size(); i++) {
+        if(!written[i]) {
+            session.getOutput() << Constants::ITEM_SKIPPED_MSG << Constants::COMMAND_DELIM << items[fileItems[i]].hostPath << endl;
+        }
+    }
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+}
+
+void VFSManager::exportFileData(int inodeIdx, FILE *targetFile) {
+    streamFileData(inodeIdx, [targetFile](const iovec *parts, int partsCount) {
+        for(int i = 0; i < partsCount; i++) {
+            fwrite(parts[i].iov_base, sizeof(char), parts[i].iov_len, targetFile);
+        }
+    }, [](int, long long, long long) {
+        return 0LL;
+    });
+}
+
+void VFSManager::streamFileData(int inodeIdx, const function<void(const iovec *, int)> &writeParts,
+        const function<long long(int, long long, long long)> &sendImageData) {
+    // get info of file
+    long long bytesSize = inodes[inodeIdx].size;
+    vector<int> fileDataClusters = getDataClustersIdxs(inodeIdx, ceil(bytesSize / (double) sb.clusterSize));
+    int batchClusters = getBatchClusters();
+    int batchSize = sb.clusterSize * batchClusters;
+
+    if(isInline(inodeIdx)) {
+        // data are stored in inode
+        iovec part = {inodes[inodeIdx].inlineData, (size_t) bytesSize};
+        writeParts(&part, 1);
+        return;
+    }
+
+    if(isCompressed(inodeIdx)) {
+        // chunks of batch are decompressed one after another to one buffer
+        char *buffer = (char *) malloc(batchSize * sizeof(char));
+        for(int i = 0; i < fileDataClusters.size(); ) {
+            iovec part = {buffer, 0};
+            for(int j = 0; j < batchClusters && i < fileDataClusters.size(); i++, j++) {
+                int bytesToWrite = min(bytesSize, (long long) sb.clusterSize);
+                readCompressedChunk(fileDataClusters[i], buffer + part.iov_len, bytesToWrite);
+                part.iov_len += bytesToWrite;
+                bytesSize -= bytesToWrite;
+            }
+            writeParts(&part, 1);
         }
+        free(buffer);
+        return;
+    }
+
+    if(device->getMemory() != nullptr) {
+        // data are written directly from image in memory, chunks of batch at once (contiguous chunks are one part)
+        vector<iovec> parts;
+        for(int i = 0; i < fileDataClusters.size(); i++) {
+            int bytesToWrite = min(bytesSize, (long long) sb.clusterSize);
+            const char *chunk = viewDataChunk(getChunkAddress(inodeIdx, i, fileDataClusters[i]), nullptr, bytesToWrite);
+            if(!parts.empty() && (const char *) parts.back().iov_base + parts.back().iov_len == chunk) {
+                parts.back().iov_len += bytesToWrite;
+            }
+            else {
+                iovec part = {(void *) chunk, (size_t) bytesToWrite};
+                parts.push_back(part);
+            }
+            bytesSize -= bytesToWrite;
 
-        readDataChunk(fileDataClusters[i], buffer, bytesToWrite);
-        fwrite(buffer, sizeof(char), bytesToWrite, targetFile);
+            if(parts.size() == batchClusters || i == fileDataClusters.size() - 1) {
+                writeParts(parts.data(), parts.size());
+                parts.clear();
+            }
+        }
+        return;
+    }
 
-        memset(buffer, 0, sb.clusterSize);
+    // runs of contiguous clusters go from image file straight to output if output allows it
+    int i = 0;
+    // bytes of cluster i which were already sent
+    int sentOffset = 0;
+    int imageFd = device->getAsyncFd();
+    while(imageFd != -1 && i < fileDataClusters.size()) {
+        int runLength = getClustersRunLength(fileDataClusters, i, fileDataClusters.size() - i);
+        if(hasPackedTail(inodeIdx) && i + runLength == fileDataClusters.size() && runLength > 1) {
+            // packed tail is sent separately
+            runLength--;
+        }
+        long long bytesToWrite = min(bytesSize, (long long) runLength * sb.clusterSize);
+        long long sent = sendImageData(imageFd, sb.dataClustersAddress + getChunkAddress(inodeIdx, i, fileDataClusters[i]), bytesToWrite);
+        if(sent < bytesToWrite) {
+            // the rest is read and written from the first cluster which was not sent whole
+            bytesSize -= sent / sb.clusterSize * sb.clusterSize;
+            i += sent / sb.clusterSize;
+            sentOffset = sent % sb.clusterSize;
+            break;
+        }
         bytesSize -= bytesToWrite;
+        i += runLength;
+    }
+    if(i == fileDataClusters.size()) {
+        return;
+    }
+
+    // load file data and write it - more clusters at once, next batches are read while previous one is written
+    // engine is used by one reader at once, the others read synchronously
+    unique_lock<mutex> engineGuard(engineLock, try_to_lock);
+    IOEngine syncEngine(device, ioEngine->getQueueDepth());
+    IOEngine *engine = engineGuard.owns_lock() ? ioEngine : &syncEngine;
+    int buffersCount = engine->getQueueDepth();
+    char *buffers = (char *) malloc(batchSize * buffersCount * sizeof(char));
+    vector<int> pendingRequests(buffersCount, 0);
+    vector<int> batchBytes(buffersCount, 0);
+    vector<int> freeBuffers;
+    for(int j = 0; j < buffersCount; j++) {
+        freeBuffers.push_back(j);
+    }
+    deque<int> batchesOrder;
+    while(i < fileDataClusters.size() || !batchesOrder.empty()) {
+        // loaded batches are written in order
+        while(!batchesOrder.empty() && pendingRequests[batchesOrder.front()] == 0) {
+            int bufferIdx = batchesOrder.front();
+            iovec part = {buffers + bufferIdx * batchSize, (size_t) batchBytes[bufferIdx]};
+            writeParts(&part, 1);
+            batchesOrder.pop_front();
+            freeBuffers.push_back(bufferIdx);
+        }
+
+        if(i == fileDataClusters.size() || freeBuffers.empty()) {
+            // wait for any load
+            if(!batchesOrder.empty()) {
+                pendingRequests[engine->waitCompletion()]--;
+            }
+            continue;
+        }
+
+        // start loading of next batch, contiguous clusters are loaded at once
+        int bufferIdx = freeBuffers.back();
+        freeBuffers.pop_back();
+        batchBytes[bufferIdx] = 0;
+        for(int j = 0; j < batchClusters && i < fileDataClusters.size(); ) {
+            int runLength = getClustersRunLength(fileDataClusters, i, batchClusters - j);
+            if(hasPackedTail(inodeIdx) && i + runLength == fileDataClusters.size() && runLength > 1) {
+                // packed tail is loaded separately
+                runLength--;
+            }
+            int runBytes = min(bytesSize, (long long) runLength * sb.clusterSize);
+            int bytesRead = runBytes - sentOffset;
+            engine->submitRead(sb.dataClustersAddress + getChunkAddress(inodeIdx, i, fileDataClusters[i]) + sentOffset,
+                    buffers + bufferIdx * batchSize + batchBytes[bufferIdx], bytesRead, bufferIdx);
+            pendingRequests[bufferIdx]++;
+            batchBytes[bufferIdx] += bytesRead;
+            bytesSize -= runBytes;
+            sentOffset = 0;
+            i += runLength;
+            j += runLength;
+        }
+        batchesOrder.push_back(bufferIdx);
     }
 
     // free sources
-    free(buffer);
-    free(targetPath);
-    fclose(targetFile);
+    free(buffers);
+}
 
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+void VFSManager::stats(Session &session) {
+    // session - commands handled before this one
+    session.getOutput() << "session - commands " << session.getCommandsCount() << " - time " << session.getCommandsTime() / 1000000.0 << " ms" << endl;
+
+    // dentry cache
+    session.getOutput() << "dentry cache - hits " << dentryCache.getHits() << " - misses " << dentryCache.getMisses()
+        << " - entries " << dentryCache.getSize() << "/" << dentryCache.getCapacity() << endl;
+
+    // buffer cache - block reads served from cache against all block reads
+    long long blockReads = bufferCache.getHits() + bufferCache.getMisses();
+    double hitRatio = blockReads == 0 ? 0 : bufferCache.getHits() / (double) blockReads;
+    session.getOutput() << "buffer cache - policy " << bufferCache.getPolicyName() << " - hits " << bufferCache.getHits() << " - misses " << bufferCache.getMisses()
+        << " - hit ratio " << hitRatio << " - evictions " << bufferCache.getEvictions() << " - writebacks " << bufferCache.getWritebacks()
+        << " - blocks " << bufferCache.getSize() << "/" << bufferCache.getCapacity() << endl;
+
+    // space usage - bytes of files against bytes of used clusters (metadata clusters included)
+    long long filesBytes = 0;
+    for(int i = 0; i < sb.inodesCount; i++) {
+        if(inodesBitmap.isFull(i) && !inodes[i].isDirectory) {
+            filesBytes += inodes[i].size;
+        }
+    }
+    int usedClusters = dataBitmap.countFull();
+    double efficiency = usedClusters == 0 ? 1 : filesBytes / ((double) usedClusters * sb.clusterSize);
+    session.getOutput() << "space - cluster " << sb.clusterSize << " B - clusters " << usedClusters << "/" << sb.clusterCount
+        << " - inodes " << inodesBitmap.countFull() << "/" << sb.inodesCount << " - file bytes " << filesBytes
+        << " - efficiency " << efficiency << endl;
+
+    if(sb.features & Constants::FEATURE_JOURNAL) {
+        // transactions since start
+        session.getOutput() << "journal - size " << sb.journalSize << " B - commits " << journal.getCommitsCount() << " - journaled bytes "
+            << journal.getJournaledBytes() << " - barriers " << journal.getBarriersCount() << endl;
+    }
+
+    if(sb.features & Constants::FEATURE_REFLINK) {
+        // clusters referenced by more files
+        session.getOutput() << "reflinks - shared clusters " << clusterRefs.getSharedCount() << endl;
+    }
+
+    if(sb.features & Constants::FEATURE_COMPRESSION) {
+        // chunks compressed since start - ratio of their bytes to stored bytes
+        double ratio = compressedBytesOut == 0 ? 1 : compressedBytesIn / (double) compressedBytesOut;
+        session.getOutput() << "compression - bytes " << compressedBytesIn << " - stored " << compressedBytesOut << " - ratio " << ratio
+            << " - raw chunks " << rawChunksCount << " - compressing " << compressionTime / 1000000.0 << " ms" << endl;
+    }
+
+    if(sb.features & Constants::FEATURE_DEDUP) {
+        // chunks hashed since start - ratio of all chunks to chunks which needed new cluster
+        long long hashed = chunkIndex.getHashedCount();
+        long long duplicates = chunkIndex.getDuplicatesCount();
+        string ratio = hashed == 0 ? "1" : hashed == duplicates ? "inf" : to_string(hashed / (double) (hashed - duplicates));
+        double hashingMs = chunkIndex.getHashingTime() / 1000000.0;
+        double hashingSpeed = hashingMs == 0 ? 0 : hashed * (double) sb.clusterSize / 1048576 / (hashingMs / 1000);
+        session.getOutput() << "dedup - chunks " << hashed << " - duplicates " << duplicates << " - ratio " << ratio << " - hashing " << hashingMs
+            << " ms (" << hashingSpeed << " MB/s) - indexed clusters " << chunkIndex.getSize() << endl;
+    }
 }
 
-void VFSManager::load(string target) {
-    string command;
-    ifstream commandFile(target.c_str(), ios::in);
+void VFSManager::cache(Session &session, string size, string policyName) {
+    long long bytesSize = getBytesSize(size);
+    if(bytesSize < 0) {
+        session.getOutput() << Constants::INVALID_SIZE_MSG << endl;
+        return;
+    }
+
+    // changed blocks are written before cache is resized
+    if(!bufferCache.configure(bytesSize, policyName)) {
+        session.getOutput() << Constants::UNKNOWN_OPTION_MSG << endl;
+        return;
+    }
+
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
+}
+
+void VFSManager::load(Session &session, string target) {
+    FILE *file = session.openHostFile(target, "r");
 
     // check if it was successfully opened
-    if(!commandFile) {
-        cout << Constants::FILE_NOT_FOUND << endl;
+    if(file == NULL) {
+        session.getOutput() << (session.usesHostPaths() ? Constants::FILE_NOT_FOUND : Constants::HOST_FILE_NOT_ATTACHED_MSG) << endl;
         return;
     }
 
-    // process all lines
+    // whole script is read first, file of client is not kept while commands run
+    string script;
+    char buffer[BUFSIZ];
+    size_t bytesRead;
+    while((bytesRead = fread(buffer, sizeof(char), BUFSIZ, file)) > 0) {
+        script.append(buffer, bytesRead);
+    }
+    session.closeHostFile(file);
+    istringstream commandFile(script);
+    string command;
+
+    // process all lines - changes of all commands are committed together
+    bool outerGroupCommit = groupCommit;
+    groupCommit = true;
     while (getline(commandFile, command))
     {
-        pwd();
-        cout << Constants::PATH_END << Constants::COMMAND_DELIM << command << endl;
-        handleCommand(command);
+        pwd(session);
+        session.getOutput() << Constants::PATH_END << Constants::COMMAND_DELIM << command << endl;
+        // failed command drops only its own changes, script goes on with the next line
+        for(bool retried = false; ; retried = true) {
+            setSavepoint();
+            try {
+                executeCommand(session, StringUtils::split(command, Constants::COMMAND_DELIM));
+                break;
+            }
+            catch(const exception &e) {
+                abortChanges();
+                // clusters freed by previous commands of script are free after commit, so command which did not find space runs again
+                if(!retried && (!pendingFreeClusters.empty() || !pendingFreeFragments.empty())) {
+                    commitMetadata();
+                    continue;
+                }
+                session.getOutput() << e.what() << endl;
+                break;
+            }
+        }
+        saveMetadata();
+    }
+    groupCommit = outerGroupCommit;
+    if(!groupCommit) {
+        saveMetadata();
     }
 
-    cout << endl <<  Constants::COMMAND_SUCCESS << endl;
+    session.getOutput() << endl <<  Constants::COMMAND_SUCCESS << endl;
 }
 
-void VFSManager::ln(string source, string target) {
+void VFSManager::ln(Session &session, string source, string target) {
     int sourceInodeIdx;
 
     // parse source path
-    parsePath(source, &sourceInodeIdx);
+    parsePath(session, source, &sourceInodeIdx);
 
-    // inode not exists or it is a directory - source path not found
-    if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE || inodes[sourceInodeIdx].isDirectory) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+    // inode not exists - source path not found
+    if(sourceInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
         return;
     }
 
     int parentInodeIdx;
-    char *targetName;
+    char *targetName = nullptr;
     // parse target path
-    parseParentPath(target, &parentInodeIdx, &targetName);
+    parseParentPath(session, target, &parentInodeIdx, &targetName);
 
-    // target parent inode not exist - path not found
-    if(parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
-        cout << Constants::PATH_NOT_FOUND << endl;
+    // lock source with target parent, source could be removed by another session
+    InodeGuard guard(&inodeLocks);
+    vector<int> lockedIdxs = {sourceInodeIdx};
+    if(parentInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+        lockedIdxs.push_back(parentInodeIdx);
+    }
+    guard.lock(lockedIdxs);
+
+    // source is a directory - source path not found, target parent inode not exist - path not found
+    if(!inodesBitmap.isFull(sourceInodeIdx) || inodes[sourceInodeIdx].isDirectory || parentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        free(targetName);
         return;
     }
 
-    // check if name is unique
-    if(!itemNameUnique(parentInodeIdx, targetName)) {
-        cout << Constants::EXIST << endl;
+    // check if link can be created in parent
+    if(!canAddItem(session, parentInodeIdx, targetName)) {
+        free(targetName);
         return;
     }
 
@@ -854,435 +1736,2021 @@ void VFSManager::ln(string source, string target) {
     addDirectoryItem(parentInodeIdx, sourceInodeIdx, targetName);
     // increment hardlink references
     inodes[sourceInodeIdx].references += 1;
+    markInodeDirty(sourceInodeIdx);
 
-    saveMetadata();
-    cout << Constants::COMMAND_SUCCESS << endl;
+    free(targetName);
+    session.getOutput() << Constants::COMMAND_SUCCESS << endl;
 }
 
 void VFSManager::saveMetadata() {
-    // save metadata
-    fseek(fp, sb.inodesBitmapAddress, SEEK_SET);
-    fwrite(inodesBitmap, sizeof(char), sb.inodesCount, fp);
-    fwrite(dataBitmap, sizeof(char), sb.clusterCount, fp);
-    fwrite(inodes, sizeof(inode), sb.inodesCount, fp);
-    fflush(fp);
+    // nothing was changed
+    if(!inodesBitmap.getDirtyPages().any() && !dataBitmap.getDirtyPages().any() && !fragments.getDirtyPages().any() && !clusterRefs.getDirtyPages().any() && !chunkIndex.getDirtyPages().any()
+            && !dirtyInodes.any() && journal.getPendingBytes() == 0 && bufferCache.getDirtyBytes() == 0) {
+        return;
+    }
+
+    stageMetadata();
+
+    // changes of command are one transaction, commands of script are committed together (until journal is filled by quarter)
+    if(!groupCommit || groupCommitDue()) {
+        commitMetadata();
+    }
+}
+
+void VFSManager::commitMetadata() {
+    bufferCache.flush();
+    journal.commit();
+
+    // items removed by committed changes are not in image, so their clusters can be taken
+    markPendingFree(true);
+    pendingFreeClusters.clear();
+    pendingFreeFragments.clear();
+    savepointFreeClusters = 0;
+    savepointFreeFragments = 0;
+}
+
+void VFSManager::abortChanges() {
+    // writes of data are finished, their clusters are free again after metadata are loaded
+    ioEngine->drain();
+    unwrittenChunks.clear();
+
+    // uncommitted changes (since savepoint) are dropped (changes written in place stay, as if the process ended), caches of metadata are emptied
+    journal.abort();
+    bufferCache.discard(sb.dataClustersAddress, (long long) sb.clusterCount * sb.clusterSize);
+    loadMetadata();
+
+    // clusters freed before savepoint are free in staged bitmaps, they stay used until commit
+    pendingFreeClusters.resize(savepointFreeClusters);
+    pendingFreeFragments.resize(savepointFreeFragments);
+    markPendingFree(false);
+    dentryCache.clear();
+    lock_guard<mutex> guard(blockMapLock);
+    blockMapCache.clear();
+    blockMapCacheSize = 0;
+}
+
+void VFSManager::setSavepoint() {
+    stageMetadata();
+    bufferCache.flush();
+    journal.savepoint();
+    savepointFreeClusters = pendingFreeClusters.size();
+    savepointFreeFragments = pendingFreeFragments.size();
+}
+
+void VFSManager::stageMetadata() {
+    // clusters and fragments freed by staged changes are free in image, in memory they stay used until commit (no command runs)
+    markPendingFree(true);
+    // save changed pages of metadata - areas do not need to follow each other (migrated images)
+    saveDirtyPages(sb.inodesBitmapAddress, (char *) inodesBitmap.getWords(), inodesBitmap.getDirtyPages());
+    saveDirtyPages(sb.dataClustersBitmapAddress, (char *) dataBitmap.getWords(), dataBitmap.getDirtyPages());
+    saveDirtyPages(sb.fragmentsBitmapAddress, (char *) fragments.getWords(), fragments.getDirtyPages());
+    saveDirtyPages(sb.clusterRefsAddress, (char *) clusterRefs.getCounts(), clusterRefs.getDirtyPages());
+    saveDirtyPages(sb.chunkHashesAddress, (char *) chunkIndex.getHashes(), chunkIndex.getDirtyPages());
+    saveDirtyPages(sb.inodesAddress, (char *) inodes, dirtyInodes);
+    markPendingFree(false);
+}
+
+bool VFSManager::groupCommitDue() {
+    return journal.getPendingBytes() + bufferCache.getDirtyBytes() > journal.getSize() / 4;
+}
+
+void VFSManager::saveDirtyPages(long long address, char *area, DirtyPages &dirtyPages) {
+    // area accessed directly in image in memory does not need to be copied
+    char *memory = device->getMemory();
+    if(memory == nullptr || area != memory + address) {
+        vector<long long> offsets;
+        vector<long long> lengths;
+        dirtyPages.getDirtyRuns(&offsets, &lengths);
+        for(int i = 0; i < offsets.size(); i++) {
+            writeMetadata(address + offsets[i], area + offsets[i], lengths[i]);
+        }
+    }
+    dirtyPages.clear();
+}
+
+void VFSManager::markInodeDirty(int inodeIdx) {
+    lock_guard<mutex> guard(dirtyInodesLock);
+    dirtyInodes.markBytes(inodeIdx * sizeof(inode), sizeof(inode));
 }
 
-int VFSManager::getBytesSize(string sizeString) {
-    if(sizeString[sizeString.length() - 2]  == 'K' || sizeString[sizeString.length() - 2]  == 'k' ||
-            sizeString[sizeString.length() - 2]  == 'M' || sizeString[sizeString.length() - 2]  == 'G') {
-        // unit is KB/MB/GB
-        // get unit and value passed
-        string unit = sizeString.substr(sizeString.length() - 2, 2);
-        int value = stoi(sizeString.substr(0, sizeString.length() - 2));
+void VFSManager::saveSuperBlock() {
+    // super block is padded with zeros to the size of its area
+    char area[Constants::SUPER_BLOCK_AREA_SIZE];
+    memset(area, 0, Constants::SUPER_BLOCK_AREA_SIZE);
+    memcpy(area, &sb, sizeof(superBlock));
+
+    writeImage(0, area, Constants::SUPER_BLOCK_AREA_SIZE);
+}
 
-        if(unit == "kB" || unit == "KB") {
-            return value * 1000;
+void VFSManager::loadMetadata() {
+    char *memory = device->getMemory();
+    if(memory != nullptr) {
+        // bitmaps and inodes are accessed directly in image in memory
+        inodesBitmap.attach((uint64_t *) (memory + sb.inodesBitmapAddress), sb.inodesCount);
+        dataBitmap.attach((uint64_t *) (memory + sb.dataClustersBitmapAddress), sb.clusterCount);
+        if(sb.features & Constants::FEATURE_TAIL_PACKING) {
+            fragments.attach((uint64_t *) (memory + sb.fragmentsBitmapAddress), sb.clusterCount);
         }
-        else if(unit == "GB") {
-            return value * 1000000000;
+        if(sb.features & Constants::FEATURE_REFLINK) {
+            clusterRefs.attach((uint16_t *) (memory + sb.clusterRefsAddress), sb.clusterCount);
         }
-        else {
-            return value * 1000000;
+        if(sb.features & Constants::FEATURE_DEDUP) {
+            chunkIndex.attach((uint64_t *) (memory + sb.chunkHashesAddress), sb.clusterCount);
         }
+        if(inodes != nullptr && !inodesMapped) {
+            free(inodes);
+        }
+        inodes = (inode *) (memory + sb.inodesAddress);
+        inodesMapped = true;
+        dirtyInodes.init(sb.inodesCount * sizeof(inode));
+        return;
     }
-    else {
-        // unit is Byte
-        return stoi(sizeString.substr(0, sizeString.length() - 1));
+
+    // read inodes bitmap
+    inodesBitmap.init(sb.inodesCount);
+    readImage(sb.inodesBitmapAddress, inodesBitmap.getWords(), inodesBitmap.getBytesSize());
+    inodesBitmap.loaded();
+
+    // read data clusters bitmap
+    dataBitmap.init(sb.clusterCount);
+    readImage(sb.dataClustersBitmapAddress, dataBitmap.getWords(), dataBitmap.getBytesSize());
+    dataBitmap.loaded();
+
+    // read fragments bitmap
+    if(sb.features & Constants::FEATURE_TAIL_PACKING) {
+        fragments.init(sb.clusterCount);
+        readImage(sb.fragmentsBitmapAddress, fragments.getWords(), fragments.getBytesSize());
+        fragments.loaded();
+    }
+
+    // read counts of references to shared clusters
+    if(sb.features & Constants::FEATURE_REFLINK) {
+        clusterRefs.init(sb.clusterCount);
+        readImage(sb.clusterRefsAddress, clusterRefs.getCounts(), clusterRefs.getBytesSize());
+        clusterRefs.loaded();
+    }
+
+    // read hashes of clusters and build index of them
+    if(sb.features & Constants::FEATURE_DEDUP) {
+        chunkIndex.init(sb.clusterCount);
+        readImage(sb.chunkHashesAddress, chunkIndex.getHashes(), chunkIndex.getBytesSize());
+        chunkIndex.loaded();
+    }
+
+    // read inodes
+    if(inodes != nullptr && !inodesMapped) {
+        free(inodes);
     }
+    inodes = (inode *) malloc(sb.inodesCount * sizeof(inode));
+    readImage(sb.inodesAddress, inodes, sb.inodesCount * sizeof(inode));
+    dirtyInodes.init(sb.inodesCount * sizeof(inode));
 }
 
-void VFSManager::addTraversalReference(int inodeIdx, int parentIdx) {
-    // self reference
-    addDirectoryItem(inodeIdx, inodeIdx, Constants::SELF_REF);
-    // parent reference
-    addDirectoryItem(inodeIdx, parentIdx, Constants::PARENT_REF);
+void VFSManager::detachMetadata() {
+    if(!inodesMapped) {
+        return;
+    }
+
+    // bitmaps and inodes in image in memory are not accessible after device is closed
+    inodes = nullptr;
+    inodesMapped = false;
+    inodesBitmap.init(0);
+    dataBitmap.init(0);
+    fragments.init(0);
+    clusterRefs.init(0);
+    chunkIndex.init(0);
 }
 
-void VFSManager::addDirectoryItem(int dirInodeIdx, int targetInodeIdx, char *itemName) {
-    // init item
-    directoryItem item;
-    item.inode = targetInodeIdx;
-    memset(&item.name, 0, Constants::ITEM_MAX_NAME_LEN);
-    strcpy(item.name, itemName);
+void VFSManager::readImage(long long address, void *buffer, long long bytesCount) {
+    if(bufferCache.covers(address)) {
+        bufferCache.read(address, buffer, bytesCount);
+        return;
+    }
 
-    // item index in cluster
-    int itemClusterIdx = inodes[dirInodeIdx].size / sizeof(directoryItem);
+    device->read(address, buffer, bytesCount);
+    journal.patch(address, buffer, bytesCount);
+}
+
+void VFSManager::writeMetadata(long long address, const void *buffer, long long bytesCount) {
+    if(bufferCache.covers(address)) {
+        bufferCache.write(address, buffer, bytesCount);
+        return;
+    }
+
+    journal.write(address, buffer, bytesCount);
+}
+
+void VFSManager::openJournal() {
+    // metadata in image in memory are changed in place, so journal is not used for them
+    journal.open(device, sb.journalAddress, sb.features & Constants::FEATURE_JOURNAL ? sb.journalSize : 0, device->getMemory() == nullptr);
+    int replayed = journal.replay();
+    if(replayed > 0) {
+        cout << Constants::JOURNAL_REPLAYED_MSG << replayed << endl;
+    }
+}
+
+void VFSManager::openBufferCache() {
+    // clusters of image in memory are accessed directly
+    long long blocksCount = device->getMemory() == nullptr ? sb.clusterCount : 0;
+    bufferCache.open(device, &journal, sb.dataClustersAddress, sb.clusterSize, blocksCount);
+}
+
+void VFSManager::freeMetadataCluster(int clusterIdx) {
+    // changes of cluster are dropped, older transactions are not replayed to it when it holds data of another item
+    bufferCache.discard(sb.dataClustersAddress + (long long) clusterIdx * sb.clusterSize, sb.clusterSize);
+    journal.revoke(sb.dataClustersAddress + (long long) clusterIdx * sb.clusterSize, sb.clusterSize);
+    freeDataCluster(clusterIdx);
+}
+
+void VFSManager::freeDataCluster(int clusterIdx) {
+    // metadata changed in place do not wait for commit
+    if(!journal.isActive()) {
+        dataBitmap.setEmpty(clusterIdx);
+        return;
+    }
+
+    lock_guard<mutex> guard(pendingFreeLock);
+    pendingFreeClusters.push_back(clusterIdx);
+}
+
+void VFSManager::freeFragments(int fragmentIdx, int fragmentsCount) {
+    if(!journal.isActive()) {
+        if(fragments.setEmpty(fragmentIdx, fragmentsCount)) {
+            // the last fragments left the cluster
+            dataBitmap.setEmpty(fragmentIdx / Constants::FRAGMENTS_PER_CLUSTER);
+        }
+        return;
+    }
+
+    lock_guard<mutex> guard(pendingFreeLock);
+    pendingFreeFragments.push_back(make_pair(fragmentIdx, fragmentsCount));
+}
+
+void VFSManager::markPendingFree(bool empty) {
+    for(int i = 0; i < pendingFreeFragments.size(); i++) {
+        int fragmentIdx = pendingFreeFragments[i].first;
+        int clusterIdx = fragmentIdx / Constants::FRAGMENTS_PER_CLUSTER;
+        if(!empty) {
+            fragments.setFull(fragmentIdx, pendingFreeFragments[i].second);
+            dataBitmap.setFull(clusterIdx);
+        }
+        else if(fragments.setEmpty(fragmentIdx, pendingFreeFragments[i].second)) {
+            // the last fragments left the cluster
+            dataBitmap.setEmpty(clusterIdx);
+        }
+    }
+    for(int i = 0; i < pendingFreeClusters.size(); i++) {
+        if(empty) {
+            dataBitmap.setEmpty(pendingFreeClusters[i]);
+        }
+        else {
+            dataBitmap.setFull(pendingFreeClusters[i]);
+        }
+    }
+}
+
+void VFSManager::submitDataWrite(long long address, const void *buffer, int bytesCount, int ioTag) {
+    bufferCache.discard(address, bytesCount);
+    ioEngine->submitWrite(address, buffer, bytesCount, ioTag);
+}
+
+void VFSManager::writeImage(long long address, const void *buffer, long long bytesCount) {
+    device->write(address, buffer, bytesCount);
+}
+
+void VFSManager::flushImage() {
+    device->flush();
+}
+
+bool VFSManager::migrateLegacyImage() {
+    // read super block of image without version
+    legacySuperBlock legacy;
+    readImage(0, &legacy, sizeof(legacySuperBlock));
+
+    // legacy image has byte bitmaps right behind super block
+    if(legacy.inodesBitmapAddress != sizeof(legacySuperBlock) || legacy.inodesCount <= 0 || legacy.clusterCount <= 0) {
+        return false;
+    }
+
+    // inodes and data clusters stay where they are, packed bitmaps are stored to the area of byte bitmaps - result is image of version 2
+    superBlock32 packed;
+    packed.magic = Constants::VFS_MAGIC;
+    packed.version = Constants::FORMAT_VERSION_32BIT;
+    packed.features = 0;
+    packed.diskSize = legacy.diskSize;
+    packed.clusterSize = legacy.clusterSize;
+    packed.clusterCount = legacy.clusterCount;
+    packed.inodesCount = legacy.inodesCount;
+    packed.inodesBitmapAddress = Constants::SUPER_BLOCK_AREA_SIZE;
+    packed.dataClustersBitmapAddress = packed.inodesBitmapAddress + Bitmap::bytesSizeFor(packed.inodesCount);
+    packed.inodesAddress = legacy.inodesAddress;
+    packed.dataClustersAddress = legacy.dataClustersAddress;
+
+    // check if super block area and packed bitmaps fit before inodes
+    if(packed.dataClustersBitmapAddress + Bitmap::bytesSizeFor(packed.clusterCount) > packed.inodesAddress) {
+        return false;
+    }
+
+    // read byte bitmaps and pack them
+    char *bytes = (char *) malloc(packed.inodesCount + packed.clusterCount);
+    readImage(legacy.inodesBitmapAddress, bytes, packed.inodesCount + packed.clusterCount);
+    inodesBitmap.init(packed.inodesCount);
+    for(int i = 0; i < packed.inodesCount; i++) {
+        if(bytes[i] != 0) {
+            inodesBitmap.setFull(i);
+        }
+    }
+    dataBitmap.init(packed.clusterCount);
+    for(int i = 0; i < packed.clusterCount; i++) {
+        if(bytes[packed.inodesCount + i] != 0) {
+            dataBitmap.setFull(i);
+        }
+    }
+    free(bytes);
+
+    // store packed bitmaps and super block of version 2
+    writeImage(packed.inodesBitmapAddress, inodesBitmap.getWords(), inodesBitmap.getBytesSize());
+    writeImage(packed.dataClustersBitmapAddress, dataBitmap.getWords(), dataBitmap.getBytesSize());
+    char area[Constants::SUPER_BLOCK_AREA_SIZE];
+    memset(area, 0, Constants::SUPER_BLOCK_AREA_SIZE);
+    memcpy(area, &packed, sizeof(superBlock32));
+    writeImage(0, area, Constants::SUPER_BLOCK_AREA_SIZE);
+    return true;
+}
+
+bool VFSManager::convertImage32() {
+    // read super block with 32-bit sizes and addresses
+    superBlock32 old;
+    readImage(0, &old, sizeof(superBlock32));
+    if(old.magic != Constants::VFS_MAGIC || old.version != Constants::FORMAT_VERSION_32BIT || (old.features & ~Constants::SUPPORTED_FEATURES) != 0) {
+        return false;
+    }
+
+    // bitmaps and data clusters stay where they are, inodes are bigger, so they are moved to the end of image
+    sb.magic = Constants::VFS_MAGIC;
+    sb.version = Constants::FORMAT_VERSION;
+    // widened inodes have flags cleared, so new small files can be stored in inodes
+    sb.features = old.features | Constants::FEATURE_INLINE_DATA;
+    sb.clusterSize = old.clusterSize;
+    sb.clusterCount = old.clusterCount;
+    sb.inodesCount = old.inodesCount;
+    sb.inodesBitmapAddress = old.inodesBitmapAddress;
+    sb.dataClustersBitmapAddress = old.dataClustersBitmapAddress;
+    sb.dataClustersAddress = old.dataClustersAddress;
+    sb.fragmentsBitmapAddress = 0;
+    sb.clusterRefsAddress = 0;
+    sb.chunkHashesAddress = 0;
+    sb.journalAddress = 0;
+    sb.journalSize = 0;
+    sb.inodesAddress = (old.diskSize + sizeof(long long) - 1) / sizeof(long long) * sizeof(long long);
+    sb.diskSize = sb.inodesAddress + sb.inodesCount * sizeof(inode);
+
+    // read bitmaps
+    inodesBitmap.init(sb.inodesCount);
+    readImage(sb.inodesBitmapAddress, inodesBitmap.getWords(), inodesBitmap.getBytesSize());
+    inodesBitmap.loaded();
+    dataBitmap.init(sb.clusterCount);
+    readImage(sb.dataClustersBitmapAddress, dataBitmap.getWords(), dataBitmap.getBytesSize());
+    dataBitmap.loaded();
+
+    // read inodes and widen their sizes
+    inode32 *oldInodes = (inode32 *) malloc(sb.inodesCount * sizeof(inode32));
+    readImage(old.inodesAddress, oldInodes, sb.inodesCount * sizeof(inode32));
+    inodes = (inode *) malloc(sb.inodesCount * sizeof(inode));
+    memset(inodes, 0, sb.inodesCount * sizeof(inode));
+    for(int i = 0; i < sb.inodesCount; i++) {
+        inodes[i].isDirectory = oldInodes[i].isDirectory;
+        inodes[i].flags = 0;
+        inodes[i].references = oldInodes[i].references;
+        inodes[i].size = oldInodes[i].size;
+        memcpy(inodes[i].directs, oldInodes[i].clusterReferences, sizeof(oldInodes[i].clusterReferences));
+    }
+    free(oldInodes);
+    dirtyInodes.init(sb.inodesCount * sizeof(inode));
+
+    // store image in new format - image grows by new inodes
+    if(!device->resize(sb.diskSize)) {
+        return false;
+    }
+    dirtyInodes.markAll();
+    saveSuperBlock();
+    saveMetadata();
+    return true;
+}
+
+long long VFSManager::getBytesSize(string sizeString) {
+    // unit is KB/MB/GB or Byte
+    int unitLength = 1;
+    long long unitSize = 1;
+    if(sizeString.length() >= 2 && (sizeString[sizeString.length() - 2] == 'K' || sizeString[sizeString.length() - 2] == 'k')) {
+        unitLength = 2;
+        unitSize = 1000;
+    }
+    else if(sizeString.length() >= 2 && sizeString[sizeString.length() - 2] == 'M') {
+        unitLength = 2;
+        unitSize = 1000000;
+    }
+    else if(sizeString.length() >= 2 && sizeString[sizeString.length() - 2] == 'G') {
+        unitLength = 2;
+        unitSize = 1000000000;
+    }
+
+    // value must be number which fits to size in bytes, -1 is returned otherwise
+    string value = sizeString.substr(0, sizeString.length() - min((int) sizeString.length(), unitLength));
+    if(!StringUtils::isNumber(value) || value.length() > Constants::MAX_SIZE_DIGITS) {
+        return -1;
+    }
+    long long bytesSize = stoll(value);
+    if(bytesSize > LLONG_MAX / unitSize) {
+        return -1;
+    }
+    return bytesSize * unitSize;
+}
+
+void VFSManager::addTraversalReference(int inodeIdx, int parentIdx) {
+    // self reference
+    addDirectoryItem(inodeIdx, inodeIdx, Constants::SELF_REF);
+    // parent reference
+    addDirectoryItem(inodeIdx, parentIdx, Constants::PARENT_REF);
+}
+
+void VFSManager::addDirectoryItem(int dirInodeIdx, int targetInodeIdx, char *itemName) {
+    // init item
+    directoryItem item;
+    item.inode = targetInodeIdx;
+    memset(&item.name, 0, Constants::ITEM_MAX_NAME_LEN);
+    strcpy(item.name, itemName);
+
+    if(sb.features & Constants::FEATURE_HASHED_DIRS) {
+        // item is stored to its bucket
+        addHashedDirectoryItem(dirInodeIdx, &item);
+        // item exists now
+        dentryCache.insert(dirInodeIdx, itemName, targetInodeIdx);
+        return;
+    }
+
+    // item index in cluster
+    int itemClusterIdx = inodes[dirInodeIdx].size / sizeof(directoryItem);
+
+    if(itemClusterIdx == 0) {
+        // first item in cluster - need to allocate cluster, insert item and set reference
+        int freeClusterIdx = allocateClusterIdx();
+        saveDirItem((long long) freeClusterIdx * sb.clusterSize, &item);
+        addClusterRun(dirInodeIdx, 0, freeClusterIdx, 1);
+    }
+    else {
+        // it is possible to insert item in already existing cluster
+        saveDirItem((long long) getDataClusterIdxByChunkIdx(dirInodeIdx, 0) * sb.clusterSize + itemClusterIdx * sizeof(directoryItem), &item);
+    }
+
+    // increment size
+    inodes[dirInodeIdx].size += sizeof(directoryItem);
+    markInodeDirty(dirInodeIdx);
+
+    // item exists now
+    dentryCache.insert(dirInodeIdx, itemName, targetInodeIdx);
+}
+
+void VFSManager::saveDirItem(long long addressInClusters, directoryItem *item) {
+    // set right address and save
+    long long address = sb.dataClustersAddress + addressInClusters;
+    writeMetadata(address, item, sizeof(directoryItem));
+}
+
+int VFSManager::allocateClusterIdx() {
+    // take first empty cluster in bitmap
+    int freeClusterIdx = dataBitmap.allocate();
+    if(freeClusterIdx != -1) {
+        return freeClusterIdx;
+    }
+
+    // if no free cluster found command fails
+    throw runtime_error(Constants::FULL_CLUSTERS_MSG);
+}
+
+int VFSManager::checkPathExists(vector<string> path, int startInodeIdx) {
+    int currentInodeIdx = startInodeIdx;
+    // every dir is locked while it is searched
+    InodeGuard guard(&inodeLocks);
+    // iterate through path
+    for(int i = 0; i < path.size(); i++) {
+        // only directories can be traversed (dir could be removed by another session)
+        guard.lockShared(currentInodeIdx);
+        if(!inodesBitmap.isFull(currentInodeIdx) || !inodes[currentInodeIdx].isDirectory) {
+            return Constants::INODE_NOT_EXISTS_CODE;
+        }
+
+        // find item in dir
+        currentInodeIdx = getItemInodeIdxByName(currentInodeIdx, path[i].c_str());
+
+        if(currentInodeIdx == Constants::INODE_NOT_EXISTS_CODE) {
+            return Constants::INODE_NOT_EXISTS_CODE;
+        }
+    }
+
+    return currentInodeIdx;
+}
+
+int VFSManager::allocateInodeIdx() {
+    // take first empty inode in bitmap
+    int freeInodeIdx = inodesBitmap.allocate();
+    if(freeInodeIdx != -1) {
+        return freeInodeIdx;
+    }
+
+    // if no free inodes found command fails
+    throw runtime_error(Constants::FULL_INODES_MSG);
+}
+
+bool VFSManager::itemNameUnique(int dirInodeIdx, char *itemName) {
+    // name is unique if there is no item with it
+    return getItemInodeIdxByName(dirInodeIdx, itemName) == Constants::INODE_NOT_EXISTS_CODE;
+}
+
+bool VFSManager::directoryHasSpace(int dirInodeIdx) {
+    // hashed dir grows, linear dir has only one cluster
+    return (sb.features & Constants::FEATURE_HASHED_DIRS) || inodes[dirInodeIdx].size + sizeof(directoryItem) <= sb.clusterSize;
+}
+
+bool VFSManager::canAddItem(Session &session, int dirInodeIdx, char *itemName) {
+    // dir could be removed by another session
+    if(!inodesBitmap.isFull(dirInodeIdx) || !inodes[dirInodeIdx].isDirectory) {
+        session.getOutput() << Constants::PATH_NOT_FOUND << endl;
+        return false;
+    }
+
+    // check if name is unique
+    if(!itemNameUnique(dirInodeIdx, itemName)) {
+        session.getOutput() << Constants::EXIST << endl;
+        return false;
+    }
+
+    // check if item fits to dir
+    if(!directoryHasSpace(dirInodeIdx)) {
+        session.getOutput() << Constants::DIR_FULL_MSG << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void VFSManager::lockItem(InodeGuard *guard, int parentInodeIdx, const char *itemName, int *itemInodeIdx) {
+    // item is found under lock of parent, it is locked with parent and found again, until it is the same item
+    // (another session could replace it in the meantime)
+    int lockedIdx = Constants::INODE_NOT_EXISTS_CODE;
+    while(true) {
+        vector<int> lockedIdxs = {parentInodeIdx};
+        if(lockedIdx != Constants::INODE_NOT_EXISTS_CODE) {
+            lockedIdxs.push_back(lockedIdx);
+        }
+        guard->lock(lockedIdxs);
+
+        // dir could be removed by another session
+        if(!inodesBitmap.isFull(parentInodeIdx) || !inodes[parentInodeIdx].isDirectory) {
+            *itemInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+            return;
+        }
+
+        int foundIdx = getItemInodeIdxByName(parentInodeIdx, itemName);
+        if(foundIdx == lockedIdx) {
+            *itemInodeIdx = foundIdx;
+            return;
+        }
+        lockedIdx = foundIdx;
+    }
+}
+
+void VFSManager::freeItem(int inodeIdx) {
+    // free data clusters - clusters of dir are metadata, clusters of file can be shared with other files
+    int clustersCount = ceil(inodes[inodeIdx].size / (double) sb.clusterSize);
+    vector<int> dataClustersIdxs = getDataClustersIdxs(inodeIdx, clustersCount);
+    for(int i = 0; i < dataClustersIdxs.size(); i++) {
+        if(inodes[inodeIdx].isDirectory) {
+            freeMetadataCluster(dataClustersIdxs[i]);
+        }
+        else if(isCompressed(inodeIdx)) {
+            // compressed chunk has its own fragments
+            freeCompressedChunk(dataClustersIdxs[i]);
+        }
+        else if(hasPackedTail(inodeIdx) && i == dataClustersIdxs.size() - 1) {
+            // shared cluster is freed with its last tail
+            freeTailFragments(inodeIdx, dataClustersIdxs[i]);
+        }
+        else {
+            releaseCluster(dataClustersIdxs[i]);
+        }
+    }
+
+    // free clusters with references to them
+    vector<int> indirectClustersIdxs = getIndirectClustersIdxs(inodeIdx, clustersCount);
+    for(int i = 0; i < indirectClustersIdxs.size(); i++) {
+        freeMetadataCluster(indirectClustersIdxs[i]);
+    }
+    invalidateBlockMap(inodeIdx);
+    if(inodes[inodeIdx].isDirectory) {
+        dentryCache.invalidateParent(inodeIdx);
+    }
+
+    // inode is free the last, so it is not taken by another command before its clusters are free
+    inodesBitmap.setEmpty(inodeIdx);
+}
+
+vector<directoryItem> VFSManager::getAllDirectoryItems(int dirInodeIdx) {
+    vector<directoryItem> items;
+
+    if(sb.features & Constants::FEATURE_HASHED_DIRS) {
+        // collect used slots of all buckets
+        int itemsPerBucket = sb.clusterSize / sizeof(directoryItem);
+        vector<int> bucketsIdxs = getDataClustersIdxs(dirInodeIdx, inodes[dirInodeIdx].size / sb.clusterSize);
+        directoryItem *bucket = (directoryItem *) malloc(sb.clusterSize);
+        for(int i = 0; i < bucketsIdxs.size(); i++) {
+            readDataChunk(bucketsIdxs[i], (char *) bucket, sb.clusterSize);
+            for(int j = 0; j < itemsPerBucket; j++) {
+                if(bucket[j].name[0] != '\0') {
+                    items.push_back(bucket[j]);
+                }
+            }
+        }
+        free(bucket);
+        return items;
+    }
+
+    // seek to the address and load items
+    items.resize(inodes[dirInodeIdx].size / sizeof(directoryItem));
+    long long itemsClusterAddress = sb.dataClustersAddress + (long long) getDataClusterIdxByChunkIdx(dirInodeIdx, 0) * sb.clusterSize;
+    readImage(itemsClusterAddress, items.data(), items.size() * sizeof(directoryItem));
+    return items;
+}
+
+unsigned int VFSManager::hashItemName(const char *itemName) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for(int i = 0; itemName[i] != '\0'; i++) {
+        hash ^= (unsigned char) itemName[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void VFSManager::addHashedDirectoryItem(int dirInodeIdx, directoryItem *item) {
+    int itemsPerBucket = sb.clusterSize / sizeof(directoryItem);
+
+    if(inodes[dirInodeIdx].size == 0) {
+        // first item - dir has one empty bucket
+        int bucketClusterIdx = allocateClusterIdx();
+        char *emptyBucket = (char *) malloc(sb.clusterSize);
+        memset(emptyBucket, 0, sb.clusterSize);
+        saveDataChunk((long long) bucketClusterIdx * sb.clusterSize, emptyBucket, sb.clusterSize);
+        free(emptyBucket);
+        addClusterRun(dirInodeIdx, 0, bucketClusterIdx, 1);
+        inodes[dirInodeIdx].size = sb.clusterSize;
+        markInodeDirty(dirInodeIdx);
+    }
+
+    directoryItem *bucket = (directoryItem *) malloc(sb.clusterSize);
+    while(true) {
+        // load bucket of item
+        int bucketsCount = inodes[dirInodeIdx].size / sb.clusterSize;
+        int bucketClusterIdx = getDataClusterIdxByChunkIdx(dirInodeIdx, hashItemName(item->name) & (bucketsCount - 1));
+        readDataChunk(bucketClusterIdx, (char *) bucket, sb.clusterSize);
+
+        // store item to free slot
+        for(int i = 0; i < itemsPerBucket; i++) {
+            if(bucket[i].name[0] == '\0') {
+                saveDirItem((long long) bucketClusterIdx * sb.clusterSize + i * sizeof(directoryItem), item);
+                free(bucket);
+                return;
+            }
+        }
+
+        // bucket is full - double count of buckets and try again
+        try {
+            growHashedDirectory(dirInodeIdx);
+        }
+        catch(...) {
+            // image is full
+            free(bucket);
+            throw;
+        }
+    }
+}
+
+void VFSManager::growHashedDirectory(int dirInodeIdx) {
+    int itemsPerBucket = sb.clusterSize / sizeof(directoryItem);
+    int oldBucketsCount = inodes[dirInodeIdx].size / sb.clusterSize;
+    int bucketsCount = 2 * oldBucketsCount;
+    vector<int> oldBucketsIdxs = getDataClustersIdxs(dirInodeIdx, oldBucketsCount);
+
+    // allocate new buckets
+    vector<int> runStarts;
+    vector<int> runLengths;
+    allocateClusterRuns(oldBucketsCount, &runStarts, &runLengths);
+    int chunkIdx = oldBucketsCount;
+    for(int i = 0; i < runStarts.size(); i++) {
+        addClusterRun(dirInodeIdx, chunkIdx, runStarts[i], runLengths[i]);
+        chunkIdx += runLengths[i];
+    }
+    inodes[dirInodeIdx].size = bucketsCount * sb.clusterSize;
+    markInodeDirty(dirInodeIdx);
+    vector<int> bucketsIdxs = getDataClustersIdxs(dirInodeIdx, bucketsCount);
+
+    // redistribute items - items of bucket i go to bucket i or i + oldBucketsCount, so no bucket can overflow
+    directoryItem *buckets = (directoryItem *) malloc(bucketsCount * sb.clusterSize);
+    memset(buckets, 0, bucketsCount * sb.clusterSize);
+    vector<int> bucketsUsed(bucketsCount, 0);
+    directoryItem *oldBucket = (directoryItem *) malloc(sb.clusterSize);
+    for(int i = 0; i < oldBucketsCount; i++) {
+        readDataChunk(oldBucketsIdxs[i], (char *) oldBucket, sb.clusterSize);
+        for(int j = 0; j < itemsPerBucket; j++) {
+            if(oldBucket[j].name[0] != '\0') {
+                int newBucket = hashItemName(oldBucket[j].name) & (bucketsCount - 1);
+                buckets[newBucket * itemsPerBucket + bucketsUsed[newBucket]] = oldBucket[j];
+                bucketsUsed[newBucket]++;
+            }
+        }
+    }
+    free(oldBucket);
+
+    // save all buckets
+    for(int i = 0; i < bucketsCount; i++) {
+        saveDataChunk((long long) bucketsIdxs[i] * sb.clusterSize, (char *) (buckets + i * itemsPerBucket), sb.clusterSize);
+    }
+    free(buckets);
+}
+
+void VFSManager::parseParentPath(const Session &session, string path, int * parentInodeIdx, char ** itemName) {
+    // check validity
+    if(path.empty() || path == "/") {
+        *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+        return;
+    }
+    // whether path is absolut
+    bool absolutPath = false;
+
+    if(path[0] == Constants::PATH_DELIM) {
+        // if path is absolut, remove root dir and mark flag
+        path = path.substr(1, path.length() - 1);
+        absolutPath = true;
+    }
+
+    vector<string> fullPathParts = StringUtils::split(path, Constants::PATH_DELIM);
+    if(fullPathParts.empty()) {
+        *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+        return;
+    }
+
+    // set itemName to the last path part
+    path = fullPathParts[fullPathParts.size() - 1];
+    *itemName = (char *) malloc((path.length() + 1) * sizeof(char));
+    strcpy(*itemName, path.c_str());
+
+    if(fullPathParts.size() == 1) {
+        if(absolutPath) {
+            // creating dir in root
+            *parentInodeIdx = Constants::ROOT_INODE_IDX;
+        }
+        else {
+            // creating dir in current dir
+            *parentInodeIdx = session.getCurrentInode();
+        }
+    }
+    else {
+        // remove item name from the path
+        fullPathParts.erase(fullPathParts.begin() + fullPathParts.size() - 1);
+
+        if(absolutPath) {
+            *parentInodeIdx = checkPathExists(fullPathParts, Constants::ROOT_INODE_IDX);
+        }
+        else {
+            *parentInodeIdx = checkPathExists(fullPathParts, session.getCurrentInode());
+        }
+
+        if(*parentInodeIdx != Constants::INODE_NOT_EXISTS_CODE) {
+            InodeGuard guard(&inodeLocks);
+            guard.lockShared(*parentInodeIdx);
+            if(!inodes[*parentInodeIdx].isDirectory) {
+                *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+            }
+        }
+    }
+}
+
+void VFSManager::parsePath(const Session &session, string path, int * targetInodeIdx) {
+    // check if it is current dir
+    if(path.empty()) {
+        *targetInodeIdx = session.getCurrentInode();
+        return;
+    }
+
+    // check if it is root dir
+    if(path == "/") {
+        *targetInodeIdx = Constants::ROOT_INODE_IDX;
+        return;
+    }
+
+    // whether path is absolut
+    bool absolutPath = false;
+
+    if(path[0] == Constants::PATH_DELIM) {
+        // if path is absolut, remove root dir and mark flag
+        path = path.substr(1, path.length() - 1);
+        absolutPath = true;
+    }
+
+    // split path to parts
+    vector<string> fullPathParts = StringUtils::split(path, Constants::PATH_DELIM);
+    if(fullPathParts.empty()) {
+        *targetInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+        return;
+    }
+
+    // check if path exist
+    if(absolutPath) {
+        *targetInodeIdx = checkPathExists(fullPathParts, Constants::ROOT_INODE_IDX);
+    }
+    else {
+        *targetInodeIdx = checkPathExists(fullPathParts, session.getCurrentInode());
+    }
+}
+
+int VFSManager::getItemInodeIdxByName(int parentInodeIdx, const char *itemName) {
+    // check dentry cache
+    int resultIdx;
+    if(dentryCache.lookup(parentInodeIdx, itemName, &resultIdx)) {
+        return resultIdx;
+    }
+
+    // search dir and remember result (also if item does not exist)
+    resultIdx = searchDirectory(parentInodeIdx, itemName);
+    dentryCache.insert(parentInodeIdx, itemName, resultIdx);
+    return resultIdx;
+}
+
+int VFSManager::searchDirectory(int parentInodeIdx, const char *itemName) {
+    if(sb.features & Constants::FEATURE_HASHED_DIRS) {
+        // only bucket of item is searched
+        int itemsPerBucket = sb.clusterSize / sizeof(directoryItem);
+        int bucketsCount = inodes[parentInodeIdx].size / sb.clusterSize;
+        if(bucketsCount == 0) {
+            return Constants::INODE_NOT_EXISTS_CODE;
+        }
+        directoryItem *bucket = (directoryItem *) malloc(sb.clusterSize);
+        readDataChunk(getDataClusterIdxByChunkIdx(parentInodeIdx, hashItemName(itemName) & (bucketsCount - 1)), (char *) bucket, sb.clusterSize);
+        for(int i = 0; i < itemsPerBucket; i++) {
+            if(strcmp(bucket[i].name, itemName) == 0) {
+                int resultIdx = bucket[i].inode;
+                free(bucket);
+                return resultIdx;
+            }
+        }
+        free(bucket);
+        return Constants::INODE_NOT_EXISTS_CODE;
+    }
+
+    // load items
+    vector<directoryItem> items = getAllDirectoryItems(parentInodeIdx);
+
+    // iterate items and check for the same names, if names are equal, return inode idx
+    for(int i = 0; i < items.size(); i++) {
+        if(strcmp(items[i].name, itemName) == 0) {
+            return items[i].inode;
+        }
+    }
+
+    return Constants::INODE_NOT_EXISTS_CODE;
+}
+
+void VFSManager::deleteItemFromParentCluster(int parentInodeIdx, char *itemName) {
+    // item does not exist anymore
+    dentryCache.insert(parentInodeIdx, itemName, Constants::INODE_NOT_EXISTS_CODE);
+
+    if(sb.features & Constants::FEATURE_HASHED_DIRS) {
+        // clear slot of item in its bucket
+        int itemsPerBucket = sb.clusterSize / sizeof(directoryItem);
+        int bucketsCount = inodes[parentInodeIdx].size / sb.clusterSize;
+        int bucketClusterIdx = getDataClusterIdxByChunkIdx(parentInodeIdx, hashItemName(itemName) & (bucketsCount - 1));
+        directoryItem *bucket = (directoryItem *) malloc(sb.clusterSize);
+        readDataChunk(bucketClusterIdx, (char *) bucket, sb.clusterSize);
+        for(int i = 0; i < itemsPerBucket; i++) {
+            if(strcmp(bucket[i].name, itemName) == 0) {
+                directoryItem emptyItem;
+                memset(&emptyItem, 0, sizeof(directoryItem));
+                saveDirItem((long long) bucketClusterIdx * sb.clusterSize + i * sizeof(directoryItem), &emptyItem);
+                break;
+            }
+        }
+        free(bucket);
+        return;
+    }
+
+    // get all dir items
+    vector<directoryItem> items = getAllDirectoryItems(parentInodeIdx);
+    int itemsCount = items.size();
+
+    // init array for items without deleted
+    directoryItem *itemsWithoutDeleted = (directoryItem *) malloc((itemsCount - 1) * sizeof(directoryItem));
+    // fill array with items without deleted
+    int j = 0;
+    for(int i = 0; i < (itemsCount - 1); i++) {
+        if(strcmp(items[j].name, itemName) == 0) {
+            j++;
+        }
+        itemsWithoutDeleted[i] = items[j];
+        j++;
+    }
+    // save directory items without deleted
+    long long address = sb.dataClustersAddress + (long long) getDataClusterIdxByChunkIdx(parentInodeIdx, 0) * sb.clusterSize;
+    writeMetadata(address, itemsWithoutDeleted, (itemsCount - 1) * sizeof(directoryItem));
+
+    inodes[parentInodeIdx].size -= sizeof(directoryItem);
+    markInodeDirty(parentInodeIdx);
+    free(itemsWithoutDeleted);
+}
+
+int VFSManager::addDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag) {
+    // helpers
+    int firstChunkIdx = ceil(inodes[inodeIdx].size / (double) sb.clusterSize);
+    int chunksCount = ceil(bytesCount / (double) sb.clusterSize);
+    int intsPerCluster = sb.clusterSize / sizeof(int);
+
+    // check if all chunks can be referenced from inode (extent tree is checked when extents are added)
+    if(!(sb.features & Constants::FEATURE_EXTENTS) && firstChunkIdx + chunksCount > Constants::DIRECTS_COUNT + intsPerCluster + (long long) intsPerCluster * intsPerCluster) {
+        throw runtime_error(Constants::FULL_REFERENCES_MSG);
+    }
+
+    if(sb.features & Constants::FEATURE_COMPRESSION) {
+        return addCompressedDataChunks(inodeIdx, buffer, bytesCount, ioTag);
+    }
+    if(sb.features & Constants::FEATURE_DEDUP) {
+        return addDedupDataChunks(inodeIdx, buffer, bytesCount, ioTag);
+    }
+
+    // tail of file (the last chunk which is not whole cluster) is stored in fragments of shared cluster if it saves space
+    int tailBytes = bytesCount % sb.clusterSize;
+    bool packTail = (sb.features & Constants::FEATURE_TAIL_PACKING) && tailBytes != 0 && tailBytes <= sb.clusterSize - getFragmentSize();
+    int clustersBytes = packTail ? bytesCount - tailBytes : bytesCount;
+
+    // reserve runs of contiguous clusters for all other chunks
+    vector<int> runStarts;
+    vector<int> runLengths;
+    allocateClusterRuns(packTail ? chunksCount - 1 : chunksCount, &runStarts, &runLengths);
+
+    // write data of every run at once and store references to its clusters
+    int bufferOffset = 0;
+    int chunkIdx = firstChunkIdx;
+    int writesCount = runStarts.size();
+    try {
+        for(int i = 0; i < runStarts.size(); i++) {
+            int runBytes = runLengths[i] * sb.clusterSize;
+            if(runBytes > clustersBytes - bufferOffset) {
+                runBytes = clustersBytes - bufferOffset;
+            }
+            submitDataWrite(sb.dataClustersAddress + (long long) runStarts[i] * sb.clusterSize, buffer + bufferOffset, runBytes, ioTag);
+            addClusterRun(inodeIdx, chunkIdx, runStarts[i], runLengths[i]);
+            bufferOffset += runBytes;
+            chunkIdx += runLengths[i];
+        }
+
+        if(packTail) {
+            addPackedTail(inodeIdx, chunkIdx, buffer + bufferOffset, tailBytes, ioTag);
+            writesCount++;
+        }
+    }
+    catch(...) {
+        // size of inode does not cover the batch, so its runs are not freed with the item
+        ioEngine->drain();
+        for(int i = 0; i < runStarts.size(); i++) {
+            for(int j = 0; j < runLengths[i]; j++) {
+                freeDataCluster(runStarts[i] + j);
+            }
+        }
+        if(!(sb.features & Constants::FEATURE_EXTENTS)) {
+            // neither are clusters with references to the runs which were added
+            vector<int> itemIndirectsIdxs = getIndirectClustersIdxs(inodeIdx, firstChunkIdx);
+            vector<int> batchIndirectsIdxs = getIndirectClustersIdxs(inodeIdx, chunkIdx);
+            for(int i = itemIndirectsIdxs.size(); i < batchIndirectsIdxs.size(); i++) {
+                freeMetadataCluster(batchIndirectsIdxs[i]);
+            }
+        }
+        throw;
+    }
+
+    // increment size
+    inodes[inodeIdx].size += bytesCount;
+    markInodeDirty(inodeIdx);
+    return writesCount;
+}
+
+int VFSManager::addDedupDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag) {
+    // helpers
+    int firstChunkIdx = ceil(inodes[inodeIdx].size / (double) sb.clusterSize);
+    int chunksCount = ceil(bytesCount / (double) sb.clusterSize);
+    int fullChunksCount = bytesCount / sb.clusterSize;
+    int tailBytes = bytesCount % sb.clusterSize;
+    bool packTail = (sb.features & Constants::FEATURE_TAIL_PACKING) && tailBytes != 0 && tailBytes <= sb.clusterSize - getFragmentSize();
+    int clusterChunksCount = packTail ? chunksCount - 1 : chunksCount;
+
+    // writes from buffer which was used with this tag are finished, so its chunks are in image
+    for(map<int, pair<int, const char *>>::iterator it = unwrittenChunks.begin(); it != unwrittenChunks.end(); ) {
+        if(it->second.first == ioTag) {
+            it = unwrittenChunks.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+
+    // find whole chunks which are already stored in image or earlier in this batch, hash match is verified by content
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<uint64_t> chunkHashes(fullChunksCount);
+    vector<int> chunkClusters(clusterChunksCount, (int) Constants::NO_CLUSTER);
+    vector<int> sameChunks(clusterChunksCount, -1);
+    unordered_map<uint64_t, int> batchChunks;
+    char *stored = (char *) malloc(sb.clusterSize * sizeof(char));
+    int newClustersCount = 0;
+    for(int i = 0; i < clusterChunksCount; i++) {
+        if(i == fullChunksCount) {
+            // partial chunk is not deduplicated
+            newClustersCount++;
+            break;
+        }
+
+        const char *chunk = buffer + (long long) i * sb.clusterSize;
+        chunkHashes[i] = ChunkIndex::hash(chunk, sb.clusterSize);
+        int clusterIdx = chunkIndex.find(chunkHashes[i]);
+        if(clusterIdx != -1 && !clusterRefs.isSaturated(clusterIdx) && chunkStored(clusterIdx, chunk, stored)) {
+            chunkClusters[i] = clusterIdx;
+            clusterRefs.increment(clusterIdx);
+            chunkIndex.addDuplicate();
+            continue;
+        }
+
+        unordered_map<uint64_t, int>::iterator same = batchChunks.find(chunkHashes[i]);
+        if(same != batchChunks.end() && memcmp(buffer + (long long) same->second * sb.clusterSize, chunk, sb.clusterSize) == 0) {
+            sameChunks[i] = same->second;
+            chunkIndex.addDuplicate();
+            continue;
+        }
+
+        batchChunks[chunkHashes[i]] = i;
+        newClustersCount++;
+    }
+    free(stored);
+    chunkIndex.addHashed(fullChunksCount, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+
+    // reserve clusters for new chunks and assign them in order
+    vector<int> runStarts;
+    vector<int> runLengths;
+    allocateClusterRuns(newClustersCount, &runStarts, &runLengths);
+    vector<bool> newChunks(clusterChunksCount, false);
+    int runIdx = 0;
+    int nextInRun = 0;
+    for(int i = 0; i < clusterChunksCount; i++) {
+        if(chunkClusters[i] != Constants::NO_CLUSTER) {
+            continue;
+        }
+        if(sameChunks[i] != -1) {
+            // cluster of the same chunk is shared
+            chunkClusters[i] = chunkClusters[sameChunks[i]];
+            clusterRefs.increment(chunkClusters[i]);
+            continue;
+        }
+
+        chunkClusters[i] = runStarts[runIdx] + nextInRun;
+        newChunks[i] = true;
+        nextInRun++;
+        if(nextInRun == runLengths[runIdx]) {
+            runIdx++;
+            nextInRun = 0;
+        }
+        if(i < fullChunksCount) {
+            chunkIndex.insert(chunkClusters[i], chunkHashes[i]);
+            unwrittenChunks[chunkClusters[i]] = make_pair(ioTag, buffer + (long long) i * sb.clusterSize);
+        }
+    }
+
+    // write new chunks - chunks which follow each other in buffer and in image at once, references are stored by runs
+    int writesCount = 0;
+    for(int i = 0; i < clusterChunksCount; ) {
+        int runLength = getClustersRunLength(chunkClusters, i, clusterChunksCount - i);
+        addClusterRun(inodeIdx, firstChunkIdx + i, chunkClusters[i], runLength);
+
+        for(int j = i; j < i + runLength; ) {
+            // skip chunks which are references to existing clusters
+            if(!newChunks[j]) {
+                j++;
+                continue;
+            }
+
+            int k = j + 1;
+            while(k < i + runLength && newChunks[k]) {
+                k++;
+            }
+            int writeBytes = min((long long) (k - j) * sb.clusterSize, (long long) bytesCount - (long long) j * sb.clusterSize);
+            submitDataWrite(sb.dataClustersAddress + (long long) chunkClusters[j] * sb.clusterSize, buffer + (long long) j * sb.clusterSize, writeBytes, ioTag);
+            writesCount++;
+            j = k;
+        }
+        i += runLength;
+    }
+
+    if(packTail) {
+        addPackedTail(inodeIdx, firstChunkIdx + clusterChunksCount, buffer + (long long) clusterChunksCount * sb.clusterSize, tailBytes, ioTag);
+        writesCount++;
+    }
+
+    // increment size
+    inodes[inodeIdx].size += bytesCount;
+    markInodeDirty(inodeIdx);
+    return writesCount;
+}
+
+int VFSManager::addCompressedDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag) {
+    // helpers
+    int firstChunkIdx = ceil(inodes[inodeIdx].size / (double) sb.clusterSize);
+    int chunksCount = ceil(bytesCount / (double) sb.clusterSize);
+    int fragmentSize = getFragmentSize();
+    // compressed chunk must save at least one fragment, otherwise it is stored raw
+    int packedCapacity = (Constants::FRAGMENTS_PER_CLUSTER - 1) * fragmentSize - Constants::COMPRESSED_HEADER_SIZE;
+
+    // compressed chunks of batch stay in buffer of its tag until they are written
+    if(packBuffers.size() <= ioTag) {
+        packBuffers.resize(ioTag + 1, nullptr);
+    }
+    if(packBuffers[ioTag] == nullptr) {
+        packBuffers[ioTag] = (char *) malloc(getBatchClusters() * sb.clusterSize * sizeof(char));
+    }
+    char *packed = packBuffers[ioTag];
+
+    // compress chunks to buffer, every compressed chunk starts at fragment and size of compressed data precedes them
+    vector<int> packedOffsets(chunksCount, -1);
+    vector<int> packedFragments(chunksCount, 0);
+    vector<int> chunkRefs(chunksCount);
+    int fragmentsCount = 0;
+    int writesCount = 0;
+    for(int i = 0; i < chunksCount; i++) {
+        char *chunk = buffer + (long long) i * sb.clusterSize;
+        int chunkBytes = min(sb.clusterSize, bytesCount - i * sb.clusterSize);
+        char *packedChunk = packed + (long long) fragmentsCount * fragmentSize;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        int packedBytes = LzCodec::compress(chunk, chunkBytes, packedChunk + Constants::COMPRESSED_HEADER_SIZE, packedCapacity);
+        compressionTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        compressedBytesIn += chunkBytes;
+
+        if(packedBytes == 0) {
+            // incompressible chunk takes whole cluster, none of its fragments is marked
+            int clusterIdx = allocateClusterIdx();
+            chunkRefs[i] = clusterIdx * Constants::FRAGMENTS_PER_CLUSTER;
+            submitDataWrite(sb.dataClustersAddress + getCompressedChunkAddress(chunkRefs[i]), chunk, chunkBytes, ioTag);
+            writesCount++;
+            compressedBytesOut += sb.clusterSize;
+            rawChunksCount++;
+            continue;
+        }
+
+        memcpy(packedChunk, &packedBytes, Constants::COMPRESSED_HEADER_SIZE);
+        packedOffsets[i] = fragmentsCount;
+        packedFragments[i] = ceil((packedBytes + Constants::COMPRESSED_HEADER_SIZE) / (double) fragmentSize);
+        fragmentsCount += packedFragments[i];
+        compressedBytesOut += packedBytes + Constants::COMPRESSED_HEADER_SIZE;
+    }
+
+    // compressed chunks follow each other in runs of clusters (chunk can continue to next cluster of run),
+    // batch smaller than cluster is added to cluster shared with previous chunks
+    int position = fragmentsCount < Constants::FRAGMENTS_PER_CLUSTER ? fragments.findFree(fragmentsCount) : -1;
+    int runEnd = position == -1 ? -1 : position + fragmentsCount;
+    int runFirstChunkIdx = -1;
+    for(int i = 0; i <= chunksCount; i++) {
+        if(i < chunksCount && packedOffsets[i] == -1) {
+            continue;
+        }
+
+        if(runFirstChunkIdx != -1 && (i == chunksCount || position + packedFragments[i] > runEnd)) {
+            // chunks placed to run are written at once
+            int runFragments = position - chunkRefs[runFirstChunkIdx];
+            submitDataWrite(sb.dataClustersAddress + getCompressedChunkAddress(chunkRefs[runFirstChunkIdx]),
+                    packed + (long long) packedOffsets[runFirstChunkIdx] * fragmentSize, runFragments * fragmentSize, ioTag);
+            writesCount++;
+            runFirstChunkIdx = -1;
+        }
+        if(i == chunksCount) {
+            break;
+        }
 
-    if(itemClusterIdx == 0) {
-        // first item in cluster - need to allocate cluster, insert item, mark it in bitmap and set direct address
-        int freeClusterIdx = getFreeClusterIdx();
-        saveDirItem(freeClusterIdx * sb.clusterSize, &item);
-        dataBitmap[freeClusterIdx] = FULL;
-        inodes[dirInodeIdx].directs[0] = freeClusterIdx;
+        if(position == -1 || position + packedFragments[i] > runEnd) {
+            // new run of clusters for the rest of compressed chunks
+            int clustersCount = ceil((fragmentsCount - packedOffsets[i]) / (double) Constants::FRAGMENTS_PER_CLUSTER);
+            int runLength;
+            int runStart = dataBitmap.allocateRun(clustersCount, &runLength);
+            if(runStart == -1) {
+                throw runtime_error(Constants::FULL_CLUSTERS_MSG);
+            }
+            position = runStart * Constants::FRAGMENTS_PER_CLUSTER;
+            runEnd = (runStart + runLength) * Constants::FRAGMENTS_PER_CLUSTER;
+        }
+
+        // mark fragments of chunk in every cluster it lies in
+        chunkRefs[i] = position;
+        for(int fragmentIdx = position; fragmentIdx < position + packedFragments[i]; ) {
+            int inCluster = min(position + packedFragments[i] - fragmentIdx, Constants::FRAGMENTS_PER_CLUSTER - fragmentIdx % Constants::FRAGMENTS_PER_CLUSTER);
+            fragments.setFull(fragmentIdx, inCluster);
+            fragmentIdx += inCluster;
+        }
+        position += packedFragments[i];
+        if(runFirstChunkIdx == -1) {
+            runFirstChunkIdx = i;
+        }
     }
-    else {
-        // it is possible to insert item in already existing cluster
-        saveDirItem(inodes[dirInodeIdx].directs[0] * sb.clusterSize + itemClusterIdx * sizeof(directoryItem), &item);
+
+    // references to chunks in order
+    inodes[inodeIdx].flags |= Constants::INODE_FLAG_COMPRESSED;
+    for(int i = 0; i < chunksCount; i++) {
+        addClusterRun(inodeIdx, firstChunkIdx + i, chunkRefs[i], 1);
     }
 
     // increment size
-    inodes[dirInodeIdx].size += sizeof(directoryItem);
+    inodes[inodeIdx].size += bytesCount;
+    markInodeDirty(inodeIdx);
+    return writesCount;
 }
 
-void VFSManager::saveDirItem(int addressInClusters, directoryItem *item) {
-    // set right address and save
-    int address = sb.dataClustersAddress + addressInClusters;
-    fseek(fp, address, SEEK_SET);
-    fwrite(item, sizeof(directoryItem), 1, fp);
-    fflush(fp);
+bool VFSManager::isCompressed(int inodeIdx) {
+    // flags are valid only in images with compression
+    return (sb.features & Constants::FEATURE_COMPRESSION) && (inodes[inodeIdx].flags & Constants::INODE_FLAG_COMPRESSED);
 }
 
-int VFSManager::getFreeClusterIdx() {
-    // iterate all clusters and try to find empty
-    for(int i = 0; i < sb.clusterCount; i++) {
-        if(dataBitmap[i] == EMPTY) {
-            return i;
+void VFSManager::readCompressedChunk(int chunkRef, char *buffer, int bytesCount) {
+    long long address = getCompressedChunkAddress(chunkRef);
+    if(!fragments.isFull(chunkRef)) {
+        // raw chunk in whole cluster
+        const char *chunk = viewDataChunk(address, buffer, bytesCount);
+        if(chunk != buffer) {
+            memcpy(buffer, chunk, bytesCount);
         }
+        return;
     }
 
-    // if no free cluster found exit app
-    cout << Constants::FULL_CLUSTERS_MSG << endl;
-    exit(EXIT_FAILURE);
+    // load header and compressed data
+    int header;
+    int packedBytes;
+    memcpy(&packedBytes, viewDataChunk(address, (char *) &header, Constants::COMPRESSED_HEADER_SIZE), Constants::COMPRESSED_HEADER_SIZE);
+    if(packedBytes <= 0 || packedBytes > (Constants::FRAGMENTS_PER_CLUSTER - 1) * getFragmentSize() - Constants::COMPRESSED_HEADER_SIZE) {
+        throw runtime_error(Constants::CORRUPTED_CHUNK_MSG);
+    }
+    char *packed = (char *) malloc(packedBytes * sizeof(char));
+    const char *chunk = viewDataChunk(address + Constants::COMPRESSED_HEADER_SIZE, packed, packedBytes);
+
+    if(LzCodec::decompress(chunk, packedBytes, buffer, bytesCount) != bytesCount) {
+        free(packed);
+        throw runtime_error(Constants::CORRUPTED_CHUNK_MSG);
+    }
+    free(packed);
 }
 
-int VFSManager::checkPathExists(vector<string> path, int startInodeIdx) {
-    int currentInodeIdx = startInodeIdx;
-    // iterate through path
-    for(int i = 0; i < path.size(); i++) {
-        // convert current dir name to char pointer
-        char *itemName = (char *) malloc((path[i].length() + 1) * sizeof(char));
-        strcpy(itemName, path[i].c_str());
-
-        // get all items of dir
-        int itemsCount = inodes[currentInodeIdx].size / sizeof(directoryItem);
-        directoryItem *items = (directoryItem *) malloc(itemsCount * sizeof(directoryItem));
-        getAllDirectoryItems(items, currentInodeIdx, itemsCount);
-
-        // iterate items and check for the same names
-        bool found = false;
-        for(int j = 0; j < itemsCount; j++) {
-            // check if directory name is the same
-            if(strcmp(items[j].name, itemName) == 0) {
-                found = true;
-                currentInodeIdx = items[j].inode;
-                break;
-            }
-        }
-        free(items);
-        free(itemName);
+void VFSManager::freeCompressedChunk(int chunkRef) {
+    if(!fragments.isFull(chunkRef)) {
+        // raw chunk in whole cluster
+        freeDataCluster(chunkRef / Constants::FRAGMENTS_PER_CLUSTER);
+        return;
+    }
 
-        if(!found) {
-            return Constants::INODE_NOT_EXISTS_CODE;
-        }
+    // count of fragments is given by size in header
+    int header;
+    int packedBytes;
+    memcpy(&packedBytes, viewDataChunk(getCompressedChunkAddress(chunkRef), (char *) &header, Constants::COMPRESSED_HEADER_SIZE), Constants::COMPRESSED_HEADER_SIZE);
+    int fragmentsEnd = chunkRef + ceil((packedBytes + Constants::COMPRESSED_HEADER_SIZE) / (double) getFragmentSize());
+    // chunk can continue to next cluster
+    for(int fragmentIdx = chunkRef; fragmentIdx < fragmentsEnd; ) {
+        int inCluster = min(fragmentsEnd - fragmentIdx, Constants::FRAGMENTS_PER_CLUSTER - fragmentIdx % Constants::FRAGMENTS_PER_CLUSTER);
+        freeFragments(fragmentIdx, inCluster);
+        fragmentIdx += inCluster;
     }
+}
 
-    return currentInodeIdx;
+long long VFSManager::getCompressedChunkAddress(int chunkRef) {
+    return (long long) (chunkRef / Constants::FRAGMENTS_PER_CLUSTER) * sb.clusterSize + (chunkRef % Constants::FRAGMENTS_PER_CLUSTER) * getFragmentSize();
 }
 
-int VFSManager::getFreeInodeIdx() {
-    // iterate all inodes and try to find empty
-    for(int i = 0; i < sb.inodesCount; i++) {
-        if(inodesBitmap[i] == EMPTY) {
-            return i;
-        }
+bool VFSManager::chunkStored(int clusterIdx, const char *chunk, char *stored) {
+    // chunk may still be only in buffer
+    map<int, pair<int, const char *>>::iterator unwritten = unwrittenChunks.find(clusterIdx);
+    if(unwritten != unwrittenChunks.end()) {
+        return memcmp(unwritten->second.second, chunk, sb.clusterSize) == 0;
     }
 
-    // if no free inodes found exit app
-    cout << Constants::FULL_INODES_MSG << endl;
-    exit(EXIT_FAILURE);
+    return memcmp(viewDataChunk((long long) clusterIdx * sb.clusterSize, stored, sb.clusterSize), chunk, sb.clusterSize) == 0;
 }
 
-bool VFSManager::itemNameUnique(int dirInodeIdx, char *itemName) {
-    // get items count and init them
-    int itemsCount = inodes[dirInodeIdx].size / sizeof(directoryItem);
-    directoryItem *items = (directoryItem *) malloc(itemsCount * sizeof(directoryItem));
-    // load items
-    getAllDirectoryItems(items, dirInodeIdx, itemsCount);
-
-    // iterate items and check for the same names
-    for(int i = 0; i < itemsCount; i++) {
-        if(strcmp(items[i].name, itemName) == 0) {
-            free(items);
-            return false;
+int VFSManager::waitForFreeBuffer(vector<int> *pendingRequests, vector<int> *freeBuffers) {
+    // buffer is free when all its requests are finished
+    while(freeBuffers->empty()) {
+        int bufferIdx = ioEngine->waitCompletion();
+        (*pendingRequests)[bufferIdx]--;
+        if((*pendingRequests)[bufferIdx] == 0) {
+            freeBuffers->push_back(bufferIdx);
         }
     }
-    free(items);
-
-    return true;
-}
 
-void VFSManager::getAllDirectoryItems(directoryItem *items, int dirInodeIdx, int itemsCount) {
-    // seek to the address and load items
-    int itemsClusterAddress = sb.dataClustersAddress + inodes[dirInodeIdx].directs[0] * sb.clusterSize;
-    fseek(fp, itemsClusterAddress, SEEK_SET);
-    fread(items, sizeof(directoryItem), itemsCount, fp);
+    int bufferIdx = freeBuffers->back();
+    freeBuffers->pop_back();
+    return bufferIdx;
 }
 
-void VFSManager::parseParentPath(string path, int * parentInodeIdx, char ** itemName) {
-    // check validity
-    if(path.empty() || path == "/") {
-        *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+void VFSManager::importTreeFile(int inodeIdx, const prefetchedFile &prefetched, HostFileReader *reader, vector<int> *pendingRequests, int *requestsInFlight) {
+    int batchSize = sb.clusterSize * getBatchClusters();
+    if((sb.features & Constants::FEATURE_INLINE_DATA) && prefetched.size >= 0 && prefetched.size <= Constants::INLINE_DATA_SIZE) {
+        // small file is stored in inode
+        memcpy(inodes[inodeIdx].inlineData, reader->getBuffer(prefetched.bufferIdx), prefetched.bytesCount);
+        inodes[inodeIdx].size = prefetched.bytesCount;
+        inodes[inodeIdx].flags |= Constants::INODE_FLAG_INLINE;
+        markInodeDirty(inodeIdx);
+        reader->releaseBuffer(prefetched.bufferIdx);
+        fclose(prefetched.file);
         return;
     }
-    // whether path is absolut
-    bool absolutPath = false;
 
-    if(path[0] == Constants::PATH_DELIM) {
-        // if path is absolut, remove root dir and mark flag
-        path = path.substr(1, path.length() - 1);
-        absolutPath = true;
+    // the first batch is in buffer of worker, the rest of big file is read here
+    int bufferIdx = prefetched.bufferIdx;
+    int bytesRead = prefetched.bytesCount;
+    while(true) {
+        if(bytesRead <= 0) {
+            reader->releaseBuffer(bufferIdx);
+            break;
+        }
+        int requestsCount = addDataChunks(inodeIdx, reader->getBuffer(bufferIdx), bytesRead, bufferIdx);
+        (*pendingRequests)[bufferIdx] = requestsCount;
+        *requestsInFlight += requestsCount;
+        if(requestsCount == 0) {
+            // all chunks were already stored
+            reader->releaseBuffer(bufferIdx);
+        }
+        if(bytesRead < batchSize) {
+            break;
+        }
+
+        // buffers kept from workers become free when writes of tree are finished
+        while((bufferIdx = reader->tryAcquireBuffer()) == -1) {
+            finishTreeWrite(reader, pendingRequests, requestsInFlight);
+        }
+        bytesRead = fread(reader->getBuffer(bufferIdx), sizeof(char), batchSize, prefetched.file);
     }
+    fclose(prefetched.file);
+}
 
-    vector<string> fullPathParts = StringUtils::split(path, Constants::PATH_DELIM);
-    if(fullPathParts.empty()) {
-        *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+void VFSManager::finishTreeWrite(HostFileReader *reader, vector<int> *pendingRequests, int *requestsInFlight) {
+    int bufferIdx = ioEngine->waitCompletion();
+    if(bufferIdx == -1) {
         return;
     }
 
-    // set itemName to the last path part
-    path = fullPathParts[fullPathParts.size() - 1];
-    *itemName = (char *) malloc((path.length() + 1) * sizeof(char));
-    strcpy(*itemName, path.c_str());
+    (*requestsInFlight)--;
+    (*pendingRequests)[bufferIdx]--;
+    if((*pendingRequests)[bufferIdx] > 0) {
+        return;
+    }
 
-    if(fullPathParts.size() == 1) {
-        if(absolutPath) {
-            // creating dir in root
-            *parentInodeIdx = Constants::ROOT_INODE_IDX;
+    // chunks of buffer are in image now, buffer is filled with another file
+    for(map<int, pair<int, const char *>>::iterator it = unwrittenChunks.begin(); it != unwrittenChunks.end(); ) {
+        if(it->second.first == bufferIdx) {
+            it = unwrittenChunks.erase(it);
         }
         else {
-            // creating dir in current dir
-            *parentInodeIdx = currentInode;
+            it++;
         }
     }
-    else {
-        // remove item name from the path
-        fullPathParts.erase(fullPathParts.begin() + fullPathParts.size() - 1);
+    reader->releaseBuffer(bufferIdx);
+}
 
-        if(absolutPath) {
-            *parentInodeIdx = checkPathExists(fullPathParts, Constants::ROOT_INODE_IDX);
+void VFSManager::listHostTree(Session &session, int dirIdx, vector<treeItem> *items) {
+    string dirPath = (*items)[dirIdx].hostPath;
+    DIR *dir = opendir(dirPath.c_str());
+    if(dir == nullptr) {
+        session.getOutput() << Constants::ITEM_SKIPPED_MSG << Constants::COMMAND_DELIM << dirPath << endl;
+        return;
+    }
+
+    // items are copied in order of their names
+    vector<string> names;
+    for(dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+        string name = entry->d_name;
+        if(name != Constants::SELF_REF && name != Constants::PARENT_REF) {
+            names.push_back(name);
         }
-        else {
-            *parentInodeIdx = checkPathExists(fullPathParts, currentInode);
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+
+    for(int i = 0; i < names.size(); i++) {
+        // only files and directories whose names fit to directory item are copied (links are not followed)
+        string path = dirPath + Constants::PATH_DELIM + names[i];
+        struct stat itemStat;
+        if(lstat(path.c_str(), &itemStat) != 0 || (!S_ISREG(itemStat.st_mode) && !S_ISDIR(itemStat.st_mode))
+                || names[i].length() >= Constants::ITEM_MAX_NAME_LEN) {
+            session.getOutput() << Constants::ITEM_SKIPPED_MSG << Constants::COMMAND_DELIM << path << endl;
+            continue;
         }
 
-        if(*parentInodeIdx != Constants::INODE_NOT_EXISTS_CODE && !inodes[*parentInodeIdx].isDirectory) {
-            *parentInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
+        treeItem item = {path, names[i], dirIdx, S_ISDIR(itemStat.st_mode), Constants::INODE_NOT_EXISTS_CODE};
+        items->push_back(item);
+        if(item.isDirectory) {
+            listHostTree(session, items->size() - 1, items);
         }
     }
 }
 
-void VFSManager::parsePath(string path, int * targetInodeIdx) {
-    // check if it is current dir
-    if(path.empty()) {
-        *targetInodeIdx = currentInode;
+void VFSManager::listVfsTree(int dirIdx, vector<treeItem> *items) {
+    string dirPath = (*items)[dirIdx].hostPath;
+    int dirInodeIdx = (*items)[dirIdx].inodeIdx;
+
+    // items of dir are read under its lock (dir could be removed by another session since it was listed), subdirs are listed after it is unlocked
+    InodeGuard guard(&inodeLocks);
+    guard.lockShared(dirInodeIdx);
+    if(!inodesBitmap.isFull(dirInodeIdx) || !inodes[dirInodeIdx].isDirectory) {
         return;
     }
+    vector<directoryItem> dirItems = getAllDirectoryItems(dirInodeIdx);
+
+    // items are copied in order of their names
+    vector<string> names;
+    map<string, int> inodeIdxs;
+    map<string, bool> directories;
+    for(int i = 0; i < dirItems.size(); i++) {
+        string name(dirItems[i].name, strnlen(dirItems[i].name, Constants::ITEM_MAX_NAME_LEN));
+        if(name != Constants::SELF_REF && name != Constants::PARENT_REF) {
+            names.push_back(name);
+            inodeIdxs[name] = dirItems[i].inode;
+            directories[name] = inodes[dirItems[i].inode].isDirectory;
+        }
+    }
+    guard.unlock();
+    sort(names.begin(), names.end());
 
-    // check if it is root dir
-    if(path == "/") {
-        *targetInodeIdx = Constants::ROOT_INODE_IDX;
-        return;
+    for(int i = 0; i < names.size(); i++) {
+        treeItem item = {dirPath + Constants::PATH_DELIM + names[i], names[i], dirIdx, directories[names[i]], inodeIdxs[names[i]]};
+        items->push_back(item);
+        if(item.isDirectory) {
+            listVfsTree(items->size() - 1, items);
+        }
     }
+}
 
-    // whether path is absolut
-    bool absolutPath = false;
+bool VFSManager::hasPackedTail(int inodeIdx) {
+    // flags are valid only in images with tail packing
+    return (sb.features & Constants::FEATURE_TAIL_PACKING) && (inodes[inodeIdx].flags & Constants::INODE_FLAG_TAIL);
+}
 
-    if(path[0] == Constants::PATH_DELIM) {
-        // if path is absolut, remove root dir and mark flag
-        path = path.substr(1, path.length() - 1);
-        absolutPath = true;
+int VFSManager::getFragmentSize() {
+    return sb.clusterSize / Constants::FRAGMENTS_PER_CLUSTER;
+}
+
+long long VFSManager::getChunkAddress(int inodeIdx, int chunkIdx, int clusterIdx) {
+    long long address = (long long) clusterIdx * sb.clusterSize;
+    // tail of file lies in its fragments
+    if(hasPackedTail(inodeIdx) && chunkIdx == (inodes[inodeIdx].size - 1) / sb.clusterSize) {
+        address += inodes[inodeIdx].tailFragment * getFragmentSize();
     }
+    return address;
+}
 
-    // split path to parts
-    vector<string> fullPathParts = StringUtils::split(path, Constants::PATH_DELIM);
-    if(fullPathParts.empty()) {
-        *targetInodeIdx = Constants::INODE_NOT_EXISTS_CODE;
-        return;
+int VFSManager::allocateTailFragments(int bytesCount) {
+    int fragmentsCount = ceil(bytesCount / (double) getFragmentSize());
+    int fragmentIdx = fragments.findFree(fragmentsCount);
+    if(fragmentIdx == -1) {
+        // new cluster will be shared by next tails
+        int clusterIdx = allocateClusterIdx();
+        fragmentIdx = clusterIdx * Constants::FRAGMENTS_PER_CLUSTER;
     }
+    fragments.setFull(fragmentIdx, fragmentsCount);
+    return fragmentIdx;
+}
 
-    // check if path exist
-    if(absolutPath) {
-        *targetInodeIdx = checkPathExists(fullPathParts, Constants::ROOT_INODE_IDX);
+void VFSManager::addPackedTail(int inodeIdx, int chunkIdx, char *buffer, int bytesCount, int ioTag) {
+    // write tail to its fragments and reference shared cluster as the last chunk
+    int fragmentIdx = allocateTailFragments(bytesCount);
+    int tailClusterIdx = fragmentIdx / Constants::FRAGMENTS_PER_CLUSTER;
+    inodes[inodeIdx].flags |= Constants::INODE_FLAG_TAIL;
+    inodes[inodeIdx].tailFragment = fragmentIdx % Constants::FRAGMENTS_PER_CLUSTER;
+    submitDataWrite(sb.dataClustersAddress + (long long) tailClusterIdx * sb.clusterSize + inodes[inodeIdx].tailFragment * getFragmentSize(),
+            buffer, bytesCount, ioTag);
+    addClusterRun(inodeIdx, chunkIdx, tailClusterIdx, 1);
+}
+
+bool VFSManager::reflinkData(int sourceInodeIdx, int targetInodeIdx) {
+    long long bytesSize = inodes[sourceInodeIdx].size;
+    vector<int> clusterIdxs = getDataClustersIdxs(sourceInodeIdx, ceil(bytesSize / (double) sb.clusterSize));
+    // packed tail shares cluster with other files, so it is copied
+    int sharedCount = hasPackedTail(sourceInodeIdx) ? clusterIdxs.size() - 1 : clusterIdxs.size();
+
+    // every shared cluster must take one more reference
+    for(int i = 0; i < sharedCount; i++) {
+        if(clusterRefs.isSaturated(clusterIdxs[i])) {
+            return false;
+        }
     }
-    else {
-        *targetInodeIdx = checkPathExists(fullPathParts, currentInode);
+
+    // clusters are shared, copy has its own references to them (no data are read or written)
+    for(int i = 0; i < sharedCount; ) {
+        int runLength = getClustersRunLength(clusterIdxs, i, sharedCount - i);
+        for(int j = 0; j < runLength; j++) {
+            clusterRefs.increment(clusterIdxs[i + j]);
+        }
+        addClusterRun(targetInodeIdx, i, clusterIdxs[i], runLength);
+        i += runLength;
+    }
+
+    if(sharedCount < clusterIdxs.size()) {
+        int tailBytes = bytesSize - (long long) sharedCount * sb.clusterSize;
+        char *tail = (char *) malloc(tailBytes * sizeof(char));
+        readImage(sb.dataClustersAddress + getChunkAddress(sourceInodeIdx, sharedCount, clusterIdxs[sharedCount]), tail, tailBytes);
+        try {
+            addPackedTail(targetInodeIdx, sharedCount, tail, tailBytes, 0);
+        }
+        catch(...) {
+            // image is full, tail is freed after its write
+            ioEngine->drain();
+            free(tail);
+            throw;
+        }
+        ioEngine->drain();
+        free(tail);
     }
+
+    inodes[targetInodeIdx].size = bytesSize;
+    markInodeDirty(targetInodeIdx);
+    return true;
 }
 
-int VFSManager::getItemInodeIdxByName(int parentInodeIdx, char *itemName) {
-    // get items count and init them
-    int itemsCount = inodes[parentInodeIdx].size / sizeof(directoryItem);
-    directoryItem *items = (directoryItem *) malloc(itemsCount * sizeof(directoryItem));
-    // load items
-    getAllDirectoryItems(items, parentInodeIdx, itemsCount);
+void VFSManager::releaseCluster(int clusterIdx) {
+    if((sb.features & Constants::FEATURE_REFLINK) && clusterRefs.get(clusterIdx) > 0) {
+        // cluster stays used by other files
+        clusterRefs.decrement(clusterIdx);
+        return;
+    }
 
-    // iterate items and check for the same names, if names are equal, return inode idx
-    for(int i = 0; i < itemsCount; i++) {
-        if(strcmp(items[i].name, itemName) == 0) {
-            int resultIdx = items[i].inode;
-            free(items);
-            return resultIdx;
-        }
+    freeDataCluster(clusterIdx);
+    if(sb.features & Constants::FEATURE_DEDUP) {
+        chunkIndex.remove(clusterIdx);
     }
-    free(items);
+}
 
-    return Constants::INODE_NOT_EXISTS_CODE;
+void VFSManager::freeTailFragments(int inodeIdx, int clusterIdx) {
+    int fragmentsCount = ceil((inodes[inodeIdx].size % sb.clusterSize) / (double) getFragmentSize());
+    freeFragments(clusterIdx * Constants::FRAGMENTS_PER_CLUSTER + inodes[inodeIdx].tailFragment, fragmentsCount);
 }
 
-void VFSManager::deleteItemFromParentCluster(int parentInodeIdx, char *itemName) {
-    // get all dir items
-    int itemsCount = inodes[parentInodeIdx].size / sizeof(directoryItem);
-    directoryItem *items = (directoryItem *) malloc(itemsCount * sizeof(directoryItem));
-    // load items
-    getAllDirectoryItems(items, parentInodeIdx, itemsCount);
+int VFSManager::getBatchClusters() {
+    return max(1, Constants::WRITE_BATCH_SIZE / sb.clusterSize);
+}
 
-    // init array for items without deleted
-    directoryItem *itemsWithoutDeleted = (directoryItem *) malloc((itemsCount - 1) * sizeof(directoryItem));
-    // fill array with items without deleted
-    int j = 0;
-    for(int i = 0; i < (itemsCount - 1); i++) {
-        if(strcmp(items[j].name, itemName) == 0) {
-            j++;
-        }
-        itemsWithoutDeleted[i] = items[j];
-        j++;
+int VFSManager::getClustersRunLength(const vector<int> &clusterIdxs, int from, int maxLength) {
+    int runLength = 1;
+    while(runLength < maxLength && from + runLength < clusterIdxs.size() && clusterIdxs[from + runLength] == clusterIdxs[from] + runLength) {
+        runLength++;
     }
-    // save directory items without deleted
-    int address = sb.dataClustersAddress + inodes[parentInodeIdx].directs[0] * sb.clusterSize;
-    fseek(fp, address, SEEK_SET);
-    fwrite(itemsWithoutDeleted, sizeof(directoryItem), (itemsCount - 1) , fp);
-    fflush(fp);
+    return runLength;
+}
 
-    inodes[parentInodeIdx].size -= sizeof(directoryItem);
-    free(items);
-    free(itemsWithoutDeleted);
+void VFSManager::allocateClusterRuns(int clustersCount, vector<int> *runStarts, vector<int> *runLengths) {
+    int firstRun = runStarts->size();
+    while(clustersCount > 0) {
+        // take first free run, which is not longer than needed
+        int runLength;
+        int runStart = dataBitmap.allocateRun(clustersCount, &runLength);
+
+        // if no free cluster found command fails, runs taken by it are free again
+        if(runStart == -1) {
+            for(int i = firstRun; i < runStarts->size(); i++) {
+                for(int j = 0; j < (*runLengths)[i]; j++) {
+                    dataBitmap.setEmpty((*runStarts)[i] + j);
+                }
+            }
+            runStarts->resize(firstRun);
+            runLengths->resize(firstRun);
+            throw runtime_error(Constants::FULL_CLUSTERS_MSG);
+        }
+
+        runStarts->push_back(runStart);
+        runLengths->push_back(runLength);
+        clustersCount -= runLength;
+    }
 }
 
-void VFSManager::addDataChunk(int inodeIdx, char *buffer, int bytesRead) {
-    // helpers
-    int inodeChunksCount = ceil(inodes[inodeIdx].size / (double) sb.clusterSize);
-    int intsPerCluster = sb.clusterSize / sizeof(int);
+void VFSManager::addClusterRun(int inodeIdx, int firstChunkIdx, int runStart, int runLength) {
+    // cached block map is not complete anymore, references in inode are changed
+    invalidateBlockMap(inodeIdx);
+    markInodeDirty(inodeIdx);
 
-    if(inodeChunksCount < Constants::DIRECTS_COUNT) {
-        // it is possible to store data chunk in directs
-        // need to allocate cluster, insert data chunk, mark it in bitmap and set direct address
-        int newClusterIdx = getFreeClusterIdx();
-        saveDataChunk(newClusterIdx * sb.clusterSize, buffer, bytesRead);
-        dataBitmap[newClusterIdx] = FULL;
-        inodes[inodeIdx].directs[inodeChunksCount] = newClusterIdx;
+    if(sb.features & Constants::FEATURE_EXTENTS) {
+        // run is one extent
+        appendExtent(inodeIdx, runStart, runLength);
     }
-    else if (inodeChunksCount < Constants::DIRECTS_COUNT + intsPerCluster)  {
-        // first level indirect
+    else {
+        // every cluster of run has its own reference
+        vector<int> clusterIdxs;
+        for(int i = 0; i < runLength; i++) {
+            clusterIdxs.push_back(runStart + i);
+        }
+        setChunksReferences(inodeIdx, firstChunkIdx, clusterIdxs);
+    }
+}
+
+void VFSManager::appendExtent(int inodeIdx, int runStart, int runLength) {
+    if(inodes[inodeIdx].extentTree == Constants::NO_CLUSTER) {
+        // find first unused extent in inode
+        int i = 0;
+        while(i < Constants::INODE_EXTENTS_COUNT && inodes[inodeIdx].extents[i].length > 0) {
+            i++;
+        }
 
-        if(inodeChunksCount == Constants::DIRECTS_COUNT) {
-            // setup first level indirect cluster
-            int newClusterIdx = getFreeClusterIdx();
-            dataBitmap[newClusterIdx] = FULL;
-            inodes[inodeIdx].indirect1 = newClusterIdx;
+        if(i > 0 && inodes[inodeIdx].extents[i - 1].start + inodes[inodeIdx].extents[i - 1].length == runStart) {
+            // run continues the last extent
+            inodes[inodeIdx].extents[i - 1].length += runLength;
+            return;
+        }
+        if(i < Constants::INODE_EXTENTS_COUNT) {
+            // there is unused extent in inode
+            inodes[inodeIdx].extents[i].start = runStart;
+            inodes[inodeIdx].extents[i].length = runLength;
+            return;
         }
 
-        // need to allocate cluster, insert data chunk, mark it in bitmap and set cluster id to indirect
-        int newClusterIdx = getFreeClusterIdx();
-        saveDataChunk(newClusterIdx * sb.clusterSize, buffer, bytesRead);
-        dataBitmap[newClusterIdx] = FULL;
-        saveReferenceToCluster(inodes[inodeIdx].indirect1 * sb.clusterSize + sizeof(int) * (inodeChunksCount - Constants::DIRECTS_COUNT), &newClusterIdx);
+        // extents in inode are used - create tree, its root is empty leaf
+        int rootClusterIdx = allocateClusterIdx();
+        extentNodeHeader header;
+        header.depth = 0;
+        header.count = 0;
+        saveDataChunk((long long) rootClusterIdx * sb.clusterSize, (char *) &header, sizeof(extentNodeHeader));
+        inodes[inodeIdx].extentTree = rootClusterIdx;
     }
-    else if(inodeChunksCount < Constants::DIRECTS_COUNT + intsPerCluster + intsPerCluster * intsPerCluster) {
 
-        if(inodeChunksCount == Constants::DIRECTS_COUNT + intsPerCluster) {
-            // setup first level indirect cluster
-            int newClusterIdx = getFreeClusterIdx();
-            dataBitmap[newClusterIdx] = FULL;
-            inodes[inodeIdx].indirect2 = newClusterIdx;
+    // helpers
+    int extentsPerLeaf = (sb.clusterSize - sizeof(extentNodeHeader)) / sizeof(clusterExtent);
+    int referencesPerNode = (sb.clusterSize - sizeof(extentNodeHeader)) / sizeof(int);
+
+    // load root of tree
+    char *root = (char *) malloc(sb.clusterSize * sizeof(char));
+    readDataChunk(inodes[inodeIdx].extentTree, root, sb.clusterSize);
+    extentNodeHeader *rootHeader = (extentNodeHeader *) root;
+    int *leavesIdxs = (int *) (root + sizeof(extentNodeHeader));
+
+    // nodes are freed when tree cannot grow
+    char *leaf = root;
+    int movedLeafIdx = Constants::NO_CLUSTER;
+    try {
+        // load last leaf - it is root itself for tree of depth 0
+        int leafIdx = inodes[inodeIdx].extentTree;
+        if(rootHeader->depth == 1) {
+            leafIdx = leavesIdxs[rootHeader->count - 1];
+            leaf = (char *) malloc(sb.clusterSize * sizeof(char));
+            readDataChunk(leafIdx, leaf, sb.clusterSize);
+        }
+        extentNodeHeader *leafHeader = (extentNodeHeader *) leaf;
+        clusterExtent *leafExtents = (clusterExtent *) (leaf + sizeof(extentNodeHeader));
+
+        if(leafHeader->count > 0 && leafExtents[leafHeader->count - 1].start + leafExtents[leafHeader->count - 1].length == runStart) {
+            // run continues the last extent
+            leafExtents[leafHeader->count - 1].length += runLength;
+            saveDataChunk((long long) leafIdx * sb.clusterSize, leaf, sb.clusterSize);
+        }
+        else if(leafHeader->count < extentsPerLeaf) {
+            // there is place in the last leaf
+            leafExtents[leafHeader->count].start = runStart;
+            leafExtents[leafHeader->count].length = runLength;
+            leafHeader->count++;
+            saveDataChunk((long long) leafIdx * sb.clusterSize, leaf, sb.clusterSize);
         }
+        else {
+            if(rootHeader->depth == 0) {
+                // root leaf is full - move its extents to new leaf, root will reference leaves
+                movedLeafIdx = allocateClusterIdx();
+                saveDataChunk((long long) movedLeafIdx * sb.clusterSize, root, sb.clusterSize);
+                rootHeader->depth = 1;
+                rootHeader->count = 1;
+                leavesIdxs[0] = movedLeafIdx;
+            }
 
-        int idxInSecondLevel = inodeChunksCount - Constants::DIRECTS_COUNT - intsPerCluster;
-        if(idxInSecondLevel % intsPerCluster == 0) {
-            // setup second level indirect cluster
-            int newClusterIdx = getFreeClusterIdx();
-            dataBitmap[newClusterIdx] = FULL;
-            saveReferenceToCluster(inodes[inodeIdx].indirect2 * sb.clusterSize + sizeof(int) * (idxInSecondLevel / intsPerCluster), &newClusterIdx);
+            // no more leaves can be referenced
+            if(rootHeader->count == referencesPerNode) {
+                throw runtime_error(Constants::FULL_REFERENCES_MSG);
+            }
+
+            // create new leaf with the extent
+            int newLeafIdx = allocateClusterIdx();
+            char *newLeaf = (char *) malloc(sb.clusterSize * sizeof(char));
+            memset(newLeaf, 0, sb.clusterSize);
+            ((extentNodeHeader *) newLeaf)->count = 1;
+            ((clusterExtent *) (newLeaf + sizeof(extentNodeHeader)))[0].start = runStart;
+            ((clusterExtent *) (newLeaf + sizeof(extentNodeHeader)))[0].length = runLength;
+            saveDataChunk((long long) newLeafIdx * sb.clusterSize, newLeaf, sb.clusterSize);
+            free(newLeaf);
+
+            // reference it from root
+            leavesIdxs[rootHeader->count] = newLeafIdx;
+            rootHeader->count++;
+            saveDataChunk((long long) inodes[inodeIdx].extentTree * sb.clusterSize, root, sb.clusterSize);
+        }
+    }
+    catch(...) {
+        // tree cannot grow (image is full or root is full), nodes are freed
+        if(movedLeafIdx != Constants::NO_CLUSTER) {
+            // root referencing the moved leaf was not saved
+            freeMetadataCluster(movedLeafIdx);
         }
+        if(leaf != root) {
+            free(leaf);
+        }
+        free(root);
+        throw;
+    }
+
+    if(leaf != root) {
+        free(leaf);
+    }
+    free(root);
+}
+
+vector<clusterExtent> VFSManager::getExtents(int sourceInodeIdx) {
+    vector<clusterExtent> extents;
+
+    // extents in inode
+    for(int i = 0; i < Constants::INODE_EXTENTS_COUNT && inodes[sourceInodeIdx].extents[i].length > 0; i++) {
+        extents.push_back(inodes[sourceInodeIdx].extents[i]);
+    }
 
-        // need to allocate cluster, insert data chunk, mark it in bitmap and set cluster id to indirect direct
-        int newClusterIdx = getFreeClusterIdx();
-        saveDataChunk(newClusterIdx * sb.clusterSize, buffer, bytesRead);
-        dataBitmap[newClusterIdx] = FULL;
-        saveReferenceToCluster( getReferenceFromCluster(inodes[inodeIdx].indirect2 * sb.clusterSize + sizeof(int) * (idxInSecondLevel / intsPerCluster))
-            * sb.clusterSize + sizeof(int) * (idxInSecondLevel % intsPerCluster), &newClusterIdx);
+    if(inodes[sourceInodeIdx].extentTree == Constants::NO_CLUSTER) {
+        return extents;
+    }
+
+    // extents in tree - every node is read once
+    char *node = (char *) malloc(sb.clusterSize * sizeof(char));
+    readDataChunk(inodes[sourceInodeIdx].extentTree, node, sb.clusterSize);
+    extentNodeHeader rootHeader = *((extentNodeHeader *) node);
+    if(rootHeader.depth == 0) {
+        clusterExtent *leafExtents = (clusterExtent *) (node + sizeof(extentNodeHeader));
+        extents.insert(extents.end(), leafExtents, leafExtents + rootHeader.count);
     }
     else {
-        cout << Constants::FULL_REFERENCES_MSG << endl;
-        exit(EXIT_FAILURE);
+        vector<int> leavesIdxs((int *) (node + sizeof(extentNodeHeader)), (int *) (node + sizeof(extentNodeHeader)) + rootHeader.count);
+        for(int i = 0; i < leavesIdxs.size(); i++) {
+            readDataChunk(leavesIdxs[i], node, sb.clusterSize);
+            clusterExtent *leafExtents = (clusterExtent *) (node + sizeof(extentNodeHeader));
+            extents.insert(extents.end(), leafExtents, leafExtents + ((extentNodeHeader *) node)->count);
+        }
     }
+    free(node);
 
-    fflush(fp);
-    // increment size
-    inodes[inodeIdx].size += bytesRead;
+    return extents;
 }
 
-void VFSManager::saveDataChunk(int address, char *buffer, int bytes) {
-    // set right address and save
-    address += sb.dataClustersAddress;
-    fseek(fp, address, SEEK_SET);
-    fwrite(buffer, sizeof(char), bytes, fp);
-    fflush(fp);
+bool VFSManager::isInline(int inodeIdx) {
+    // flags are valid only in images with inline data
+    return (sb.features & Constants::FEATURE_INLINE_DATA) && (inodes[inodeIdx].flags & Constants::INODE_FLAG_INLINE);
+}
+
+void VFSManager::initInode(int inodeIdx, bool isDirectory, int references) {
+    // block map of previous item with this inode is not valid
+    invalidateBlockMap(inodeIdx);
+
+    inodes[inodeIdx].isDirectory = isDirectory;
+    inodes[inodeIdx].flags = 0;
+    inodes[inodeIdx].references = references;
+    inodes[inodeIdx].size = 0;
+    markInodeDirty(inodeIdx);
+
+    // no references to data clusters
+    if(sb.features & Constants::FEATURE_EXTENTS) {
+        memset(inodes[inodeIdx].extents, 0, sizeof(inodes[inodeIdx].extents));
+        inodes[inodeIdx].extentTree = Constants::NO_CLUSTER;
+    }
+}
+
+void VFSManager::setChunksReferences(int inodeIdx, int firstChunkIdx, vector<int> &clusterIdxs) {
+    int intsPerCluster = sb.clusterSize / sizeof(int);
+    int chunkIdx = firstChunkIdx;
+    int i = 0;
+
+    // clusters with references which are allocated for these chunks
+    vector<int> allocatedIdxs;
+    try {
+        while(i < clusterIdxs.size()) {
+            if(chunkIdx < Constants::DIRECTS_COUNT) {
+                // it is possible to store reference in directs
+                inodes[inodeIdx].directs[chunkIdx] = clusterIdxs[i];
+                chunkIdx++;
+                i++;
+            }
+            else if(chunkIdx < Constants::DIRECTS_COUNT + intsPerCluster) {
+                // first level indirect
+                if(chunkIdx == Constants::DIRECTS_COUNT) {
+                    // setup first level indirect cluster
+                    inodes[inodeIdx].indirect1 = allocateClusterIdx();
+                    allocatedIdxs.push_back(inodes[inodeIdx].indirect1);
+                }
+
+                // save all references which belong to indirect cluster at once
+                int idxInCluster = chunkIdx - Constants::DIRECTS_COUNT;
+                int count = min((int) clusterIdxs.size() - i, intsPerCluster - idxInCluster);
+                saveReferencesToCluster((long long) inodes[inodeIdx].indirect1 * sb.clusterSize + sizeof(int) * idxInCluster, &clusterIdxs[i], count);
+                chunkIdx += count;
+                i += count;
+            }
+            else {
+                // second level indirect
+                if(chunkIdx == Constants::DIRECTS_COUNT + intsPerCluster) {
+                    // setup second level indirect cluster
+                    inodes[inodeIdx].indirect2 = allocateClusterIdx();
+                    allocatedIdxs.push_back(inodes[inodeIdx].indirect2);
+                }
+
+                int idxInSecondLevel = chunkIdx - Constants::DIRECTS_COUNT - intsPerCluster;
+                int referencesClusterIdx;
+                if(idxInSecondLevel % intsPerCluster == 0) {
+                    // setup cluster with references to data clusters
+                    referencesClusterIdx = allocateClusterIdx();
+                    allocatedIdxs.push_back(referencesClusterIdx);
+                    saveReferencesToCluster((long long) inodes[inodeIdx].indirect2 * sb.clusterSize + sizeof(int) * (idxInSecondLevel / intsPerCluster), &referencesClusterIdx, 1);
+                }
+                else {
+                    referencesClusterIdx = getReferenceFromCluster((long long) inodes[inodeIdx].indirect2 * sb.clusterSize + sizeof(int) * (idxInSecondLevel / intsPerCluster));
+                }
+
+                // save all references which belong to the cluster at once
+                int idxInCluster = idxInSecondLevel % intsPerCluster;
+                int count = min((int) clusterIdxs.size() - i, intsPerCluster - idxInCluster);
+                saveReferencesToCluster((long long) referencesClusterIdx * sb.clusterSize + sizeof(int) * idxInCluster, &clusterIdxs[i], count);
+                chunkIdx += count;
+                i += count;
+            }
+        }
+    }
+    catch(...) {
+        // size of inode does not cover these chunks, so the clusters are not freed with the item
+        for(int j = 0; j < allocatedIdxs.size(); j++) {
+            freeMetadataCluster(allocatedIdxs[j]);
+        }
+        throw;
+    }
 }
 
-void VFSManager::saveReferenceToCluster(int address, int *clusterIdx) {
+void VFSManager::saveDataChunk(long long address, char *buffer, int bytes) {
     // set right address and save
     address += sb.dataClustersAddress;
-    fseek(fp, address, SEEK_SET);
-    fwrite(clusterIdx, sizeof(int), 1, fp);
-    fflush(fp);
+    writeMetadata(address, buffer, bytes);
 }
 
-int VFSManager::getReferenceFromCluster(int address) {
+void VFSManager::saveReferencesToCluster(long long address, int *clusterIdxs, int count) {
     // set right address and save
     address += sb.dataClustersAddress;
-    fseek(fp, address, SEEK_SET);
+    writeMetadata(address, clusterIdxs, count * sizeof(int));
+}
+
+int VFSManager::getReferenceFromCluster(long long address) {
     int result;
-    fread(&result, sizeof(int), 1, fp);
-    fflush(fp);
+    readReferencesFromCluster(address, &result, 1);
     return result;
 }
 
+void VFSManager::readReferencesFromCluster(long long address, int *clusterIdxs, int count) {
+    // set right address and load
+    address += sb.dataClustersAddress;
+    readImage(address, clusterIdxs, count * sizeof(int));
+}
+
 vector<int> VFSManager::getDataClustersIdxs(int sourceInodeIdx, int clusterCount) {
+    // data of inline item are not in clusters
+    if(isInline(sourceInodeIdx)) {
+        return vector<int>();
+    }
+
+    // check if block map of item is cached
+    unique_lock<mutex> blockMapGuard(blockMapLock);
+    map<int, vector<int>>::iterator cached = blockMapCache.find(sourceInodeIdx);
+    if(cached != blockMapCache.end() && cached->second.size() >= clusterCount) {
+        return vector<int>(cached->second.begin(), cached->second.begin() + clusterCount);
+    }
+    blockMapGuard.unlock();
+
     vector<int> clusterIdxs;
+    clusterIdxs.reserve(clusterCount);
+
+    if(sb.features & Constants::FEATURE_EXTENTS) {
+        // add clusters of all extents
+        vector<clusterExtent> extents = getExtents(sourceInodeIdx);
+        for(int i = 0; i < extents.size() && clusterIdxs.size() < clusterCount; i++) {
+            for(int j = 0; j < extents[i].length && clusterIdxs.size() < clusterCount; j++) {
+                clusterIdxs.push_back(extents[i].start + j);
+            }
+        }
+    }
+    else {
+        // walk references - every cluster with references is read once as a whole
+        int intsPerCluster = sb.clusterSize / sizeof(int);
+        int *references = (int *) malloc(sb.clusterSize);
+
+        // directs
+        for(int i = 0; i < Constants::DIRECTS_COUNT && clusterIdxs.size() < clusterCount; i++) {
+            clusterIdxs.push_back(inodes[sourceInodeIdx].directs[i]);
+        }
+
+        // first level indirect
+        if(clusterIdxs.size() < clusterCount) {
+            int count = min(clusterCount - (int) clusterIdxs.size(), intsPerCluster);
+            readReferencesFromCluster((long long) inodes[sourceInodeIdx].indirect1 * sb.clusterSize, references, count);
+            clusterIdxs.insert(clusterIdxs.end(), references, references + count);
+        }
 
-    // add indexes of all data clusters
-    for(int i = 0; i < clusterCount; i++) {
-        clusterIdxs.push_back(getDataClusterIdxByChunkIdx(sourceInodeIdx, i));
+        // second level indirect
+        if(clusterIdxs.size() < clusterCount) {
+            int left = clusterCount - clusterIdxs.size();
+            int level2Count = ceil(left / (double) intsPerCluster);
+            vector<int> level2Idxs(level2Count);
+            readReferencesFromCluster((long long) inodes[sourceInodeIdx].indirect2 * sb.clusterSize, level2Idxs.data(), level2Count);
+            for(int i = 0; i < level2Count; i++) {
+                int count = min(clusterCount - (int) clusterIdxs.size(), intsPerCluster);
+                readReferencesFromCluster((long long) level2Idxs[i] * sb.clusterSize, references, count);
+                clusterIdxs.insert(clusterIdxs.end(), references, references + count);
+            }
+        }
+
+        free(references);
+    }
+
+    // cache block map, whole cache is dropped when it would be too big
+    if(clusterCount <= Constants::BLOCK_MAP_CACHE_SIZE) {
+        blockMapGuard.lock();
+        if(blockMapCacheSize + clusterCount > Constants::BLOCK_MAP_CACHE_SIZE) {
+            blockMapCache.clear();
+            blockMapCacheSize = 0;
+        }
+        // block map could be cached by another reader in the meantime
+        blockMapCacheSize += clusterCount - (int) blockMapCache[sourceInodeIdx].size();
+        blockMapCache[sourceInodeIdx] = clusterIdxs;
     }
 
     return clusterIdxs;
 }
 
+void VFSManager::invalidateBlockMap(int inodeIdx) {
+    lock_guard<mutex> blockMapGuard(blockMapLock);
+    map<int, vector<int>>::iterator cached = blockMapCache.find(inodeIdx);
+    if(cached != blockMapCache.end()) {
+        blockMapCacheSize -= cached->second.size();
+        blockMapCache.erase(cached);
+    }
+}
+
 int VFSManager::getDataClusterIdxByChunkIdx(int sourceInodeIdx, int chunkIdx) {
-    int intsPerCluster = sb.clusterSize / sizeof(int);
+    // check if block map of item is cached
+    unique_lock<mutex> blockMapGuard(blockMapLock);
+    map<int, vector<int>>::iterator cached = blockMapCache.find(sourceInodeIdx);
+    if(cached != blockMapCache.end() && chunkIdx < cached->second.size()) {
+        return cached->second[chunkIdx];
+    }
+    blockMapGuard.unlock();
+
+    if(isInline(sourceInodeIdx)) {
+        return Constants::NO_CLUSTER;
+    }
 
-    if(chunkIdx < Constants::DIRECTS_COUNT) {
-        // it is in direct
+    // chunks referenced directly from inode do not need any reads
+    if(!(sb.features & Constants::FEATURE_EXTENTS) && chunkIdx < Constants::DIRECTS_COUNT) {
         return inodes[sourceInodeIdx].directs[chunkIdx];
     }
-    else if(chunkIdx < Constants::DIRECTS_COUNT + intsPerCluster) {
-        // it is in indirect1
-        int indirect1Idx = chunkIdx - Constants::DIRECTS_COUNT;
-        return getReferenceFromCluster(inodes[sourceInodeIdx].indirect1 * sb.clusterSize + indirect1Idx * sizeof(int));
+    if((sb.features & Constants::FEATURE_EXTENTS) && chunkIdx < inodes[sourceInodeIdx].extents[0].length) {
+        return inodes[sourceInodeIdx].extents[0].start + chunkIdx;
     }
-    else {
-        // it is in indirect2
-        int indirect2Idx = chunkIdx - Constants::DIRECTS_COUNT - intsPerCluster;
-        int pointerToAnotherCluster = getReferenceFromCluster(inodes[sourceInodeIdx].indirect2 * sb.clusterSize + (indirect2Idx / intsPerCluster) * sizeof(int));
-        return getReferenceFromCluster(pointerToAnotherCluster * sb.clusterSize + (indirect2Idx % intsPerCluster) * sizeof(int));
+
+    // walk whole block map, it is cached for next calls
+    vector<int> clusterIdxs = getDataClustersIdxs(sourceInodeIdx, ceil(inodes[sourceInodeIdx].size / (double) sb.clusterSize));
+    if(chunkIdx < clusterIdxs.size()) {
+        return clusterIdxs[chunkIdx];
     }
+    return Constants::NO_CLUSTER;
 }
 
 vector<int> VFSManager::getIndirectClustersIdxs(int sourceInodeIdx, int clusterCount) {
     vector<int> clusterIdxs;
+    if(isInline(sourceInodeIdx)) {
+        return clusterIdxs;
+    }
     int intsPerCluster = sb.clusterSize / sizeof(int);
 
+    if(sb.features & Constants::FEATURE_EXTENTS) {
+        // for extent layout these are clusters of extent tree
+        int treeRootIdx = inodes[sourceInodeIdx].extentTree;
+        if(treeRootIdx != Constants::NO_CLUSTER) {
+            clusterIdxs.push_back(treeRootIdx);
+            char *root = (char *) malloc(sb.clusterSize * sizeof(char));
+            readDataChunk(treeRootIdx, root, sb.clusterSize);
+            if(((extentNodeHeader *) root)->depth == 1) {
+                int *leavesIdxs = (int *) (root + sizeof(extentNodeHeader));
+                clusterIdxs.insert(clusterIdxs.end(), leavesIdxs, leavesIdxs + ((extentNodeHeader *) root)->count);
+            }
+            free(root);
+        }
+        return clusterIdxs;
+    }
+
     if(clusterCount > Constants::DIRECTS_COUNT) {
         // for indirect 1
         clusterIdxs.push_back(inodes[sourceInodeIdx].indirect1);
@@ -1297,8 +3765,7 @@ vector<int> VFSManager::getIndirectClustersIdxs(int sourceInodeIdx, int clusterC
 
         // get the references from indirect2
         int *indirects = (int *) malloc(countOfIndirects1InIndirect2 * sizeof(int));
-        fseek(fp, sb.dataClustersAddress + inodes[sourceInodeIdx].indirect2 * sb.clusterSize, SEEK_SET);
-        fread(indirects, sizeof(int), countOfIndirects1InIndirect2, fp);
+        readReferencesFromCluster((long long) inodes[sourceInodeIdx].indirect2 * sb.clusterSize, indirects, countOfIndirects1InIndirect2);
 
         // add array to vector
         for(int i = 0; i < countOfIndirects1InIndirect2; i++) {
@@ -1312,6 +3779,16 @@ vector<int> VFSManager::getIndirectClustersIdxs(int sourceInodeIdx, int clusterC
 }
 
 void VFSManager::readDataChunk(int dataClusterIdx, char *buffer, int bytesCount) {
-    fseek(fp, sb.dataClustersAddress + dataClusterIdx * sb.clusterSize, SEEK_SET);
-    fread(buffer, sizeof(char), bytesCount, fp);
+    readImage(sb.dataClustersAddress + (long long) dataClusterIdx * sb.clusterSize, buffer, bytesCount);
+}
+
+const char *VFSManager::viewDataChunk(long long address, char *buffer, int bytesCount) {
+    char *memory = device->getMemory();
+    if(memory != nullptr) {
+        // no copy is needed
+        return memory + sb.dataClustersAddress + address;
+    }
+
+    readImage(sb.dataClustersAddress + address, buffer, bytesCount);
+    return buffer;
 }
\ No newline at end of file
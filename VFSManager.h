@@ -4,116 +4,356 @@
 #include <string>
 #include "Constants.h"
 #include "VFSDefinitions.h"
+#include "Bitmap.h"
+#include "FragmentAllocator.h"
+#include "ClusterRefCounts.h"
+#include "ChunkIndex.h"
+#include "Journal.h"
+#include "BufferCache.h"
+#include "DentryCache.h"
+#include "InodeLocks.h"
+#include "InodeGuard.h"
+#include "Session.h"
+#include "BlockDevice.h"
+#include "IOEngine.h"
+#include "HostFileReader.h"
 #include <vector>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <sys/uio.h>
 
 using namespace std;
 
 /*
- * Class containing the logic of virtual file system
+ * Class containing the logic of virtual file system - commands can be handled by more threads, commands which only read image
+ * and commands which create or remove their own items run at once (items are locked by inodes), other commands run alone,
+ * changes of commands are committed to journal when no command runs
  */
 class VFSManager {
 private:
+    /*
+     * Struct represents item of tree copied between host and vfs
+     */
+    typedef struct theTreeItem {
+        // path of item in host file system
+        string hostPath;
+        // name of item in vfs
+        string name;
+        // index of parent item in tree, -1 for root of tree
+        int parentIdx;
+        // if item is directory
+        bool isDirectory;
+        // inode of item in vfs, INODE_NOT_EXISTS_CODE if item was not created
+        int inodeIdx;
+    } treeItem;
+
     // vfs name
     char *vfsName;
     // super block
     superBlock sb;
     // inodes bitmap
-    char *inodesBitmap;
+    Bitmap inodesBitmap;
     // data cluster bitmap
-    char *dataBitmap;
+    Bitmap dataBitmap;
+    // fragments of data clusters shared by tails of files
+    FragmentAllocator fragments;
+    // counts of additional references to data clusters shared by more files
+    ClusterRefCounts clusterRefs;
+    // index of data clusters by hash of their content
+    ChunkIndex chunkIndex;
+    // chunks whose writes may not be finished - cluster idx to io tag and data in buffer
+    map<int, pair<int, const char *>> unwrittenChunks;
     // inodes
     inode *inodes;
-    // current path
-    char path[1000];
-    // current inode idx
-    int currentInode;
+    // pages of inodes changed since they were saved
+    DirtyPages dirtyInodes;
+    // lock of changed pages of inodes, commands which change different items mark them at once
+    mutex dirtyInodesLock;
+    // locks of inodes - commands lock items they read or change
+    InodeLocks inodeLocks;
+    // data clusters and runs of fragments (first fragment and count) freed in open transaction of journal - they stay used in memory until commit,
+    // so data written in place never overwrite data of items which are still in committed image
+    vector<int> pendingFreeClusters;
+    vector<pair<int, int>> pendingFreeFragments;
+    // counts of pending clusters and runs of fragments at savepoint of script
+    int savepointFreeClusters;
+    int savepointFreeFragments;
+    // lock of pending clusters and fragments, commands which run at once free items
+    mutex pendingFreeLock;
     // if vfs is already formatted
     bool formatted;
-    // file
-    FILE *fp;
+    // storage of image
+    BlockDevice *device;
+    // engine of data reads and writes
+    IOEngine *ioEngine;
+    // if bitmaps and inodes are accessed directly in image in memory of device
+    bool inodesMapped;
+    // cached indexes of data clusters of items (block maps) by inode idx
+    map<int, vector<int>> blockMapCache;
+    // count of cluster indexes in block map cache
+    int blockMapCacheSize;
+    // cache of directory entries used by path resolution
+    DentryCache dentryCache;
+    // journal of changes of metadata
+    Journal journal;
+    // true if commands of script are committed as one transaction
+    bool groupCommit;
+    // cache of clusters of data area (directory, indirect and data clusters)
+    BufferCache bufferCache;
+    // buffers of compressed chunks by io tag (chunks stay there until they are written)
+    vector<char *> packBuffers;
+    // bytes of chunks compressed since start
+    long long compressedBytesIn;
+    // bytes stored for chunks compressed since start (headers included, whole clusters of incompressible chunks)
+    long long compressedBytesOut;
+    // count of chunks since start which could not be compressed
+    long long rawChunksCount;
+    // time spent by compressing since start [ns]
+    long long compressionTime;
+    // lock of image - held shared by commands which only read it or change items locked by them, exclusively by the others
+    shared_timed_mutex imageLock;
+    // lock of io engine - it keeps requests of one command, readers which do not get it read synchronously
+    mutex engineLock;
+    // lock of block map cache, readers fill it at once
+    mutex blockMapLock;
+
+    // executes parsed command (lock of image is held)
+    void executeCommand(Session &session, const vector<string> &parts);
+    // get count of arguments which command requires
+    static int getArgumentsCount(const string &command);
+    // checks if command only reads image
+    static bool readsOnly(const string &command);
+    // checks if command only creates or removes items (or their links) in locked directories
+    static bool changesOwnItems(const vector<string> &parts);
+    // executes command which changes only its own items at once with other commands, false if it has to run alone
+    // (structures shared by items are used or image is not formatted)
+    bool executeConcurrently(Session &session, const vector<string> &parts);
 
     // format vfs
-    void format(string size);
+    void format(Session &session, string size, vector<string> options);
     // copy
-    void cp(string source, string target);
+    void cp(Session &session, string source, string target);
     // move
-    void mv(string source, string target);
+    void mv(Session &session, string source, string target);
     // remove
-    void rm(string target);
+    void rm(Session &session, string target);
     // make directory
-    void mkdir(string target);
+    void mkdir(Session &session, string target);
     // remove directory
-    void rmdir(string target);
+    void rmdir(Session &session, string target);
     // list items
-    void ls(string target);
+    void ls(Session &session, string target);
     // print text
-    void cat(string target);
+    void cat(Session &session, string target);
     // change directory
-    void cd(string target);
+    void cd(Session &session, string target);
     // print info about item
-    void info(string target);
+    void info(Session &session, string target);
     // copy file to vfs
-    void incp(string source, string target);
+    void incp(Session &session, string source, string target);
+    // copy directory tree to vfs, files are read ahead by more threads and metadata are committed in groups (as commands of script)
+    void incpTree(Session &session, string source, string target);
     // copy file from vfs
-    void outcp(string source, string target);
+    void outcp(Session &session, string source, string target);
+    // copy directory tree from vfs, files are written by more threads
+    void outcpTree(Session &session, string source, string target);
     // execute file with commands
-    void load(string target);
+    void load(Session &session, string target);
     // hard link
-    void ln(string source, string target);
-    // save bitmaps and array of inodes
+    void ln(Session &session, string source, string target);
+    // print statistics of caches
+    void stats(Session &session);
+    // set size and policy of buffer cache
+    void cache(Session &session, string size, string policyName);
+    // save changed pages of bitmaps and array of inodes
     void saveMetadata();
+    // commit staged changes and free clusters and fragments freed by them
+    void commitMetadata();
+    // drop uncommitted changes of failed command (made after savepoint in script) and load metadata of image again
+    void abortChanges();
+    // stage all changes to current transaction and mark savepoint, so failed command of script drops only its own changes
+    void setSavepoint();
+    // save changed pages of bitmaps and array of inodes to current transaction without committing it
+    void stageMetadata();
+    // checks if group of commands fills journal by quarter, so it is committed
+    bool groupCommitDue();
+    // save changed pages of metadata area and mark them as saved
+    void saveDirtyPages(long long address, char *area, DirtyPages &dirtyPages);
+    // mark inode as changed, so it is saved with metadata
+    void markInodeDirty(int inodeIdx);
+    // save super block to the start of vfs
+    void saveSuperBlock();
+    // load bitmaps and array of inodes
+    void loadMetadata();
+    // convert image without version (byte bitmaps) to image of version 2, returns false if it is not possible
+    bool migrateLegacyImage();
+    // convert image of version 2 (32-bit sizes and addresses) to current format, false if it is not such image
+    bool convertImage32();
+    // stop using bitmaps and inodes in image in memory of device (before it is closed)
+    void detachMetadata();
+    // read bytes from image (changes of current transaction included)
+    void readImage(long long address, void *buffer, long long bytesCount);
+    // write bytes of metadata to image as a part of current transaction
+    void writeMetadata(long long address, const void *buffer, long long bytesCount);
+    // open journal of image and replay its committed transactions
+    void openJournal();
+    // open buffer cache for data area of image
+    void openBufferCache();
+    // free cluster with metadata (directory items or references), its changes in journal are revoked
+    void freeMetadataCluster(int clusterIdx);
+    // free data cluster after changes of open transaction are committed (at once if journal is not used)
+    void freeDataCluster(int clusterIdx);
+    // free fragments of one cluster after changes of open transaction are committed (at once if journal is not used), cluster is freed with its last fragments
+    void freeFragments(int fragmentIdx, int fragmentsCount);
+    // marks pending clusters and fragments as free or as used again in bitmaps
+    void markPendingFree(bool empty);
+    // start writing bytes of data clusters to image, cached blocks of them are dropped
+    void submitDataWrite(long long address, const void *buffer, int bytesCount, int ioTag);
+    // write bytes to image
+    void writeImage(long long address, const void *buffer, long long bytesCount);
+    // start writing changes of image to disk
+    void flushImage();
     // get the size of bytes from user input
-    int getBytesSize(string sizeString);
+    long long getBytesSize(string sizeString);
     // add reference to self and parent
     void addTraversalReference(int inodeIdx, int parentIdx);
     // add item to directory
     void addDirectoryItem(int dirInodeIdx, int targetInodeIdx, char *itemName);
     // save dir item to vfs
-    void saveDirItem(int addressInClusters, directoryItem *item);
-    // get index of first free data cluster
-    int getFreeClusterIdx();
+    void saveDirItem(long long addressInClusters, directoryItem *item);
+    // mark first free data cluster as used and get its index
+    int allocateClusterIdx();
     // check if given path exists (starting at dir with passed index), if yes it returns dir inode index, if no it returns -1
     int checkPathExists(vector<string> path, int startInodeIdx);
-    // get next free inode
-    int getFreeInodeIdx();
+    // mark next free inode as used and get its index
+    int allocateInodeIdx();
     // checks if name of new item is unique in dir
     bool itemNameUnique(int dirInodeIdx, char *itemName);
-    // get all directory items by reference
-    void getAllDirectoryItems(directoryItem *items, int dirInodeIdx, int itemsCount);
+    // checks if one more item can be added to directory
+    bool directoryHasSpace(int dirInodeIdx);
+    // checks if item with given name can be added to directory (it exists, name is unique and there is space), error is printed if not (directory is locked)
+    bool canAddItem(Session &session, int dirInodeIdx, char *itemName);
+    // locks directory and its item with given name for changes, item idx is INODE_NOT_EXISTS_CODE if there is no such item
+    // (or directory does not exist anymore)
+    void lockItem(InodeGuard *guard, int parentInodeIdx, const char *itemName, int *itemInodeIdx);
+    // frees inode of item and all its clusters (item is not in any directory)
+    void freeItem(int inodeIdx);
+    // get all directory items
+    vector<directoryItem> getAllDirectoryItems(int dirInodeIdx);
+    // get hash of name of directory item
+    unsigned int hashItemName(const char *itemName);
+    // add item to bucket of hashed directory
+    void addHashedDirectoryItem(int dirInodeIdx, directoryItem *item);
+    // double count of buckets of hashed directory and redistribute its items
+    void growHashedDirectory(int dirInodeIdx);
     // parse parent path - returns value by parentInodeIdx -> -1 if path not exits or the index of inode of parent of target item
-    void parseParentPath(string path, int * parentInodeIdx, char ** itemName);
+    void parseParentPath(const Session &session, string path, int * parentInodeIdx, char ** itemName);
     // parse path - returns value by targetInodeIdx -> -1 if path not exists or the index of inode of target item
-    void parsePath(string path, int * targetInodeIdx);
-    // get the inode idx of item with given name, if not exists, -1 is returned
-    int getItemInodeIdxByName(int parentInodeIdx, char *itemName);
+    void parsePath(const Session &session, string path, int * targetInodeIdx);
+    // get the inode idx of item with given name, if not exists, -1 is returned (result is cached)
+    int getItemInodeIdxByName(int parentInodeIdx, const char *itemName);
+    // search dir for item with given name, if not exists, -1 is returned
+    int searchDirectory(int parentInodeIdx, const char *itemName);
     // delete item by its inode idx from parent
     void deleteItemFromParentCluster(int parentInodeIdx, char *itemName);
-    // add next data chunk of file to vfs
-    void addDataChunk(int inodeIdx, char *buffer, int bytesRead);
+    // add next data chunks of file to vfs (all chunks except the last one must be whole clusters),
+    // data are written by io engine with given tag, returns count of submitted writes
+    int addDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag);
+    // add next data chunks of file to vfs, chunks already stored in vfs become references to their clusters
+    int addDedupDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag);
+    // add next data chunks of file to vfs, every chunk is compressed to fragments of cluster (or stored raw in whole cluster)
+    int addCompressedDataChunks(int inodeIdx, char *buffer, int bytesCount, int ioTag);
+    // checks if references of file point to compressed chunks
+    bool isCompressed(int inodeIdx);
+    // read compressed chunk with given reference and decompress it to buffer
+    void readCompressedChunk(int chunkRef, char *buffer, int bytesCount);
+    // free fragments (or cluster) of compressed chunk with given reference
+    void freeCompressedChunk(int chunkRef);
+    // get address of compressed chunk with given reference in data clusters
+    long long getCompressedChunkAddress(int chunkRef);
+    // checks if cluster contains given chunk, stored is buffer for content of cluster
+    bool chunkStored(int clusterIdx, const char *chunk, char *stored);
+    // get index of buffer whose requests are finished (waits for requests if there is none)
+    int waitForFreeBuffer(vector<int> *pendingRequests, vector<int> *freeBuffers);
+    // writes data of file read ahead to inode, the rest of big file is read to free buffers of reader
+    void importTreeFile(int inodeIdx, const prefetchedFile &prefetched, HostFileReader *reader, vector<int> *pendingRequests, int *requestsInFlight);
+    // waits for any write of tree, buffer whose writes are finished returns to reader
+    void finishTreeWrite(HostFileReader *reader, vector<int> *pendingRequests, int *requestsInFlight);
+    // writes data of file to host file
+    void exportFileData(int inodeIdx, FILE *targetFile);
+    // reads data of file in batches and passes them to writer in order, runs of clusters are passed as ranges of image file
+    // (if device has file and sender accepts them, otherwise they are read)
+    void streamFileData(int inodeIdx, const function<void(const iovec *, int)> &writeParts, const function<long long(int, long long, long long)> &sendImageData);
+    // adds items of host directory to tree (recursively), items which cannot be copied are reported
+    void listHostTree(Session &session, int dirIdx, vector<treeItem> *items);
+    // adds items of vfs directory to tree (recursively)
+    void listVfsTree(int dirIdx, vector<treeItem> *items);
+    // get length of run of contiguous clusters starting at given index (at most maxLength)
+    int getClustersRunLength(const vector<int> &clusterIdxs, int from, int maxLength);
+    // checks if tail of file is stored in fragments of shared cluster
+    bool hasPackedTail(int inodeIdx);
+    // get size of fragment of cluster shared by tails [B]
+    int getFragmentSize();
+    // get address of chunk of item in data clusters (tail of file is not at the start of its cluster)
+    long long getChunkAddress(int inodeIdx, int chunkIdx, int clusterIdx);
+    // reserve fragments for tail of given size, returns index of first fragment
+    int allocateTailFragments(int bytesCount);
+    // store tail of file as given chunk to fragments of shared cluster, data are written by io engine with given tag
+    void addPackedTail(int inodeIdx, int chunkIdx, char *buffer, int bytesCount, int ioTag);
+    // make target file share data clusters of source file, returns false if some cluster cannot be shared
+    bool reflinkData(int sourceInodeIdx, int targetInodeIdx);
+    // remove one reference to data cluster of file, cluster is freed with its last reference
+    void releaseCluster(int clusterIdx);
+    // free fragments of tail of file in given cluster
+    void freeTailFragments(int inodeIdx, int clusterIdx);
+    // get count of clusters which are read and written at once when copying files
+    int getBatchClusters();
+    // allocate clusters as runs of contiguous clusters
+    void allocateClusterRuns(int clustersCount, vector<int> *runStarts, vector<int> *runLengths);
+    // store references to run of contiguous data clusters, which holds chunks starting at given chunk index
+    void addClusterRun(int inodeIdx, int firstChunkIdx, int runStart, int runLength);
+    // add run of clusters to the end of extents of inode
+    void appendExtent(int inodeIdx, int runStart, int runLength);
+    // get all extents of item (extents in inode and in extent tree)
+    vector<clusterExtent> getExtents(int sourceInodeIdx);
+    // checks if data of item are stored in its inode
+    bool isInline(int inodeIdx);
+    // init new inode without any data
+    void initInode(int inodeIdx, bool isDirectory, int references);
+    // store references to data clusters of chunks starting at given chunk index
+    void setChunksReferences(int inodeIdx, int firstChunkIdx, vector<int> &clusterIdxs);
     // save data chunk to vfs
-    void saveDataChunk(int address, char *buffer, int bytes);
-    // save reference to cluster to cluster
-    void saveReferenceToCluster(int address, int *clusterIdx);
+    void saveDataChunk(long long address, char *buffer, int bytes);
+    // save references to clusters to cluster
+    void saveReferencesToCluster(long long address, int *clusterIdxs, int count);
     // get reference to cluster from cluster
-    int getReferenceFromCluster(int address);
-    // get the data cluster indexes of given item
+    int getReferenceFromCluster(long long address);
+    // read references to clusters from cluster
+    void readReferencesFromCluster(long long address, int *clusterIdxs, int count);
+    // get the data cluster indexes of given item (every cluster with references is read once, result is cached)
     vector<int> getDataClustersIdxs(int sourceInodeIdx, int clusterCount);
+    // drop cached data cluster indexes of given item
+    void invalidateBlockMap(int inodeIdx);
     // read chunk of data from vfs
     void readDataChunk(int dataClusterIdx, char *buffer, int bytesCount);
+    // get chunk of data at address in data clusters - pointer to mapped image, or buffer the chunk was read into
+    const char *viewDataChunk(long long address, char *buffer, int bytesCount);
     // get index of data cluster based on index of data chunk
     int getDataClusterIdxByChunkIdx(int sourceInodeIdx, int chunkIdx);
-    // get the indirect indexes of given item
+    // get the indirect indexes of given item (clusters of extent tree for extent layout)
     vector<int> getIndirectClustersIdxs(int sourceInodeIdx, int clusterCount);
 
 public:
     // constructor
-    explicit VFSManager(char *vfsName);
+    VFSManager(char *vfsName, BlockDevice *device, IOEngine *ioEngine);
     // destructor
     ~VFSManager();
-    // handles user command
-    void handleCommand(string commandLine);
-    // prints current directory
-    void pwd();
+    // handles user command in given session, more sessions can be handled by more threads at once
+    void handleCommand(Session &session, string commandLine);
+    // prints current directory of session
+    void pwd(const Session &session);
 };
 
 
@@ -0,0 +1,104 @@
+#include "VFSServer.h"
+#include "SocketSession.h"
+#include "Constants.h"
+#include <cstring>
+#include <errno.h>
+#include <signal.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+VFSServer::VFSServer(VFSManager *manager, const string &socketPath) {
+    this->manager = manager;
+    this->socketPath = socketPath;
+    listenFd = -1;
+}
+
+VFSServer::~VFSServer() {
+    if(listenFd != -1) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool VFSServer::listen() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if(socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listenFd == -1) {
+        return false;
+    }
+
+    // socket of previous run is replaced, only user of server can connect to new one
+    unlink(socketPath.c_str());
+    mode_t oldMask = umask(S_IRWXG | S_IRWXO);
+    bool bound = bind(listenFd, (sockaddr *) &address, sizeof(sockaddr_un)) == 0;
+    umask(oldMask);
+    if(!bound || chmod(socketPath.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(listenFd, Constants::SERVER_BACKLOG) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void VFSServer::run() {
+    // client which closed its pipe or socket must not stop server
+    signal(SIGPIPE, SIG_IGN);
+
+    while(true) {
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(clientFd == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+
+        // socket can be reachable by other users (its directory was shared), they are refused
+        if(!clientAllowed(clientFd)) {
+            close(clientFd);
+            continue;
+        }
+
+        // every client has its own thread, image lock of manager lets readers run at once
+        thread(&VFSServer::serveClient, this, clientFd).detach();
+    }
+}
+
+bool VFSServer::clientAllowed(int clientFd) {
+    ucred credentials;
+    socklen_t credentialsSize = sizeof(ucred);
+    if(getsockopt(clientFd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsSize) != 0) {
+        return false;
+    }
+    return credentials.uid == geteuid() || credentials.uid == 0;
+}
+
+void VFSServer::serveClient(int clientFd) {
+    SocketSession session(clientFd);
+    string commandLine;
+    while(session.receiveCommand(&commandLine)) {
+        if(commandLine == Constants::EXIT) {
+            session.commandFinished();
+            return;
+        }
+
+        try {
+            manager->handleCommand(session, commandLine);
+        }
+        catch(...) {
+            // failure which command did not report ends only this client, server goes on
+            return;
+        }
+        session.commandFinished();
+    }
+}
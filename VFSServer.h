@@ -0,0 +1,39 @@
+#ifndef ZOS_VFS_VFSSERVER_H
+#define ZOS_VFS_VFSSERVER_H
+
+#include <string>
+#include "VFSManager.h"
+
+using namespace std;
+
+/*
+ * Class represents server which handles commands of clients connected to unix socket, every client has its own session
+ * and thread, image is loaded once and shared by all clients
+ */
+class VFSServer {
+public:
+    // constructor
+    VFSServer(VFSManager *manager, const string &socketPath);
+    // destructor - socket is closed and removed
+    ~VFSServer();
+    // creates socket and starts listening, false if socket cannot be created
+    bool listen();
+    // accepts clients until accept fails
+    void run();
+
+private:
+    // shared file system
+    VFSManager *manager;
+    // path of socket
+    string socketPath;
+    // listening socket, -1 if it is not opened
+    int listenFd;
+
+    // handles commands of one client until it closes connection or sends exit
+    void serveClient(int clientFd);
+    // checks if connected client runs as the same user as server (or as root)
+    static bool clientAllowed(int clientFd);
+};
+
+
+#endif
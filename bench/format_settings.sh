@@ -0,0 +1,67 @@
+#!/bin/bash
+# Benchmark of format settings - throughput of incp/outcp and space efficiency for every cluster size and size class
+# usage: format_settings.sh <zos_vfs binary> [image size, default 4GB]
+
+BINARY=$(realpath "$1")
+IMAGE_SIZE=${2:-4GB}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+cd "$WORK_DIR" || exit 1
+
+# workloads - many small files and one big file
+mkdir small
+for i in $(seq 1 500); do
+    head -c $((RANDOM % 6000 + 100)) /dev/urandom > small/f$i
+done
+head -c $((256 * 1024 * 1024)) /dev/urandom > big
+
+# current time in milliseconds
+now() {
+    date +%s%3N
+}
+
+# runs commands in vfs image
+run() {
+    printf '%s\nexit\n' "$1" | "$BINARY" image.vfs > out.txt
+}
+
+printf '%-36s %14s %14s %14s %12s\n' "setting" "small incp" "big incp" "big outcp" "efficiency"
+for setting in "cluster=512" "cluster=1024" "cluster=4096" "cluster=8192" "cluster=65536" "cluster=1048576" \
+        "class=small" "class=general" "class=media" "layout=extents cluster=4096" "layout=extents cluster=1048576"; do
+    rm -f image.vfs
+    run "format $IMAGE_SIZE dirs=hash $setting"
+
+    # small files
+    commands=""
+    for f in small/*; do
+        commands+="incp $f ${f##*/}"$'\n'
+    done
+    start=$(now)
+    run "$commands"
+    smallMs=$(( $(now) - start + 1 ))
+    smallFiles=$(grep -c OK out.txt)
+
+    # big file
+    start=$(now)
+    run "incp big big"
+    bigInMs=$(( $(now) - start + 1 ))
+    bigIn=$(( 256 * 1000 / bigInMs ))
+    bigOut="n/a"
+    if grep -q OK out.txt; then
+        start=$(now)
+        run "outcp big big.out"
+        bigOutMs=$(( $(now) - start + 1 ))
+        bigOut=$(( 256 * 1000 / bigOutMs ))
+        cmp -s big big.out || echo "$setting: big file differs"
+        rm -f big.out
+    else
+        # file does not fit to layout (e.g. references of classic layout with small clusters)
+        bigIn="n/a"
+    fi
+
+    run "stats"
+    efficiency=$(grep -o 'efficiency [0-9.e+-]*' out.txt | cut -d' ' -f2)
+
+    printf '%-36s %9s f/s %10s MB/s %10s MB/s %12s\n' "$setting" $(( smallFiles * 1000 / smallMs )) \
+        "$bigIn" "$bigOut" "$efficiency"
+done
@@ -2,30 +2,73 @@
 #include "string"
 #include "Constants.h"
 #include "VFSManager.h"
+#include "VFSServer.h"
 
 using namespace std;
 
 // entry point of program
 int main(int argc, char *argv[]) {
+    // server mode - path of socket precedes arguments of image
+    bool serve = argc > 1 && argv[1] == Constants::SERVE;
+    if(serve) {
+        argc -= 2;
+        argv += 2;
+    }
+
     // check program arguments
-    if(argc != 2) {
+    if(argc < 2 || argc > 5) {
         cout << "Exit - bad arguments count" << endl;
         return EXIT_FAILURE;
     }
 
-    VFSManager manager(argv[1]);
+    // optional storage of image
+    string storage = argc >= 3 ? argv[2] : Constants::STORAGE_STDIO;
+    BlockDevice *device = BlockDevice::forStorage(storage);
+    if(device == nullptr) {
+        cout << "Exit - unknown storage " << storage << endl;
+        return EXIT_FAILURE;
+    }
+
+    // optional engine of data reads and writes and its queue depth
+    string engine = argc >= 4 ? argv[3] : Constants::IO_SYNC;
+    int queueDepth = argc == 5 ? atoi(argv[4]) : Constants::DEFAULT_QUEUE_DEPTH;
+    if(queueDepth <= 0) {
+        cout << "Exit - bad queue depth" << endl;
+        return EXIT_FAILURE;
+    }
+    IOEngine *ioEngine = IOEngine::forName(engine, device, queueDepth);
+    if(ioEngine == nullptr) {
+        cout << "Exit - unknown io engine " << engine << endl;
+        return EXIT_FAILURE;
+    }
+
+    VFSManager manager(argv[1], device, ioEngine);
+
+    if(serve) {
+        // clients of socket share loaded image until server is killed
+        VFSServer server(&manager, argv[0]);
+        if(!server.listen()) {
+            cout << Constants::SOCKET_FAILED_MSG << endl;
+            return EXIT_FAILURE;
+        }
+        server.run();
+        return EXIT_FAILURE;
+    }
+
+    // session of user, it starts in root dir
+    Session session;
 
     // print root path
-    cout << Constants::PATH_DELIM << Constants::PATH_END << " ";
+    cout << session.getPath() << Constants::PATH_END << " ";
     string command;
     getline(cin, command);
 
     // enable user to write command until exit is written
     while(command != Constants::EXIT) {
         // handle command
-        manager.handleCommand(command);
+        manager.handleCommand(session, command);
         // enable another command
-        manager.pwd();
+        manager.pwd(session);
         cout << Constants::PATH_END << " " << flush;
         getline(cin, command);
     }